@@ -0,0 +1,39 @@
+/*
+	Bakes the animations of an SKM+SKA model into posed meshes, one GLB per animation (a morph target per frame)
+	or one OBJ per frame.
+	Usage: AnimationBaker <model.skm> <output dir> [--animation NAME]... [--ska PATH] [--format glb|obj] [--threads N] [--batch N]
+	Every animation is baked when no --animation is given, --batch is how many posed frames are kept in memory.
+*/
+
+#include "AnimationBaker.hpp"
+#include "Logger.hpp"
+
+#include <chrono>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    AnimationBaker::Options options;
+
+    if (!AnimationBaker::parseArgs(argc, argv, options))
+    {
+        std::cout << "Usage: AnimationBaker <model.skm> <output dir> [--animation NAME]... [--ska PATH] [--format glb|obj] [--threads N] [--batch N]\n";
+        Logger::flush();
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool success = AnimationBaker::bake(options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Logger::flush();
+
+    if (!success)
+    {
+        std::cout << "Failed, see log.txt\n";
+        return 1;
+    }
+
+    std::cout << "Done in " << seconds << " s\n";
+    return 0;
+}
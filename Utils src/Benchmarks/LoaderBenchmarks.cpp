@@ -0,0 +1,565 @@
+/*
+	Throughput of the format loaders on synthetic files of several sizes and, optionally, on real game data.
+	Usage: LoaderBenchmarks [--data_dir=<path/to/data>] [--max_files=N] [--baseline=<file>] [--save_baseline=<file>] [google benchmark flags]
+	--data_dir (or TOEE_BENCH_DATA environment variable) adds ".../real" benchmarks over the matching files found under it.
+	--save_baseline writes MB/s and files/s of every benchmark, --baseline prints the change against such a file.
+*/
+
+#include "DAG_Loader.hpp"
+#include "LoadStats.hpp"
+#include "Logger.hpp"
+#include "MDF_Loader.hpp"
+#include "SKA_Loader.hpp"
+#include "SKM_Loader.hpp"
+#include "SKM_Writer.hpp"
+#include "Skinning.hpp"
+#include "SyntheticAssets.hpp"
+#include "TGA_Loader.hpp"
+#include "ThreadPool.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // synthetic sizes, SKM and DAG face indices are 16 bit so vertex counts stay below 65536
+    const uint32_t meshSizes[] = { 512, 4096, 32768 };
+    const uint32_t dagSizes[] = { 256, 4096, 65535 };
+    const uint32_t skaSizes[] = { 16, 64, 256 };    // bones, animation count is half of it
+    const uint32_t mdfSizes[] = { 8, 64, 512 };     // lines
+    const uint32_t tgaSizes[] = { 64, 256, 1024 };  // width and height
+
+    struct FileStats
+    {
+        uint64_t bytes = 0;
+        uint64_t allocations = 0;
+    };
+
+    // bytes read and allocations of one untimed pass, taken from the LoadStats counters of the loaders
+    FileStats measure(const std::function<void()>& pass)
+    {
+        LoadStats::Report report;
+
+        {
+            LoadStats::Session session(report, "");
+            pass();
+        }
+
+        LoadStats::Stage total = report.total();
+
+        return { total.bytesRead, total.allocations };
+    }
+
+    void setCounters(benchmark::State& state, const FileStats& stats, size_t fileCount)
+    {
+        double iterations = static_cast<double>(state.iterations());
+
+        state.counters["MB/s"] = benchmark::Counter(stats.bytes * iterations / 1e6, benchmark::Counter::kIsRate);
+        state.counters["files/s"] = benchmark::Counter(fileCount * iterations, benchmark::Counter::kIsRate);
+        state.counters["allocs/file"] = benchmark::Counter(fileCount ? static_cast<double>(stats.allocations) / fileCount : 0.);
+    }
+
+    // runs load over every file per iteration, files that fail or throw during the untimed pass are dropped
+    void registerLoader(const std::string& name, std::vector<std::string> paths, std::function<bool(const std::string&)> load)
+    {
+        std::vector<std::string> valid;
+
+        for (const auto& path : paths)
+        {
+            try
+            {
+                if (load(path))
+                    valid.push_back(path);
+            }
+            catch (const std::exception& e)
+            {
+                LOG_WARN << "[Benchmark] Skipping " << path << ": " << e.what();
+            }
+        }
+
+        if (valid.empty())
+            return;
+
+        FileStats stats = measure([&]() { for (const auto& path : valid) load(path); });
+
+        benchmark::RegisterBenchmark(name.c_str(), [valid, load, stats](benchmark::State& state)
+        {
+            for (auto _ : state)
+            {
+                for (const auto& path : valid)
+                    benchmark::DoNotOptimize(load(path));
+            }
+
+            setCounters(state, stats, valid.size());
+        })->Unit(benchmark::kMillisecond);
+    }
+
+    bool loadDAG(const std::string& path)
+    {
+        DAG::DAGFile dag;
+        return dag.loadFromFile(path);
+    }
+
+    bool loadSKM(const std::string& path)
+    {
+        SKM::SKMFile skm;
+        return skm.loadFromFile(path);
+    }
+
+    bool loadSKA(const std::string& path)
+    {
+        SKA::SKAFile ska;
+        return ska.loadFromFile(path);
+    }
+
+    // material paths are relative to the data directory, rootPath + materialPath has to be the file
+    bool loadMDF(const std::string& path)
+    {
+        MDF::MDFFile mdf;
+        return mdf.parseMDFFile("", path);
+    }
+
+    bool loadTGA(const std::string& path)
+    {
+        TGA::TGAImage image;
+        return TGA::loadTGA(path, image);
+    }
+
+    // the models are parsed once up front, only toMesh is timed (it includes the texture loads)
+    void registerToMesh(const std::string& name, const std::vector<std::string>& paths)
+    {
+        auto models = std::make_shared<std::vector<SKM::SKMFile>>();
+        uint64_t meshBytes = 0;
+
+        for (const auto& path : paths)
+        {
+            SKM::SKMFile skm;
+
+            try
+            {
+                if (!skm.loadFromFile(path))
+                    continue;
+
+                skm.toMesh();
+            }
+            catch (const std::exception& e)
+            {
+                LOG_WARN << "[Benchmark] Skipping " << path << ": " << e.what();
+                continue;
+            }
+
+            meshBytes += skm.vertices.size() * sizeof(SKM::VertexData) + skm.faces.size() * sizeof(SKM::FaceData);
+            models->push_back(std::move(skm));
+        }
+
+        if (models->empty())
+            return;
+
+        FileStats stats = measure([&]() { for (auto& skm : *models) skm.toMesh(); });
+        stats.bytes += meshBytes;
+
+        benchmark::RegisterBenchmark(name.c_str(), [models, stats](benchmark::State& state)
+        {
+            for (auto _ : state)
+            {
+                for (auto& skm : *models)
+                {
+                    SKM::MeshBuffer mesh = skm.toMesh();
+                    benchmark::DoNotOptimize(mesh.vertices.data());
+                }
+            }
+
+            setCounters(state, stats, models->size());
+        })->Unit(benchmark::kMillisecond);
+    }
+
+    // writes every model to the same file per iteration, models that don't come back byte for byte are reported and left out
+    void registerWriter(const std::string& name, const std::vector<std::string>& paths, const fs::path& outputDir)
+    {
+        auto models = std::make_shared<std::vector<SKM::SKMFile>>();
+        FileStats stats;
+        size_t mismatched = 0;
+
+        for (const auto& path : paths)
+        {
+            SKM::SKMFile skm;
+
+            try
+            {
+                if (!SKM::verifyRoundTrip(path))
+                {
+                    mismatched++;
+                    continue;
+                }
+
+                if (!skm.loadFromFile(path))
+                    continue;
+            }
+            catch (const std::exception& e)
+            {
+                LOG_WARN << "[Benchmark] Skipping " << path << ": " << e.what();
+                continue;
+            }
+
+            SKM::Header layout = SKM::computeLayout(skm);
+            stats.bytes += layout.faceDataOffset + layout.faceCount * sizeof(SKM::FaceData);
+            models->push_back(std::move(skm));
+        }
+
+        if (mismatched)
+            LOG_ERROR << "[Benchmark] " << mismatched << " of " << paths.size() << " SKM files differ after a round trip";
+
+        if (models->empty())
+            return;
+
+        std::string output = (outputDir / "roundtrip.SKM").generic_string();
+
+        benchmark::RegisterBenchmark(name.c_str(), [models, output, stats](benchmark::State& state)
+        {
+            for (auto _ : state)
+            {
+                for (const auto& skm : *models)
+                    benchmark::DoNotOptimize(SKM::writeToFile(output, skm));
+            }
+
+            setCounters(state, stats, models->size());
+        })->Unit(benchmark::kMillisecond);
+    }
+
+    // CPU skinning of the mesh in its SKA's first frame, per kernel the CPU supports, on one thread and on a pool
+    void registerSkinning(const std::string& name, const std::string& path)
+    {
+        auto mesh = std::make_shared<SKM::MeshBuffer>();
+
+        try
+        {
+            SKM::SKMFile skm;
+
+            if (!skm.loadFromFile(path))
+                return;
+
+            *mesh = skm.toMesh();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_WARN << "[Benchmark] Skipping " << path << ": " << e.what();
+            return;
+        }
+
+        if (mesh->vertices.empty() || mesh->skinningMatrix.empty())
+            return;
+
+        auto pool = std::make_shared<ThreadPool>();
+        FileStats stats = { mesh->vertices.size() * sizeof(SKM::GPUVertex), 0 };
+
+        for (Skinning::Kernel kernel : { Skinning::Kernel::Scalar, Skinning::Kernel::AVX2 })
+        {
+            if (Skinning::resolve(kernel) != kernel)
+                continue;
+
+            for (bool threaded : { false, true })
+            {
+                std::string fullName = name + "/" + Skinning::getKernelName(kernel) + (threaded ? "/threads" : "");
+
+                benchmark::RegisterBenchmark(fullName.c_str(), [mesh, pool, kernel, threaded, stats](benchmark::State& state)
+                {
+                    Skinning::PosedMesh posed;
+
+                    for (auto _ : state)
+                    {
+                        Skinning::skinMesh(*mesh, mesh->skinningMatrix, posed, threaded ? pool.get() : nullptr, kernel);
+                        benchmark::DoNotOptimize(posed.positions.data());
+                    }
+
+                    setCounters(state, stats, 1);
+                    state.counters["influences/s"] = benchmark::Counter(mesh->vertices.size() * 4. * state.iterations(), benchmark::Counter::kIsRate);
+                })->Unit(benchmark::kMicrosecond)->UseRealTime();
+            }
+        }
+    }
+
+    std::string extensionOf(const fs::path& path)
+    {
+        std::string extension = path.extension().string();
+
+        for (auto& c : extension)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+        return extension;
+    }
+
+    void registerSynthetic(const fs::path& root)
+    {
+        const fs::path art = root / "art" / "meshes" / "bench";
+        fs::create_directories(art);
+
+        for (uint32_t size : dagSizes)
+        {
+            std::string path = (art / ("clip_" + std::to_string(size) + ".dag")).generic_string();
+            SyntheticAssets::writeDAG(path, size);
+            registerLoader("DAG parse/synthetic/" + std::to_string(size) + "v", { path }, loadDAG);
+        }
+
+        for (uint32_t size : tgaSizes)
+        {
+            std::string path = (art / ("texture_" + std::to_string(size) + ".tga")).generic_string();
+            SyntheticAssets::writeTGA(path, size, size);
+            registerLoader("TGA loadTGA/synthetic/" + std::to_string(size) + "px", { path }, loadTGA);
+        }
+
+        for (uint32_t size : mdfSizes)
+        {
+            std::string path = (art / ("material_" + std::to_string(size) + ".mdf")).generic_string();
+            SyntheticAssets::writeMDF(path, { "art/meshes/bench/texture_256.tga" }, size - 2);
+            registerLoader("MDF parseMDFFile/synthetic/" + std::to_string(size) + "lines", { path }, loadMDF);
+        }
+
+        for (uint32_t size : skaSizes)
+        {
+            std::string path = (art / ("skeleton_" + std::to_string(size) + ".ska")).generic_string();
+            SyntheticAssets::writeSKA(path, size, size / 2);
+            registerLoader("SKA loadFromFile/synthetic/" + std::to_string(size) + "bones", { path }, loadSKA);
+        }
+
+        std::vector<std::string> models;
+        std::vector<std::string> materials(4, "art/meshes/bench/material_8.mdf");
+
+        for (uint32_t size : meshSizes)
+        {
+            SyntheticAssets::MeshParams params;
+            params.vertexCount = size;
+            params.boneCount = 64;
+
+            std::string path = (art / ("model_" + std::to_string(size) + ".SKM")).generic_string();
+            SyntheticAssets::writeSKM(path, params, materials);
+            SyntheticAssets::writeSKA(path.substr(0, path.size() - 1) + "A", params.boneCount, 8);
+            models.push_back(path);
+        }
+
+        for (size_t i = 0; i < models.size(); i++)
+            registerLoader("SKM loadFromFile/synthetic/" + std::to_string(meshSizes[i]) + "v", { models[i] }, loadSKM);
+
+        for (size_t i = 0; i < models.size(); i++)
+            registerToMesh("SKM toMesh/synthetic/" + std::to_string(meshSizes[i]) + "v", { models[i] });
+
+        for (size_t i = 0; i < models.size(); i++)
+            registerWriter("SKM writeToFile/synthetic/" + std::to_string(meshSizes[i]) + "v", { models[i] }, root);
+
+        for (size_t i = 0; i < models.size(); i++)
+            registerSkinning("Skinning/synthetic/" + std::to_string(meshSizes[i]) + "v", models[i]);
+    }
+
+    void registerReal(const fs::path& dataDir, size_t maxFiles, const fs::path& outputDir)
+    {
+        std::unordered_map<std::string, std::vector<std::string>> files;
+        std::error_code error;
+
+        for (fs::recursive_directory_iterator it(dataDir, fs::directory_options::skip_permission_denied, error), end; it != end; it.increment(error))
+        {
+            if (error || !it->is_regular_file(error))
+                continue;
+
+            auto& list = files[extensionOf(it->path())];
+
+            if (list.size() < maxFiles)
+                list.push_back(it->path().generic_string());
+        }
+
+        if (error)
+            LOG_WARN << "[Benchmark] Stopped scanning " << dataDir.generic_string() << ": " << error.message();
+
+        registerLoader("DAG parse/real", files[".dag"], loadDAG);
+        registerLoader("TGA loadTGA/real", files[".tga"], loadTGA);
+        registerLoader("MDF parseMDFFile/real", files[".mdf"], loadMDF);
+        registerLoader("SKA loadFromFile/real", files[".ska"], loadSKA);
+        registerLoader("SKM loadFromFile/real", files[".skm"], loadSKM);
+        registerToMesh("SKM toMesh/real", files[".skm"]);
+        registerWriter("SKM writeToFile/real", files[".skm"], outputDir);
+    }
+
+    // console output plus, per benchmark, the change of MB/s and files/s against a saved baseline
+    class BaselineReporter : public benchmark::ConsoleReporter
+    {
+    public:
+        struct Entry
+        {
+            double megabytes = 0.;
+            double files = 0.;
+        };
+
+        bool loadBaseline(const std::string& path)
+        {
+            std::ifstream file(path);
+
+            if (!file)
+            {
+                std::cerr << "Can't open baseline " << path << "\n";
+                return false;
+            }
+
+            std::string line;
+
+            while (std::getline(file, line))
+            {
+                if (line.empty() || line[0] == '#')
+                    continue;
+
+                size_t second = line.rfind('\t');
+                size_t first = second == std::string::npos ? second : line.rfind('\t', second - 1);
+
+                if (first == std::string::npos)
+                    continue;
+
+                Entry entry;
+                entry.megabytes = std::atof(line.c_str() + first + 1);
+                entry.files = std::atof(line.c_str() + second + 1);
+                baseline[line.substr(0, first)] = entry;
+            }
+
+            return true;
+        }
+
+        bool saveBaseline(const std::string& path) const
+        {
+            std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+            if (!file)
+            {
+                std::cerr << "Can't write baseline " << path << "\n";
+                return false;
+            }
+
+            file << "# name\tMB/s\tfiles/s\n";
+
+            for (const auto& [name, entry] : results)
+                file << name << "\t" << entry.megabytes << "\t" << entry.files << "\n";
+
+            return true;
+        }
+
+        void ReportRuns(const std::vector<Run>& runs) override
+        {
+            ConsoleReporter::ReportRuns(runs);
+
+            for (const auto& run : runs)
+            {
+                if (run.run_type != Run::RT_Iteration)
+                    continue;
+
+                Entry current;
+                auto megabytes = run.counters.find("MB/s");
+                auto files = run.counters.find("files/s");
+
+                // failed runs have no counters
+                if (megabytes == run.counters.end() || files == run.counters.end())
+                    continue;
+
+                current.megabytes = megabytes->second.value;
+                current.files = files->second.value;
+
+                std::string name = run.benchmark_name();
+                results.emplace_back(name, current);
+
+                auto it = baseline.find(name);
+
+                if (it == baseline.end() || it->second.files <= 0.)
+                    continue;
+
+                double change = (current.files / it->second.files - 1.) * 100.;
+                GetOutputStream() << "    baseline " << it->second.megabytes << " MB/s, " << it->second.files << " files/s ("
+                    << (change >= 0. ? "+" : "") << change << "%)\n";
+            }
+        }
+
+    private:
+        std::unordered_map<std::string, Entry> baseline;
+        std::vector<std::pair<std::string, Entry>> results;
+    };
+
+    // takes our own --name=value flag out of argv so google benchmark doesn't reject it
+    bool takeFlag(int& argc, char** argv, const char* name, std::string& value)
+    {
+        size_t length = std::strlen(name);
+
+        for (int i = 1; i < argc; i++)
+        {
+            if (std::strncmp(argv[i], name, length) != 0 || argv[i][length] != '=')
+                continue;
+
+            value = argv[i] + length + 1;
+
+            for (int j = i; j < argc - 1; j++)
+                argv[j] = argv[j + 1];
+
+            argc--;
+
+            return true;
+        }
+
+        return false;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string dataDir;
+    std::string maxFiles = "200";
+    std::string baselinePath;
+    std::string saveBaselinePath;
+
+    takeFlag(argc, argv, "--data_dir", dataDir);
+    takeFlag(argc, argv, "--max_files", maxFiles);
+    takeFlag(argc, argv, "--baseline", baselinePath);
+    takeFlag(argc, argv, "--save_baseline", saveBaselinePath);
+
+    if (dataDir.empty())
+    {
+        if (const char* env = std::getenv("TOEE_BENCH_DATA"))
+            dataDir = env;
+    }
+
+    benchmark::Initialize(&argc, argv);
+
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    // loaders log every failed file, only errors are interesting here
+    Logger::setLevel(LOG_LEVEL_ERROR);
+
+    const fs::path syntheticRoot = fs::temp_directory_path() / "toee_loader_benchmarks" / "data";
+    registerSynthetic(syntheticRoot);
+
+    if (!dataDir.empty())
+        registerReal(dataDir, static_cast<size_t>(std::strtoul(maxFiles.c_str(), nullptr, 10)), syntheticRoot);
+
+    BaselineReporter reporter;
+
+    if (!baselinePath.empty() && !reporter.loadBaseline(baselinePath))
+        return 1;
+
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    if (!saveBaselinePath.empty())
+        reporter.saveBaseline(saveBaselinePath);
+
+    std::error_code error;
+    fs::remove_all(syntheticRoot.parent_path(), error);
+
+    Logger::flush();
+
+    return 0;
+}
@@ -8,10 +8,13 @@
 	Better yet, run it through cmd to be sure it really works
 */
 
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <string>
+#include <vector>
 
 void PrintFilename(FILE* file, const char* name)
 {
@@ -20,13 +23,11 @@ void PrintFilename(FILE* file, const char* name)
 	fseek(file, ftell(file)+16, SEEK_SET);
 	fread(&tmp, 4, 1, file);
 
-	FILE* tmpF;
 	const char* tmpName = "out.txt";
 
 	if (tmp > 1)
 	{
-		fopen_s(&tmpF, tmpName, "a+");
-		std::ofstream out(tmpF);
+		std::ofstream out(tmpName, std::ios::app);
 		out << name << "\n";
 	}
 }
@@ -48,12 +49,14 @@ int main()
 
 	for (i = 0; i < fileCount; i++)
 	{
-		FILE* file;
 		const char* tmp = fileList[i].c_str();
+		FILE* file = fopen(tmp, "rb");
+
+		if (!file)
+			continue;
 
-		fopen_s(&file, tmp, "rb");
 		PrintFilename(file, tmp);
-		_fcloseall();
+		fclose(file);
 		
 		// This bugger is here so you're sure it actually does smth
 		std::cout << "=";
@@ -7,11 +7,14 @@
 	Second optional argument can be anyting as well, makes converted file to use offsets from header of DAG file
 */
 
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 struct vertexPos {
 	double x;
@@ -130,10 +133,9 @@ void ReadTriangleData(FILE* file, uint32_t count, std::vector<triangleVertexInde
 	}
 }
 
-void WriteObjFile(FILE* file, std::string filename, std::vector<vertexPos>* vertices, std::vector<triangleVertexIndex>* triangles)
+void WriteObjFile(std::ofstream& out, std::string filename, std::vector<vertexPos>* vertices, std::vector<triangleVertexIndex>* triangles)
 {
 	std::cout << filename << ".obj\n";
-	std::ofstream out(file);
 	// Write header string
 	std::cout << "=";
 	out << "# Created by DAGtoObjConverter\n";
@@ -172,10 +174,10 @@ int main(int argc, char* argv[])
 	uint32_t vDataPos = 0;
 	uint32_t tDataPos = 0;
 
-	if (argv[1])
+	if (argc > 1)
 		adjustScale = true;
 
-	if (argv[2])
+	if (argc > 2)
 		useDAGPosition = true;
 
 	for (const auto& entry : std::filesystem::directory_iterator(pathIn))
@@ -190,14 +192,17 @@ int main(int argc, char* argv[])
 		std::vector<vertexPos> vertices;
 		std::vector<triangleVertexIndex> triangles;
 
-		FILE* file;
 		const char* tmp = fileList[i].c_str();
-		fopen_s(&file, tmp, "rb");
+		FILE* file = fopen(tmp, "rb");
+
+		if (!file)
+		{
+			std::cout << "Can't open " << tmp << "\n";
+			continue;
+		}
 
-		FILE* objFile;
 		std::string fName = pathOut + "/" + filenames[i] + ".obj";
-		const char* tmpName = fName.c_str();
-		fopen_s(&objFile, tmpName, "w+");
+		std::ofstream objFile(fName, std::ios::out | std::ios::trunc);
 
 		vertexPos fileOffsets = { 0 };
 
@@ -215,7 +220,7 @@ int main(int argc, char* argv[])
 		fseek(file, tDataPos, SEEK_SET);
 		ReadTriangleData(file, tCount, &triangles);
 		WriteObjFile(objFile, filenames[i], &vertices, &triangles);
-		_fcloseall();
+		fclose(file);
 	}
 
 	std::cout << "Done";
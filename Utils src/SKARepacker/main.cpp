@@ -0,0 +1,66 @@
+/*
+	Rewrites an SKA with only the animations and bones that are needed, streams laid out in animation order.
+	Usage: SKARepacker <input.ska> <output.ska> [--animation NAME]... [--model <model.skm>]...
+	Without --animation every animation is kept. With --model only the bones those models have (and their parents) are
+	kept, without it every bone. Output can be the input file.
+*/
+
+#include "Logger.hpp"
+#include "SKA_Writer.hpp"
+#include "SKM_Loader.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    SKA::RepackOptions options;
+    bool valid = argc >= 3 && argv[1][0] != '-' && argv[2][0] != '-';
+
+    for (int i = 3; valid && i < argc; i++)
+    {
+        if (strcmp(argv[i], "--animation") == 0 && i + 1 < argc)
+            options.animations.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc)
+        {
+            SKM::SKMFile skm;
+
+            if (!skm.loadFromFile(argv[++i]))
+            {
+                std::cout << "Failed to load " << argv[i] << "\n";
+                Logger::flush();
+                return 1;
+            }
+
+            options.models.emplace_back();
+            for (const auto& bone : skm.bones)
+                options.models.back().emplace_back(bone.boneName, strnlen(bone.boneName, sizeof(bone.boneName)));
+        }
+        else
+            valid = false;
+    }
+
+    if (!valid)
+    {
+        std::cout << "Usage: SKARepacker <input.ska> <output.ska> [--animation NAME]... [--model <model.skm>]...\n";
+        Logger::flush();
+        return 1;
+    }
+
+    std::error_code error;
+    auto sizeBefore = std::filesystem::file_size(argv[1], error);
+
+    bool success = SKA::repack(argv[1], argv[2], options);
+
+    Logger::flush();
+
+    if (!success)
+    {
+        std::cout << "Failed, see log.txt\n";
+        return 1;
+    }
+
+    std::cout << argv[1] << ": " << sizeBefore << " bytes, " << argv[2] << ": " << std::filesystem::file_size(argv[2], error) << " bytes\n";
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*
+	Writes a fake ToEE art tree (SKM, SKA, MDF, TGA and DAG files) for benchmarks and stress tests.
+	Usage: SyntheticAssets <output data dir> [--models N] [--vertices N] [--faces N] [--bones N] [--weights N] [--materials N]
+	    [--material-pool N] [--animations N] [--texture-size N] [--textures N] [--dags N] [--dag-vertices N] [--dag-faces N]
+	    [--seed N] [--threads N]
+	Point the viewer or LoaderBenchmarks --data_dir at the output directory.
+*/
+
+#include "Logger.hpp"
+#include "SyntheticAssets.hpp"
+
+#include <chrono>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    SyntheticAssets::Options options;
+
+    if (!SyntheticAssets::parseArgs(argc, argv, options))
+    {
+        std::cout << "Usage: SyntheticAssets <output data dir> [--models N] [--vertices N] [--faces N] [--bones N] [--weights N] [--materials N]\n"
+            "    [--material-pool N] [--animations N] [--texture-size N] [--textures N] [--dags N] [--dag-vertices N] [--dag-faces N]\n"
+            "    [--seed N] [--threads N]\n";
+        Logger::flush();
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool success = SyntheticAssets::generate(options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Logger::flush();
+
+    if (!success)
+    {
+        std::cout << "Failed, see log.txt\n";
+        return 1;
+    }
+
+    std::cout << "Done in " << seconds << " s\n";
+    return 0;
+}
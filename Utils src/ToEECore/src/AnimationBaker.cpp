@@ -0,0 +1,603 @@
+#include "AnimationBaker.hpp"
+#include "Bounds.hpp"
+#include "Logger.hpp"
+#include "SKM_Loader.hpp"
+#include "Skinning.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::vec2) == 2 * sizeof(float), "posed meshes are written as packed floats");
+
+namespace
+{
+    // one slot of a batch, reused for every batch so the vectors keep their capacity
+    struct Frame
+    {
+        std::vector<SKA::BoneTransform> pose;
+        std::vector<glm::mat4> palette;
+        Skinning::PosedMesh mesh;
+        Bounds deltaBounds;
+    };
+
+    std::string toFileName(const std::string& name)
+    {
+        std::string result = name;
+
+        for (char& c : result)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-')
+                c = '_';
+        }
+
+        return result.empty() ? "unnamed" : result;
+    }
+
+    glm::vec3 bindPosition(const SKM::VertexData& vertex)
+    {
+        return glm::vec3(vertex.vertexPosition.x, vertex.vertexPosition.y, vertex.vertexPosition.z);
+    }
+
+    glm::vec3 bindNormal(const SKM::VertexData& vertex)
+    {
+        return glm::vec3(vertex.normals.x, vertex.normals.y, vertex.normals.z);
+    }
+
+    bool writeOBJ(const std::string& path, const SKM::SKMFile& skm, const Skinning::PosedMesh& mesh)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file)
+        {
+            LOG_ERROR << "[AnimationBaker] Failed to create " << path;
+            return false;
+        }
+
+        // formatted into one buffer and written with a single call, frames are written from every thread at once
+        std::string text;
+        text.reserve(skm.vertices.size() * 110 + skm.faces.size() * 60);
+        char line[160];
+
+        for (const glm::vec3& position : mesh.positions)
+        {
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", position.x, position.y, position.z);
+            text += line;
+        }
+
+        for (const SKM::VertexData& vertex : skm.vertices)
+        {
+            snprintf(line, sizeof(line), "vt %.6f %.6f\n", vertex.uvPosition.x, vertex.uvPosition.y);
+            text += line;
+        }
+
+        for (const glm::vec3& normal : mesh.normals)
+        {
+            snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", normal.x, normal.y, normal.z);
+            text += line;
+        }
+
+        // position, uv and normal share the vertex index, OBJ counts from 1
+        for (const SKM::FaceData& face : skm.faces)
+        {
+            unsigned a = face.vertexIndex[0] + 1u, b = face.vertexIndex[1] + 1u, c = face.vertexIndex[2] + 1u;
+            snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+            text += line;
+        }
+
+        file.write(text.data(), text.size());
+        file.close();
+
+        if (!file)
+        {
+            LOG_ERROR << "[AnimationBaker] Failed to write " << path;
+            return false;
+        }
+
+        return true;
+    }
+
+    // morph targets are offsets from the bind pose, which is the GLB's base mesh
+    void toDeltas(const SKM::SKMFile& skm, Frame& frame)
+    {
+        frame.deltaBounds = Bounds();
+
+        for (size_t i = 0; i < skm.vertices.size(); i++)
+        {
+            frame.mesh.positions[i] -= bindPosition(skm.vertices[i]);
+            frame.mesh.normals[i] -= bindNormal(skm.vertices[i]);
+            frame.deltaBounds.add(frame.mesh.positions[i]);
+        }
+    }
+
+    // Sign (or space), nine significant digits and a two digit exponent for every finite float, so the JSON keeps its
+    // length when the bounds are filled in. Nine digits give the float back exactly, accessor bounds have to match.
+    void appendNumber(std::string& json, float value)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "% .8e", std::isfinite(value) ? value : 0.f);
+        json += text;
+    }
+
+    void appendVec3(std::string& json, const glm::vec3& value)
+    {
+        json += '[';
+        appendNumber(json, value.x);
+        json += ',';
+        appendNumber(json, value.y);
+        json += ',';
+        appendNumber(json, value.z);
+        json += ']';
+    }
+
+    // GLB with one morph target per frame, written front to back as frames arrive. The JSON chunk comes first but needs
+    // the bounds of every target, so it goes out with placeholders and is rewritten in place by close().
+    class GLBWriter
+    {
+    public:
+        bool open(const std::string& path, const SKM::SKMFile& skm, const SKA::AnimationClip& clip, const std::string& name)
+        {
+            this->path = path;
+            this->clip = &clip;
+            this->name = name;
+
+            vertexCount = skm.vertices.size();
+            indexCount = skm.faces.size() * 3;
+            frameCount = static_cast<size_t>(clip.frameCount);
+            targetBounds.clear();
+            targetBounds.reserve(frameCount);
+
+            bindBounds = Bounds();
+            for (const SKM::VertexData& vertex : skm.vertices)
+                bindBounds.add(bindPosition(vertex));
+
+            // indices | positions, normals, uvs | position and normal offsets per frame | times, weight indices, weights
+            attributesOffset = pad(indexCount * sizeof(uint16_t));
+            targetsOffset = attributesOffset + vertexCount * (2 * sizeof(glm::vec3) + sizeof(glm::vec2));
+            animationOffset = targetsOffset + frameCount * vertexCount * 2 * sizeof(glm::vec3);
+            binLength = animationOffset + frameCount * 3 * sizeof(float);
+
+            std::string json = buildJSON();
+            jsonLength = pad(json.size());
+
+            uint64_t totalLength = 12 + 8 + jsonLength + 8 + binLength;
+            if (totalLength > UINT32_MAX)
+            {
+                LOG_ERROR << "[AnimationBaker] " << path << " would be " << (totalLength >> 20) << " MB, GLB files are limited to 4 GB, bake to OBJ instead.";
+                return false;
+            }
+
+            file.open(path, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                LOG_ERROR << "[AnimationBaker] Failed to create " << path;
+                return false;
+            }
+
+            writeValue(uint32_t(0x46546C67)); // glTF
+            writeValue(uint32_t(2));
+            writeValue(static_cast<uint32_t>(totalLength));
+
+            writeValue(static_cast<uint32_t>(jsonLength));
+            writeValue(uint32_t(0x4E4F534A)); // JSON
+            json.resize(jsonLength, ' ');
+            file.write(json.data(), json.size());
+
+            writeValue(static_cast<uint32_t>(binLength));
+            writeValue(uint32_t(0x004E4942)); // BIN
+
+            std::vector<uint16_t> indices;
+            indices.reserve(attributesOffset / sizeof(uint16_t));
+            for (const SKM::FaceData& face : skm.faces)
+                indices.insert(indices.end(), face.vertexIndex, face.vertexIndex + 3);
+            indices.resize(attributesOffset / sizeof(uint16_t), 0);
+            file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint16_t));
+
+            std::vector<glm::vec3> attribute(vertexCount);
+            for (size_t i = 0; i < vertexCount; i++)
+                attribute[i] = bindPosition(skm.vertices[i]);
+            writeArray(attribute);
+
+            for (size_t i = 0; i < vertexCount; i++)
+                attribute[i] = bindNormal(skm.vertices[i]);
+            writeArray(attribute);
+
+            // glTF puts the texture origin at the top left
+            std::vector<glm::vec2> uvs(vertexCount);
+            for (size_t i = 0; i < vertexCount; i++)
+                uvs[i] = glm::vec2(skm.vertices[i].uvPosition.x, 1.f - skm.vertices[i].uvPosition.y);
+            writeArray(uvs);
+
+            return static_cast<bool>(file);
+        }
+
+        // frames have to come in order, already turned into deltas
+        bool writeFrame(const Frame& frame)
+        {
+            writeArray(frame.mesh.positions);
+            writeArray(frame.mesh.normals);
+            targetBounds.push_back(frame.deltaBounds);
+
+            if (!file)
+            {
+                LOG_ERROR << "[AnimationBaker] Failed to write " << path;
+                return false;
+            }
+
+            return true;
+        }
+
+        bool close()
+        {
+            if (targetBounds.size() != frameCount)
+            {
+                LOG_ERROR << "[AnimationBaker] " << path << " got " << targetBounds.size() << " of " << frameCount << " frames.";
+                file.close();
+                return false;
+            }
+
+            // each key shows one target fully, LINEAR blends neighbouring frames in between
+            std::vector<float> times(frameCount);
+            std::vector<uint32_t> weightIndices(frameCount);
+            std::vector<float> weights(frameCount, 1.f);
+
+            for (size_t i = 0; i < frameCount; i++)
+            {
+                times[i] = i / clip->frameRate;
+                weightIndices[i] = static_cast<uint32_t>(i * frameCount + i);
+            }
+
+            writeArray(times);
+            writeArray(weightIndices);
+            writeArray(weights);
+
+            std::string json = buildJSON();
+
+            if (pad(json.size()) != jsonLength)
+            {
+                LOG_ERROR << "[AnimationBaker] " << path << ": JSON changed length when the bounds were filled in.";
+                file.close();
+                return false;
+            }
+
+            json.resize(jsonLength, ' ');
+            file.seekp(20);
+            file.write(json.data(), json.size());
+            file.close();
+
+            if (!file)
+            {
+                LOG_ERROR << "[AnimationBaker] Failed to write " << path;
+                return false;
+            }
+
+            return true;
+        }
+
+    private:
+        std::ofstream file;
+        std::string path;
+        std::string name;
+        const SKA::AnimationClip* clip = nullptr;
+
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        size_t frameCount = 0;
+        size_t attributesOffset = 0;
+        size_t targetsOffset = 0;
+        size_t animationOffset = 0;
+        size_t binLength = 0;
+        size_t jsonLength = 0;
+
+        Bounds bindBounds;
+        std::vector<Bounds> targetBounds; // frames written so far, the rest are placeholders in the JSON
+
+        static size_t pad(size_t size) { return (size + 3) & ~size_t(3); }
+
+        template <typename T>
+        void writeValue(const T& value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void writeArray(const std::vector<T>& values)
+        {
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        }
+
+        std::string buildJSON() const
+        {
+            const size_t frameBytes = vertexCount * 2 * sizeof(glm::vec3);
+            const size_t firstTarget = 4;
+            const size_t timesAccessor = firstTarget + frameCount * 2;
+
+            std::string json;
+            json.reserve(512 + frameCount * 420);
+
+            json += "{\"asset\":{\"version\":\"2.0\",\"generator\":\"ToEE AnimationBaker\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],";
+            json += "\"nodes\":[{\"name\":\"" + name + "\",\"mesh\":0}],";
+
+            json += "\"meshes\":[{\"name\":\"" + name + "\",\"primitives\":[{\"attributes\":{\"POSITION\":1,\"NORMAL\":2,\"TEXCOORD_0\":3},\"indices\":0,\"mode\":4,\"targets\":[";
+            for (size_t i = 0; i < frameCount; i++)
+            {
+                json += i ? "," : "";
+                json += "{\"POSITION\":" + std::to_string(firstTarget + i * 2) + ",\"NORMAL\":" + std::to_string(firstTarget + i * 2 + 1) + "}";
+            }
+            json += "]}]}],";
+
+            json += "\"animations\":[{\"name\":\"" + name + "\",\"samplers\":[{\"input\":" + std::to_string(timesAccessor) + ",\"output\":"
+                + std::to_string(timesAccessor + 1) + ",\"interpolation\":\"LINEAR\"}],\"channels\":[{\"sampler\":0,\"target\":{\"node\":0,\"path\":\"weights\"}}]}],";
+
+            json += "\"buffers\":[{\"byteLength\":" + std::to_string(binLength) + "}],\"bufferViews\":[";
+            json += "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(indexCount * sizeof(uint16_t)) + ",\"target\":34963},";
+            auto vertexView = [&](size_t byteOffset, size_t byteLength, size_t byteStride)
+            {
+                json += "{\"buffer\":0,\"byteOffset\":" + std::to_string(byteOffset) + ",\"byteLength\":" + std::to_string(byteLength)
+                    + ",\"byteStride\":" + std::to_string(byteStride) + ",\"target\":34962},";
+            };
+
+            // accessors sharing a view need its stride, the targets share one since a view per frame would bloat the JSON
+            const size_t vec3Bytes = vertexCount * sizeof(glm::vec3);
+            vertexView(attributesOffset, vec3Bytes, sizeof(glm::vec3));
+            vertexView(attributesOffset + vec3Bytes, vec3Bytes, sizeof(glm::vec3));
+            vertexView(attributesOffset + 2 * vec3Bytes, vertexCount * sizeof(glm::vec2), sizeof(glm::vec2));
+            vertexView(targetsOffset, animationOffset - targetsOffset, sizeof(glm::vec3));
+            json += "{\"buffer\":0,\"byteOffset\":" + std::to_string(animationOffset) + ",\"byteLength\":" + std::to_string(binLength - animationOffset) + "}],";
+
+            auto accessor = [&](size_t bufferView, size_t byteOffset, const char* type, const Bounds* bounds)
+            {
+                json += "{\"bufferView\":" + std::to_string(bufferView) + ",\"byteOffset\":" + std::to_string(byteOffset)
+                    + ",\"componentType\":5126,\"count\":" + std::to_string(vertexCount) + ",\"type\":\"" + type + "\"";
+
+                if (bounds)
+                {
+                    json += ",\"min\":";
+                    appendVec3(json, bounds->min);
+                    json += ",\"max\":";
+                    appendVec3(json, bounds->max);
+                }
+
+                json += "},";
+            };
+
+            json += "\"accessors\":[{\"bufferView\":0,\"componentType\":5123,\"count\":" + std::to_string(indexCount) + ",\"type\":\"SCALAR\"},";
+            accessor(1, 0, "VEC3", &bindBounds);
+            accessor(2, 0, "VEC3", nullptr);
+            accessor(3, 0, "VEC2", nullptr);
+
+            const Bounds placeholder;
+            for (size_t i = 0; i < frameCount; i++)
+            {
+                accessor(4, i * frameBytes, "VEC3", i < targetBounds.size() ? &targetBounds[i] : &placeholder);
+                accessor(4, i * frameBytes + vec3Bytes, "VEC3", nullptr);
+            }
+
+            json += "{\"bufferView\":5,\"componentType\":5126,\"count\":" + std::to_string(frameCount) + ",\"type\":\"SCALAR\",\"min\":[";
+            appendNumber(json, 0.f);
+            json += "],\"max\":[";
+            appendNumber(json, (frameCount - 1) / clip->frameRate);
+            json += "]},";
+
+            // weights of every target at every key, all zero except the sparse ones
+            json += "{\"componentType\":5126,\"count\":" + std::to_string(frameCount * frameCount) + ",\"type\":\"SCALAR\",\"sparse\":{\"count\":"
+                + std::to_string(frameCount) + ",\"indices\":{\"bufferView\":5,\"byteOffset\":" + std::to_string(frameCount * sizeof(float))
+                + ",\"componentType\":5125},\"values\":{\"bufferView\":5,\"byteOffset\":" + std::to_string(frameCount * 2 * sizeof(float)) + "}}}]}";
+
+            return json;
+        }
+    };
+
+    bool bakeClip(const AnimationBaker::Options& options, const SKM::SKMFile& skm, const SKA::AnimationClip& clip, ThreadPool& pool, size_t batchFrames)
+    {
+        const std::string name = toFileName(clip.name);
+        if (clip.frameCount <= 0 || !(clip.frameRate > 0.f))
+        {
+            LOG_ERROR << "[AnimationBaker] " << clip.name << " has " << clip.frameCount << " frames at " << clip.frameRate << " fps, nothing to bake.";
+            return false;
+        }
+
+        const size_t frameCount = static_cast<size_t>(clip.frameCount);
+        const bool toOBJ = options.format == AnimationBaker::Format::OBJ;
+        const fs::path directory = toOBJ ? fs::path(options.outputPath) / name : fs::path(options.outputPath);
+
+        auto start = std::chrono::steady_clock::now();
+
+        GLBWriter glb;
+        if (toOBJ)
+        {
+            std::error_code error;
+            fs::create_directories(directory, error);
+
+            if (error)
+            {
+                LOG_ERROR << "[AnimationBaker] Failed to create " << directory.generic_string() << ": " << error.message();
+                return false;
+            }
+        }
+        else if (!glb.open((directory / (name + ".glb")).generic_string(), skm, clip, name))
+            return false;
+
+        std::vector<Frame> frames(std::min(batchFrames, frameCount));
+        std::atomic<bool> success{ true };
+
+        for (size_t first = 0; first < frameCount && success; first += frames.size())
+        {
+            const size_t count = std::min(frames.size(), frameCount - first);
+
+            // a frame per job, the frames of a batch already keep every thread busy
+            pool.parallelFor(count, [&](size_t i)
+            {
+                Frame& frame = frames[i];
+                const size_t index = first + i;
+
+                clip.sample(static_cast<float>(index), skm.animation.boneTransforms, frame.pose);
+                skm.computeSkinningMatrices(frame.pose, frame.palette);
+                Skinning::skinMesh(skm, frame.palette, frame.mesh);
+
+                if (toOBJ)
+                {
+                    char suffix[32];
+                    snprintf(suffix, sizeof(suffix), "_%04zu.obj", index);
+
+                    if (!writeOBJ((directory / (name + suffix)).generic_string(), skm, frame.mesh))
+                        success = false;
+                }
+                else
+                    toDeltas(skm, frame);
+            });
+
+            for (size_t i = 0; i < count && !toOBJ && success; i++)
+            {
+                if (!glb.writeFrame(frames[i]))
+                    success = false;
+            }
+        }
+
+        if (!toOBJ && !glb.close())
+            success = false;
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOG_INFO << "[AnimationBaker] " << clip.name << ": " << frameCount << " frames in " << seconds << " s";
+
+        return success;
+    }
+}
+
+namespace AnimationBaker
+{
+    bool bake(const Options& options)
+    {
+        SKM::SKMFile skm;
+        skm.animationPath = options.animationPath;
+
+        if (!skm.loadFromFile(options.modelPath))
+            return false;
+
+        if (skm.animation.boneData.empty() || skm.animation.animHeaderData.empty())
+        {
+            LOG_ERROR << "[AnimationBaker] " << options.modelPath << " has no SKA with animations.";
+            return false;
+        }
+
+        if (skm.vertices.empty())
+        {
+            LOG_ERROR << "[AnimationBaker] " << options.modelPath << " has no vertices.";
+            return false;
+        }
+
+        if (SKM::isOnExceptionList(options.modelPath))
+            LOG_WARN << "[AnimationBaker] " << options.modelPath << " is on the viewer's exception list, its SKM and SKA skeletons may not match.";
+
+        std::vector<size_t> selected;
+        const auto& headers = skm.animation.animHeaderData;
+
+        if (options.animations.empty())
+        {
+            for (size_t i = 0; i < headers.size(); i++)
+                selected.push_back(i);
+        }
+
+        for (const std::string& wanted : options.animations)
+        {
+            auto found = std::find_if(headers.begin(), headers.end(), [&](const SKA::AnimationHeader& header)
+            {
+                return wanted == std::string(header.name, strnlen(header.name, sizeof(header.name)));
+            });
+
+            if (found == headers.end())
+            {
+                LOG_ERROR << "[AnimationBaker] " << skm.animation.path << " has no animation named " << wanted;
+                return false;
+            }
+
+            selected.push_back(found - headers.begin());
+        }
+
+        std::error_code error;
+        fs::create_directories(options.outputPath, error);
+
+        if (error)
+        {
+            LOG_ERROR << "[AnimationBaker] Failed to create " << options.outputPath << ": " << error.message();
+            return false;
+        }
+
+        ThreadPool pool(options.threads);
+        const size_t batchFrames = options.batchFrames ? options.batchFrames : pool.getThreadCount() * 4;
+        bool success = true;
+
+        LOG_INFO << "[AnimationBaker] " << options.modelPath << ": " << selected.size() << " animations, " << skm.vertices.size() << " vertices, "
+            << pool.getThreadCount() << " threads, " << batchFrames << " frames per batch, " << Skinning::getKernelName(Skinning::Kernel::Auto) << " skinning";
+
+        // one clip decoded at a time, the key lists are small next to a batch of posed meshes
+        for (size_t index : selected)
+        {
+            SKA::AnimationClip clip;
+
+            if (!skm.animation.loadClip(index, clip) || !bakeClip(options, skm, clip, pool, batchFrames))
+                success = false;
+        }
+
+        return success;
+    }
+
+    bool parseArgs(int argc, char* argv[], Options& options)
+    {
+        // AnimationBaker <model.skm> <output dir> [--animation NAME]... [--ska PATH] [--format glb|obj] [--threads N] [--batch N]
+        if (argc < 3 || argv[1][0] == '-' || argv[2][0] == '-')
+            return false;
+
+        options.modelPath = argv[1];
+        options.outputPath = argv[2];
+        std::replace(options.modelPath.begin(), options.modelPath.end(), '\\', '/');
+        std::replace(options.outputPath.begin(), options.outputPath.end(), '\\', '/');
+
+        for (int i = 3; i < argc; i++)
+        {
+            const bool hasValue = i + 1 < argc;
+
+            if (strcmp(argv[i], "--animation") == 0 && hasValue)
+                options.animations.push_back(argv[++i]);
+            else if (strcmp(argv[i], "--ska") == 0 && hasValue)
+            {
+                options.animationPath = argv[++i];
+                std::replace(options.animationPath.begin(), options.animationPath.end(), '\\', '/');
+            }
+            else if (strcmp(argv[i], "--format") == 0 && hasValue)
+            {
+                std::string format = argv[++i];
+
+                if (format == "glb")
+                    options.format = Format::GLB;
+                else if (format == "obj")
+                    options.format = Format::OBJ;
+                else
+                {
+                    LOG_ERROR << "[AnimationBaker] Unknown format " << format << ", expected glb or obj";
+                    return false;
+                }
+            }
+            else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+                options.threads = static_cast<uint32_t>(std::clamp<unsigned long long>(strtoull(argv[++i], nullptr, 10), 0, 256));
+            else if (strcmp(argv[i], "--batch") == 0 && hasValue)
+                options.batchFrames = static_cast<uint32_t>(std::clamp<unsigned long long>(strtoull(argv[++i], nullptr, 10), 0, 4096));
+            else
+            {
+                LOG_ERROR << "[AnimationBaker] Unknown argument " << argv[i];
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
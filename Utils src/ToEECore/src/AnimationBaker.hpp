@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bakes SKA animations into posed meshes: every frame is sampled, skinned on the CPU and written out, either as an OBJ per
+// frame or as one GLB per animation with a morph target per frame and a weights animation stepping through them.
+// Frames are skinned in parallel one batch at a time and written before the next batch starts, so memory stays at one
+// batch of posed meshes however long the animation is.
+namespace AnimationBaker
+{
+    enum class Format
+    {
+        GLB,    // <output>/<animation>.glb
+        OBJ,    // <output>/<animation>/<animation>_NNNN.obj
+    };
+
+    struct Options
+    {
+        std::string modelPath;                  // SKM
+        std::string animationPath;              // SKA, empty = the one next to the SKM
+        std::string outputPath;                 // directory, created when missing
+        std::vector<std::string> animations;    // names, empty = every animation in the SKA
+        Format format = Format::GLB;
+        uint32_t threads = 0;                   // 0 = one per hardware thread
+        uint32_t batchFrames = 0;               // posed frames kept in memory, 0 = 4 per thread
+    };
+
+    bool bake(const Options& options);
+
+    bool parseArgs(int argc, char* argv[], Options& options);
+}
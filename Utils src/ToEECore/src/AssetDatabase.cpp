@@ -0,0 +1,439 @@
+#include "AssetDatabase.hpp"
+#include "LoadStats.hpp"
+#include "Logger.hpp"
+#include "MDF_Loader.hpp"
+#include "SKM_Loader.hpp"
+#include "ThreadPool.hpp"
+#include "UserCache.hpp"
+#include "VFS.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char* indexHeader = "ToEEAssetIndex 1";
+
+    bool getAssetType(const fs::path& path, AssetDatabase::Type& type)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        if (extension == ".skm")
+            type = AssetDatabase::TYPE_SKM;
+        else if (extension == ".ska")
+            type = AssetDatabase::TYPE_SKA;
+        else if (extension == ".mdf")
+            type = AssetDatabase::TYPE_MDF;
+        else if (extension == ".tga")
+            type = AssetDatabase::TYPE_TGA;
+        else if (extension == ".dag")
+            type = AssetDatabase::TYPE_DAG;
+        else
+            return false;
+
+        return true;
+    }
+
+    void splitLine(const std::string& line, char separator, std::vector<std::string>& parts)
+    {
+        parts.clear();
+
+        size_t start = 0;
+
+        while (true)
+        {
+            size_t end = line.find(separator, start);
+            parts.push_back(line.substr(start, end - start));
+
+            if (end == std::string::npos)
+                break;
+
+            start = end + 1;
+        }
+    }
+}
+
+bool AssetDatabase::open(const std::string& path, uint32_t threadCount, const std::string& index)
+{
+    LOAD_STAGE("Asset index");
+
+    // copied before clear(), a rescan passes in getRootPath() and getIndexPath()
+    std::string root = path;
+    std::string requestedIndex = index;
+
+    clear();
+
+    std::replace(root.begin(), root.end(), '\\', '/');
+
+    if (!root.empty() && root.back() != '/')
+        root += '/';
+
+    std::error_code ec;
+
+    if (root.empty() || !fs::is_directory(root, ec))
+    {
+        LOG_ERROR << "[AssetDatabase] \"" << root << "\" is not a directory.";
+        return false;
+    }
+
+    rootPath = root;
+    indexPath = requestedIndex.empty() ? defaultIndexPath(rootPath) : requestedIndex;
+
+    std::unordered_map<std::string, Asset> previous;
+    loadIndex(previous);
+
+    ThreadPool pool(threadCount);
+
+    // breadth first, every directory of a level is listed in parallel
+    std::vector<fs::path> frontier = { fs::path(rootPath) };
+    std::vector<std::vector<Asset>> found;
+
+    while (!frontier.empty())
+    {
+        std::vector<std::vector<fs::path>> subdirectories(frontier.size());
+        size_t firstFound = found.size();
+        found.resize(firstFound + frontier.size());
+
+        pool.parallelFor(frontier.size(), [&](size_t i)
+        {
+            std::error_code iteratorError;
+
+            for (fs::directory_iterator it(frontier[i], iteratorError), end; !iteratorError && it != end; it.increment(iteratorError))
+            {
+                std::error_code entryError;
+
+                if (it->is_directory(entryError))
+                {
+                    subdirectories[i].push_back(it->path());
+                    continue;
+                }
+
+                Asset asset;
+
+                if (!getAssetType(it->path(), asset.type))
+                    continue;
+
+                asset.path = it->path().generic_string().substr(rootPath.size());
+                asset.key = normalize(asset.path);
+                asset.size = it->file_size(entryError);
+                asset.modified = static_cast<int64_t>(it->last_write_time(entryError).time_since_epoch().count());
+
+                found[firstFound + i].push_back(std::move(asset));
+            }
+        });
+
+        frontier.clear();
+
+        for (auto& directories : subdirectories)
+            frontier.insert(frontier.end(), directories.begin(), directories.end());
+    }
+
+    for (auto& directory : found)
+        std::move(directory.begin(), directory.end(), std::back_inserter(assets));
+
+    // files only inside mounted archives, loose copies shadow them like they do in game
+    std::unordered_set<std::string> looseKeys;
+
+    for (const Asset& asset : assets)
+        looseKeys.insert(asset.key);
+
+    VFS::forEachArchiveFile([&](const std::string& key, uint64_t size, int64_t modified)
+    {
+        Asset asset;
+
+        if (looseKeys.count(key) || !getAssetType(fs::path(key), asset.type))
+            return;
+
+        asset.path = key;
+        asset.key = key;
+        asset.size = size;
+        asset.modified = modified;
+        assets.push_back(std::move(asset));
+    });
+
+    std::sort(assets.begin(), assets.end(), [](const Asset& a, const Asset& b) { return a.key < b.key; });
+
+    // unchanged files keep the references recorded last time, everything else is parsed again
+    std::vector<size_t> stale;
+
+    for (size_t i = 0; i < assets.size(); i++)
+    {
+        auto it = previous.find(assets[i].key);
+
+        if (it != previous.end() && it->second.size == assets[i].size && it->second.modified == assets[i].modified)
+            assets[i].dependencies = std::move(it->second.dependencies);
+        else
+            stale.push_back(i);
+    }
+
+    pool.parallelFor(stale.size(), [&](size_t i) { scanDependencies(assets[stale[i]]); });
+
+    scannedCount = stale.size();
+
+    lookup.reserve(assets.size());
+
+    for (size_t i = 0; i < assets.size(); i++)
+        lookup.emplace(assets[i].key, static_cast<uint32_t>(i));
+
+    LOG_INFO << "[AssetDatabase] Indexed " << assets.size() << " assets in " << rootPath << ", " << scannedCount << " scanned, " << assets.size() - scannedCount << " from index";
+
+    if (!stale.empty() || previous.size() != assets.size())
+        save();
+
+    return true;
+}
+
+bool AssetDatabase::loadIndex(std::unordered_map<std::string, Asset>& previous) const
+{
+    std::ifstream file(indexPath);
+
+    if (!file)
+        return false;
+
+    std::string line;
+
+    if (!std::getline(file, line) || line != indexHeader)
+    {
+        LOG_WARN << "[AssetDatabase] Ignoring index with unknown version " << indexPath;
+        return false;
+    }
+
+    std::vector<std::string> fields;
+    std::vector<std::string> dependencies;
+
+    while (std::getline(file, line))
+    {
+        splitLine(line, '\t', fields);
+
+        if (fields.size() != 5)
+            continue;
+
+        Asset asset;
+        asset.type = static_cast<Type>(std::min(std::strtoul(fields[0].c_str(), nullptr, 10), static_cast<unsigned long>(TYPE_COUNT - 1)));
+        asset.size = std::strtoull(fields[1].c_str(), nullptr, 10);
+        asset.modified = std::strtoll(fields[2].c_str(), nullptr, 10);
+        asset.path = fields[3];
+        asset.key = normalize(asset.path);
+
+        if (!fields[4].empty())
+        {
+            splitLine(fields[4], '|', dependencies);
+            asset.dependencies = dependencies;
+        }
+
+        std::string key = asset.key;
+        previous.emplace(std::move(key), std::move(asset));
+    }
+
+    return true;
+}
+
+bool AssetDatabase::save() const
+{
+    std::error_code ec;
+    fs::create_directories(fs::path(indexPath).parent_path(), ec);
+
+    std::ofstream file(indexPath, std::ios::out | std::ios::trunc);
+
+    if (!file)
+    {
+        LOG_WARN << "[AssetDatabase] Cannot write " << indexPath << ", the directory will be scanned again next time";
+        return false;
+    }
+
+    file << indexHeader << '\n';
+
+    for (const Asset& asset : assets)
+    {
+        file << static_cast<uint32_t>(asset.type) << '\t' << asset.size << '\t' << asset.modified << '\t' << asset.path << '\t';
+
+        for (size_t i = 0; i < asset.dependencies.size(); i++)
+            file << (i ? "|" : "") << asset.dependencies[i];
+
+        file << '\n';
+    }
+
+    return static_cast<bool>(file);
+}
+
+void AssetDatabase::clear()
+{
+    rootPath.clear();
+    indexPath.clear();
+    assets.clear();
+    lookup.clear();
+    scannedCount = 0;
+}
+
+void AssetDatabase::scanDependencies(Asset& asset) const
+{
+    asset.dependencies.clear();
+
+    if (asset.type == TYPE_SKM)
+    {
+        VFS::File file(getFullPath(asset));
+        SKM::Header header;
+
+        // a corrupt header shouldn't turn into a huge allocation
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.materialCount > 256)
+            return;
+
+        // animation is found by swapping the extension, same as SKMFile::loadFromFile does
+        asset.dependencies.push_back(asset.key.substr(0, asset.key.size() - 1) + "a");
+
+        std::vector<SKM::MaterialData> materials(header.materialCount);
+        file.seekg(header.materialDataOffset);
+
+        if (!file.read(reinterpret_cast<char*>(materials.data()), materials.size() * sizeof(SKM::MaterialData)))
+            return;
+
+        for (const auto& material : materials)
+            asset.dependencies.push_back(normalize(std::string(material.materialFilePath, strnlen(material.materialFilePath, sizeof(material.materialFilePath)))));
+    }
+    else if (asset.type == TYPE_MDF)
+    {
+        MDF::MDFFile material;
+
+        if (!material.parseMDFFile(rootPath, asset.path))
+            return;
+
+        // the parser returns texture paths with the root already prepended
+        for (int i = 0; i < material.textureCount; i++)
+        {
+            if (material.texturePath[i].size() > rootPath.size())
+                asset.dependencies.push_back(normalize(material.texturePath[i].substr(rootPath.size())));
+        }
+
+        if (material.glossMap.size() > rootPath.size())
+            asset.dependencies.push_back(normalize(material.glossMap.substr(rootPath.size())));
+    }
+}
+
+const AssetDatabase::Asset* AssetDatabase::find(const std::string& path) const
+{
+    std::string key = normalize(path);
+
+    // full paths under the root work as well as relative ones
+    std::string root = normalize(rootPath);
+
+    if (key.compare(0, root.size(), root) == 0)
+        key.erase(0, root.size());
+
+    auto it = lookup.find(key);
+
+    return it != lookup.end() ? &assets[it->second] : nullptr;
+}
+
+AssetDatabase::Dependencies AssetDatabase::resolve(const Asset& asset) const
+{
+    Dependencies result;
+    std::unordered_set<const Asset*> seenTextures;
+
+    auto addTextures = [&](const Asset& material)
+    {
+        for (const auto& key : material.dependencies)
+        {
+            auto it = lookup.find(key);
+
+            if (it == lookup.end())
+                result.missing.push_back(key);
+            else if (seenTextures.insert(&assets[it->second]).second)
+                result.textures.push_back(&assets[it->second]);
+        }
+    };
+
+    if (asset.type == TYPE_MDF)
+    {
+        addTextures(asset);
+        return result;
+    }
+
+    for (const auto& key : asset.dependencies)
+    {
+        auto it = lookup.find(key);
+
+        if (it == lookup.end())
+        {
+            result.missing.push_back(key);
+            continue;
+        }
+
+        const Asset& dependency = assets[it->second];
+
+        if (dependency.type == TYPE_SKA)
+            result.animation = &dependency;
+        else if (dependency.type == TYPE_MDF)
+        {
+            result.materials.push_back(&dependency);
+            addTextures(dependency);
+        }
+    }
+
+    return result;
+}
+
+void AssetDatabase::search(const std::string& query, Type type, size_t maxResults, std::vector<const Asset*>& results) const
+{
+    results.clear();
+
+    std::string lowerQuery = normalize(query);
+
+    for (const Asset& asset : assets)
+    {
+        if (results.size() >= maxResults)
+            break;
+
+        if (asset.type != type)
+            continue;
+
+        size_t nameStart = asset.key.find_last_of('/');
+        nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+
+        if (asset.key.find(lowerQuery, nameStart) != std::string::npos)
+            results.push_back(&asset);
+    }
+}
+
+std::string AssetDatabase::normalize(const std::string& path)
+{
+    std::string result = path;
+
+    for (char& c : result)
+        c = c == '\\' ? '/' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    return result;
+}
+
+std::string AssetDatabase::defaultIndexPath(const std::string& rootPath)
+{
+    // FNV-1a, stable across runs and builds so the same data directory always finds its index
+    uint64_t hash = 14695981039346656037ull;
+
+    for (char c : normalize(rootPath))
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "assets_%016llx.idx", static_cast<unsigned long long>(hash));
+
+    return UserCache::getDirectory() + name;
+}
+
+const char* AssetDatabase::getTypeName(Type type)
+{
+    static const char* names[TYPE_COUNT] = { "SKM", "SKA", "MDF", "TGA", "DAG" };
+
+    return type < TYPE_COUNT ? names[type] : "?";
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Index of every SKM, SKA, MDF, TGA and DAG under a ToEE data directory (and inside mounted VFS archives) with the references between them.
+// The directory is walked in parallel, only files whose size or modification time changed since the last
+// run are parsed again, and the result is kept in an index file in the user's cache directory, since the data
+// directory may well be read only.
+class AssetDatabase
+{
+public:
+    enum Type : uint8_t
+    {
+        TYPE_SKM = 0,
+        TYPE_SKA = 1,
+        TYPE_MDF = 2,
+        TYPE_TGA = 3,
+        TYPE_DAG = 4,
+        TYPE_COUNT = 5
+    };
+
+    struct Asset
+    {
+        std::string path; // relative to the data root, as found on disk
+        std::string key;  // lower case with forward slashes, what lookups use
+        Type type = TYPE_SKM;
+        uint64_t size = 0;
+        int64_t modified = 0;
+        std::vector<std::string> dependencies; // keys, SKM -> SKA and MDF, MDF -> TGA
+    };
+
+    struct Dependencies
+    {
+        const Asset* animation = nullptr;
+        std::vector<const Asset*> materials;
+        std::vector<const Asset*> textures;
+        std::vector<std::string> missing;
+    };
+
+    // indexes rootPath, reusing whatever is still valid in its index file, and writes the index back if anything changed;
+    // an empty indexPath picks defaultIndexPath(rootPath)
+    bool open(const std::string& rootPath, uint32_t threadCount = 0, const std::string& indexPath = std::string());
+    bool save() const;
+    void clear();
+
+    const Asset* find(const std::string& path) const;
+    Dependencies resolve(const Asset& asset) const;
+
+    // case insensitive substring match on the file name, assets of type only
+    void search(const std::string& query, Type type, size_t maxResults, std::vector<const Asset*>& results) const;
+
+    bool isOpen() const { return !rootPath.empty(); }
+    const std::string& getRootPath() const { return rootPath; }
+    const std::string& getIndexPath() const { return indexPath; }
+    std::string getFullPath(const Asset& asset) const { return rootPath + asset.path; }
+    size_t getAssetCount() const { return assets.size(); }
+    size_t getScannedCount() const { return scannedCount; }
+
+    static std::string normalize(const std::string& path);
+
+    // UserCache::getDirectory() + assets_<hash of rootPath>.idx
+    static std::string defaultIndexPath(const std::string& rootPath);
+    static const char* getTypeName(Type type);
+
+private:
+    std::string rootPath;
+    std::string indexPath;
+    std::vector<Asset> assets; // sorted by key
+    std::unordered_map<std::string, uint32_t> lookup;
+    size_t scannedCount = 0;
+
+    bool loadIndex(std::unordered_map<std::string, Asset>& previous) const;
+    void scanDependencies(Asset& asset) const;
+};
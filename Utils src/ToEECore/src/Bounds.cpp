@@ -0,0 +1,84 @@
+#include "Bounds.hpp"
+
+#include <cmath>
+
+void Bounds::add(const glm::vec3& point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void Bounds::add(const glm::vec3& sphereCenter, float sphereRadius)
+{
+    min = glm::min(min, sphereCenter - glm::vec3(sphereRadius));
+    max = glm::max(max, sphereCenter + glm::vec3(sphereRadius));
+}
+
+void Bounds::add(const Bounds& other)
+{
+    if (other.isEmpty())
+        return;
+
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+Bounds Bounds::transformed(const glm::mat4& matrix) const
+{
+    if (isEmpty())
+        return *this;
+
+    glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.f));
+    glm::vec3 extent = (max - min) * .5f;
+    glm::vec3 newExtent(0.f);
+
+    // each world axis gets the absolute projection of the box's half extents
+    for (int column = 0; column < 3; column++)
+    {
+        for (int row = 0; row < 3; row++)
+            newExtent[row] += std::abs(matrix[column][row]) * extent[column];
+    }
+
+    Bounds result;
+    result.min = center - newExtent;
+    result.max = center + newExtent;
+
+    return result;
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    // Gribb/Hartmann, rows of the column major matrix added to and subtracted from the w row
+    glm::vec4 rows[4];
+
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+    planes[0] = rows[3] + rows[0]; // left
+    planes[1] = rows[3] - rows[0]; // right
+    planes[2] = rows[3] + rows[1]; // bottom
+    planes[3] = rows[3] - rows[1]; // top
+    planes[4] = rows[3] + rows[2]; // near
+    planes[5] = rows[3] - rows[2]; // far
+}
+
+bool Frustum::intersects(const Bounds& bounds) const
+{
+    if (bounds.isEmpty())
+        return false;
+
+    for (const glm::vec4& plane : planes)
+    {
+        // box corner furthest along the plane normal
+        glm::vec3 corner(
+            plane.x >= 0.f ? bounds.max.x : bounds.min.x,
+            plane.y >= 0.f ? bounds.max.y : bounds.min.y,
+            plane.z >= 0.f ? bounds.max.z : bounds.min.z
+        );
+
+        if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.f)
+            return false;
+    }
+
+    return true;
+}
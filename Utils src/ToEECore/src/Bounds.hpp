@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+
+// Axis aligned box plus the sphere around it, for culling. Starts empty, add() grows it.
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool isEmpty() const { return min.x > max.x; }
+
+    void add(const glm::vec3& point);
+    void add(const glm::vec3& sphereCenter, float sphereRadius);
+    void add(const Bounds& other);
+
+    glm::vec3 getCenter() const { return (min + max) * .5f; }
+    float getRadius() const { return isEmpty() ? 0.f : glm::length(max - min) * .5f; }
+
+    // box around the transformed box, stays conservative under rotation and non uniform scale
+    Bounds transformed(const glm::mat4& matrix) const;
+};
+
+// Six planes pointing inwards, extracted from a view projection (or model view projection) matrix
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    // false only when the box is completely outside one of the planes, boxes near corners can pass
+    bool intersects(const Bounds& bounds) const;
+};
@@ -0,0 +1,64 @@
+#include "DAG_Loader.hpp"
+#include "LoadStats.hpp"
+#include "Logger.hpp"
+#include "VFS.hpp"
+
+namespace DAG
+{
+    bool DAGFile::loadFromFile(const std::string& path)
+    {
+        LOAD_STAGE("DAG parse");
+
+        clear();
+
+        VFS::File file(path);
+        if (!file)
+        {
+            LOG_ERROR << "[DAG] Failed to open file: " << path;
+            return false;
+        }
+
+        file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+        LoadStats::addBytesRead(file.gcount());
+        if (!file)
+        {
+            LOG_ERROR << "[DAG] Failed to read header.";
+            return false;
+        }
+
+        file.seekg(header.dataBlockOffset);
+        file.read(reinterpret_cast<char*>(&dataBlock), sizeof(DataBlock));
+        LoadStats::addBytesRead(file.gcount());
+        if (!file)
+        {
+            LOG_ERROR << "[DAG] Failed to read data block.";
+            return false;
+        }
+
+        file.seekg(dataBlock.vertexDataOffset);
+        vertices.resize(dataBlock.vertexCount);
+        file.read(reinterpret_cast<char*>(vertices.data()), vertices.size() * sizeof(Vertex));
+        LoadStats::addBytesRead(file.gcount());
+
+        file.seekg(dataBlock.faceDataOffset);
+        faces.resize(dataBlock.faceCount);
+        file.read(reinterpret_cast<char*>(faces.data()), faces.size() * sizeof(Face));
+        LoadStats::addBytesRead(file.gcount());
+
+        if (!file)
+        {
+            LOG_ERROR << "[DAG] Truncated file: " << path;
+            return false;
+        }
+
+        return true;
+    }
+
+    void DAGFile::clear()
+    {
+        header = { };
+        dataBlock = { };
+        vertices.resize(0);
+        faces.resize(0);
+    }
+}
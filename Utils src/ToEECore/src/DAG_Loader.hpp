@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// DAG clipping meshes, layout described in "File format specifications/DAG.txt"
+namespace DAG
+{
+#pragma pack(push, 1)
+    struct Header
+    {
+        float xOffset = 0.f;
+        float yOffset = 0.f;
+        float zOffset = 0.f;
+        float boundingBoxRadius = 0.f;
+        uint32_t objectCount = 1;
+        uint32_t dataBlockOffset = 24;
+    };
+
+    struct DataBlock
+    {
+        uint32_t vertexCount = 0;
+        uint32_t faceCount = 0;
+        uint32_t vertexDataOffset = 40;
+        uint32_t faceDataOffset = 0;
+    };
+
+    struct Vertex
+    {
+        float x = 0.f;
+        float y = 0.f;
+        float z = 0.f;
+    };
+
+    struct Face
+    {
+        uint16_t vertexIndex[3] = { 0 };
+    };
+#pragma pack(pop)
+
+    struct DAGFile
+    {
+        Header header = { };
+        DataBlock dataBlock = { };
+        std::vector<Vertex> vertices;
+        std::vector<Face> faces;
+
+        bool loadFromFile(const std::string& path);
+        void clear();
+    };
+}
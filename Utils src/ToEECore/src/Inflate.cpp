@@ -0,0 +1,303 @@
+#include "Inflate.hpp"
+
+namespace Inflate
+{
+    namespace
+    {
+        const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+        // canonical Huffman table: symbol count per code length, then symbols sorted by code
+        struct Huffman
+        {
+            uint16_t counts[16];
+            uint16_t symbols[288];
+
+            bool build(const uint8_t* lengths, int count)
+            {
+                for (auto& c : counts)
+                    c = 0;
+
+                for (int i = 0; i < count; i++)
+                    counts[lengths[i]]++;
+
+                counts[0] = 0;
+
+                uint16_t offsets[16];
+                offsets[1] = 0;
+
+                for (int i = 1; i < 15; i++)
+                    offsets[i + 1] = offsets[i] + counts[i];
+
+                for (int i = 0; i < count; i++)
+                {
+                    if (lengths[i])
+                        symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+                }
+
+                return true;
+            }
+        };
+
+        struct Decoder
+        {
+            const uint8_t* input;
+            size_t inputSize;
+            size_t inputPos = 0;
+            uint32_t bitBuffer = 0;
+            uint32_t bitCount = 0;
+            bool overrun = false;
+
+            uint8_t* output;
+            size_t outputSize;
+            size_t outputPos = 0;
+
+            uint32_t bits(uint32_t need)
+            {
+                while (bitCount < need)
+                {
+                    if (inputPos >= inputSize)
+                    {
+                        overrun = true;
+                        return 0;
+                    }
+
+                    bitBuffer |= static_cast<uint32_t>(input[inputPos++]) << bitCount;
+                    bitCount += 8;
+                }
+
+                uint32_t value = bitBuffer & ((1u << need) - 1);
+                bitBuffer >>= need;
+                bitCount -= need;
+
+                return value;
+            }
+
+            int decode(const Huffman& huffman)
+            {
+                int code = 0;
+                int first = 0;
+                int index = 0;
+
+                for (int length = 1; length < 16; length++)
+                {
+                    code |= static_cast<int>(bits(1));
+
+                    if (overrun)
+                        return -1;
+
+                    int count = huffman.counts[length];
+
+                    if (code - count < first)
+                        return huffman.symbols[index + (code - first)];
+
+                    index += count;
+                    first += count;
+                    first <<= 1;
+                    code <<= 1;
+                }
+
+                return -1;
+            }
+
+            bool stored()
+            {
+                bitBuffer = 0;
+                bitCount = 0;
+
+                if (inputPos + 4 > inputSize)
+                    return false;
+
+                uint32_t length = input[inputPos] | (input[inputPos + 1] << 8);
+                uint32_t inverse = input[inputPos + 2] | (input[inputPos + 3] << 8);
+                inputPos += 4;
+
+                if (length != (~inverse & 0xFFFF) || inputPos + length > inputSize || outputPos + length > outputSize)
+                    return false;
+
+                for (uint32_t i = 0; i < length; i++)
+                    output[outputPos++] = input[inputPos++];
+
+                return true;
+            }
+
+            bool codes(const Huffman& literals, const Huffman& distances)
+            {
+                while (true)
+                {
+                    int symbol = decode(literals);
+
+                    if (symbol < 0)
+                        return false;
+
+                    if (symbol < 256)
+                    {
+                        if (outputPos >= outputSize)
+                            return false;
+
+                        output[outputPos++] = static_cast<uint8_t>(symbol);
+                        continue;
+                    }
+
+                    if (symbol == 256)
+                        return true;
+
+                    symbol -= 257;
+
+                    if (symbol >= 29)
+                        return false;
+
+                    size_t length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+                    int distanceSymbol = decode(distances);
+
+                    if (distanceSymbol < 0 || distanceSymbol >= 30)
+                        return false;
+
+                    size_t distance = distanceBase[distanceSymbol] + bits(distanceExtra[distanceSymbol]);
+
+                    if (overrun || distance > outputPos || outputPos + length > outputSize)
+                        return false;
+
+                    // byte by byte on purpose, overlapping copies repeat the last distance bytes
+                    for (size_t i = 0; i < length; i++, outputPos++)
+                        output[outputPos] = output[outputPos - distance];
+                }
+            }
+
+            bool fixed()
+            {
+                static Huffman literals;
+                static Huffman distances;
+                static bool built = [&]()
+                {
+                    uint8_t lengths[288];
+                    int i = 0;
+
+                    for (; i < 144; i++)
+                        lengths[i] = 8;
+                    for (; i < 256; i++)
+                        lengths[i] = 9;
+                    for (; i < 280; i++)
+                        lengths[i] = 7;
+                    for (; i < 288; i++)
+                        lengths[i] = 8;
+
+                    literals.build(lengths, 288);
+
+                    for (i = 0; i < 30; i++)
+                        lengths[i] = 5;
+
+                    distances.build(lengths, 30);
+
+                    return true;
+                }();
+
+                return built && codes(literals, distances);
+            }
+
+            bool dynamic()
+            {
+                uint32_t literalCount = bits(5) + 257;
+                uint32_t distanceCount = bits(5) + 1;
+                uint32_t codeLengthCount = bits(4) + 4;
+
+                if (overrun || literalCount > 286 || distanceCount > 30)
+                    return false;
+
+                uint8_t lengths[320] = { 0 };
+
+                for (uint32_t i = 0; i < codeLengthCount; i++)
+                    lengths[codeLengthOrder[i]] = static_cast<uint8_t>(bits(3));
+
+                Huffman codeLengths;
+                codeLengths.build(lengths, 19);
+
+                uint32_t index = 0;
+
+                while (index < literalCount + distanceCount)
+                {
+                    int symbol = decode(codeLengths);
+
+                    if (symbol < 0)
+                        return false;
+
+                    if (symbol < 16)
+                    {
+                        lengths[index++] = static_cast<uint8_t>(symbol);
+                        continue;
+                    }
+
+                    uint8_t repeated = 0;
+                    uint32_t repeat = 0;
+
+                    if (symbol == 16)
+                    {
+                        if (index == 0)
+                            return false;
+
+                        repeated = lengths[index - 1];
+                        repeat = 3 + bits(2);
+                    }
+                    else if (symbol == 17)
+                        repeat = 3 + bits(3);
+                    else
+                        repeat = 11 + bits(7);
+
+                    if (overrun || index + repeat > literalCount + distanceCount)
+                        return false;
+
+                    while (repeat--)
+                        lengths[index++] = repeated;
+                }
+
+                Huffman literals;
+                Huffman distances;
+                literals.build(lengths, literalCount);
+                distances.build(lengths + literalCount, distanceCount);
+
+                return codes(literals, distances);
+            }
+        };
+    }
+
+    size_t zlibDecompress(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize)
+    {
+        // CM 8 (deflate), no preset dictionary, header checksum
+        if (inputSize < 2 || (input[0] & 0x0F) != 8 || (input[1] & 0x20) || ((input[0] << 8) | input[1]) % 31)
+            return 0;
+
+        Decoder decoder;
+        decoder.input = input + 2;
+        decoder.inputSize = inputSize - 2;
+        decoder.output = output;
+        decoder.outputSize = outputSize;
+
+        bool last = false;
+
+        while (!last)
+        {
+            last = decoder.bits(1) != 0;
+            uint32_t type = decoder.bits(2);
+            bool ok = false;
+
+            if (decoder.overrun)
+                return 0;
+
+            if (type == 0)
+                ok = decoder.stored();
+            else if (type == 1)
+                ok = decoder.fixed();
+            else if (type == 2)
+                ok = decoder.dynamic();
+
+            if (!ok)
+                return 0;
+        }
+
+        // the Adler-32 trailer isn't checked, archive entries already carry their sizes
+        return decoder.outputPos;
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Minimal zlib (RFC 1950/1951) decoder for compressed .dat archive entries, no zlib dependency.
+// Decodes straight into a caller provided buffer of the known uncompressed size.
+namespace Inflate
+{
+    // returns the number of bytes written, or 0 on malformed input or when output is too small
+    size_t zlibDecompress(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize);
+}
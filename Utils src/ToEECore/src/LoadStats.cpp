@@ -0,0 +1,168 @@
+#include "LoadStats.hpp"
+#include "Logger.hpp"
+
+#include <fstream>
+
+namespace
+{
+    thread_local uint64_t threadAllocations = 0;
+    thread_local uint64_t threadAllocatedBytes = 0;
+    thread_local uint64_t threadBytesRead = 0;
+
+    thread_local LoadStats::Report* currentReport = nullptr;
+    thread_local LoadStats::ScopedStage* currentStage = nullptr;
+
+    void (*stageBeginHook)(const char* name) = nullptr;
+    void (*stageEndHook)() = nullptr;
+
+    void writeJSONString(std::ofstream& file, const std::string& text)
+    {
+        file << '"';
+
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                file << '\\';
+
+            file << c;
+        }
+
+        file << '"';
+    }
+}
+
+namespace LoadStats
+{
+    Stage Report::total() const
+    {
+        Stage sum;
+        sum.name = "Total";
+
+        for (const auto& stage : stages)
+        {
+            sum.milliseconds += stage.milliseconds;
+            sum.bytesRead += stage.bytesRead;
+            sum.allocations += stage.allocations;
+            sum.allocatedBytes += stage.allocatedBytes;
+            sum.calls += stage.calls;
+        }
+
+        return sum;
+    }
+
+    Session::Session(Report& targetReport, const std::string& path) : report(targetReport), previous(currentReport), start(std::chrono::steady_clock::now())
+    {
+        report = Report();
+        report.path = path;
+        currentReport = &report;
+    }
+
+    Session::~Session()
+    {
+        report.totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        currentReport = previous;
+    }
+
+    ScopedStage::ScopedStage(const char* stageName) : name(stageName), parent(currentStage), start(std::chrono::steady_clock::now()),
+        bytesRead(threadBytesRead), allocations(threadAllocations), allocatedBytes(threadAllocatedBytes)
+    {
+        currentStage = this;
+
+        if (stageBeginHook)
+            stageBeginHook(name);
+    }
+
+    ScopedStage::~ScopedStage()
+    {
+        if (stageEndHook)
+            stageEndHook();
+
+        currentStage = parent;
+
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        uint64_t bytes = threadBytesRead - bytesRead;
+        uint64_t allocs = threadAllocations - allocations;
+        uint64_t allocBytes = threadAllocatedBytes - allocatedBytes;
+
+        if (parent)
+        {
+            parent->childMilliseconds += milliseconds;
+            parent->childBytesRead += bytes;
+            parent->childAllocations += allocs;
+            parent->childAllocatedBytes += allocBytes;
+        }
+
+        if (!currentReport)
+            return;
+
+        Stage* stage = nullptr;
+
+        for (auto& existing : currentReport->stages)
+        {
+            if (existing.name == name)
+            {
+                stage = &existing;
+                break;
+            }
+        }
+
+        if (!stage)
+        {
+            currentReport->stages.emplace_back();
+            stage = &currentReport->stages.back();
+            stage->name = name;
+        }
+
+        stage->milliseconds += milliseconds - childMilliseconds;
+        stage->bytesRead += bytes - childBytesRead;
+        stage->allocations += allocs - childAllocations;
+        stage->allocatedBytes += allocBytes - childAllocatedBytes;
+        stage->calls++;
+    }
+
+    void setStageHooks(void (*begin)(const char* name), void (*end)())
+    {
+        stageBeginHook = begin;
+        stageEndHook = end;
+    }
+
+    void addBytesRead(uint64_t bytes)
+    {
+        threadBytesRead += bytes;
+    }
+
+    void addAllocation(uint64_t bytes)
+    {
+        threadAllocations++;
+        threadAllocatedBytes += bytes;
+    }
+
+    bool writeJSON(const Report& report, const std::string& path)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+        if (!file)
+        {
+            LOG_ERROR << "[LoadStats] Failed to open " << path;
+            return false;
+        }
+
+        file << "{\n  \"path\": ";
+        writeJSONString(file, report.path);
+        file << ",\n  \"totalMs\": " << report.totalMilliseconds << ",\n  \"stages\": [";
+
+        for (size_t i = 0; i < report.stages.size(); i++)
+        {
+            const Stage& stage = report.stages[i];
+
+            file << (i ? ",\n" : "\n") << "    { \"name\": ";
+            writeJSONString(file, stage.name);
+            file << ", \"ms\": " << stage.milliseconds << ", \"calls\": " << stage.calls << ", \"bytesRead\": " << stage.bytesRead
+                << ", \"allocations\": " << stage.allocations << ", \"allocatedBytes\": " << stage.allocatedBytes << " }";
+        }
+
+        file << "\n  ]\n}\n";
+
+        return true;
+    }
+}
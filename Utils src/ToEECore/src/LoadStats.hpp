@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per stage timing of model loading: wall time, bytes read from disk and heap allocations.
+// Stages only record while a Session is open on the same thread, so loaders can stay instrumented everywhere.
+namespace LoadStats
+{
+    struct Stage
+    {
+        std::string name;
+        double milliseconds = 0.;
+        uint64_t bytesRead = 0;
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        uint32_t calls = 0;
+    };
+
+    struct Report
+    {
+        std::string path;
+        std::vector<Stage> stages;
+        double totalMilliseconds = 0.;
+
+        Stage total() const;
+    };
+
+    // collects every stage run on this thread into report until it goes out of scope
+    class Session
+    {
+    public:
+        Session(Report& report, const std::string& path);
+        ~Session();
+
+    private:
+        Report& report;
+        Report* previous;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // self cost of one stage, nested stages are subtracted and a repeated name is accumulated
+    class ScopedStage
+    {
+    public:
+        explicit ScopedStage(const char* name);
+        ~ScopedStage();
+
+    private:
+        const char* name;
+        ScopedStage* parent;
+        std::chrono::steady_clock::time_point start;
+        uint64_t bytesRead;
+        uint64_t allocations;
+        uint64_t allocatedBytes;
+
+        double childMilliseconds = 0.;
+        uint64_t childBytesRead = 0;
+        uint64_t childAllocations = 0;
+        uint64_t childAllocatedBytes = 0;
+    };
+
+    // called around every stage on the loading thread, e.g. to mirror stages into a frame profiler; set once at startup
+    void setStageHooks(void (*begin)(const char* name), void (*end)());
+
+    void addBytesRead(uint64_t bytes);
+
+    // called by the operator new in tracking/AllocationTracking.cpp, allocation counts stay zero in programs that don't link ToEEAllocationTracking
+    void addAllocation(uint64_t bytes);
+
+    bool writeJSON(const Report& report, const std::string& path);
+}
+
+#define LOAD_STAGE_CONCAT_IMPL(a, b) a##b
+#define LOAD_STAGE_CONCAT(a, b) LOAD_STAGE_CONCAT_IMPL(a, b)
+
+#define LOAD_STAGE(name) LoadStats::ScopedStage LOAD_STAGE_CONCAT(loadStage, __LINE__)(name)
@@ -0,0 +1,329 @@
+#include "Logger.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <unordered_map>
+
+static std::filesystem::path dirname = std::filesystem::path(__FILE__).parent_path();
+
+std::atomic<LogLevel> Logger::minLevel{ LOG_LEVEL_DEBUG };
+
+namespace
+{
+    // appends straight into the message string, so formatting reuses its capacity instead of allocating
+    class StringAppender : public std::streambuf
+    {
+    public:
+        std::string* target = nullptr;
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (ch != traits_type::eof())
+                target->push_back(static_cast<char>(ch));
+
+            return ch;
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize count) override
+        {
+            target->append(s, static_cast<size_t>(count));
+            return count;
+        }
+    };
+
+    struct ThreadStream
+    {
+        StringAppender buffer;
+        std::ostream stream;
+        std::string spare;
+
+        ThreadStream() : stream(&buffer) {}
+    };
+
+    thread_local ThreadStream threadStream;
+
+    const char* levelName(LogLevel level)
+    {
+        switch (level)
+        {
+            case LOG_LEVEL_DEBUG:
+                return "DEBUG";
+            case LOG_LEVEL_INFO:
+                return "INFO";
+            case LOG_LEVEL_WARN:
+                return "WARN";
+            default:
+                return "ERROR";
+        }
+    }
+
+    class LogWriter
+    {
+    public:
+        static LogWriter& instance()
+        {
+            static LogWriter writer;
+            return writer;
+        }
+
+        ~LogWriter()
+        {
+            stopping.store(true);
+            wakeCondition.notify_one();
+
+            if (thread.joinable())
+                thread.join();
+        }
+
+        bool allow(LogSite& site, uint32_t now)
+        {
+            if (site.level >= LOG_LEVEL_ERROR)
+                return true;
+
+            uint32_t start = site.windowStart.load(std::memory_order_relaxed);
+
+            if (start != now && site.windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+                site.windowCount.store(0, std::memory_order_relaxed);
+
+            if (site.windowCount.fetch_add(1, std::memory_order_relaxed) < rateLimit.load(std::memory_order_relaxed))
+                return true;
+
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+
+            // first suppression registers the site so the writer can report the count
+            bool expected = false;
+            if (site.registered.compare_exchange_strong(expected, true))
+            {
+                site.next = suppressedSites.load();
+                while (!suppressedSites.compare_exchange_weak(site.next, &site));
+            }
+
+            return false;
+        }
+
+        // bounded MPSC queue, each slot's sequence tells producers and the writer whose turn it is
+        void push(LogSite& site, std::time_t time, std::string& text)
+        {
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+            Slot* slot;
+
+            while (true)
+            {
+                slot = &slots[pos & (capacity - 1)];
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+                if (diff == 0)
+                {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {
+                    // full, let the writer catch up
+                    wakeCondition.notify_one();
+                    std::this_thread::yield();
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+                else
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+
+            slot->site = &site;
+            slot->time = time;
+            slot->text.swap(text);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+
+            if (site.level >= LOG_LEVEL_ERROR || pos - written.load(std::memory_order_relaxed) > capacity / 2)
+                wakeCondition.notify_one();
+        }
+
+        void flush()
+        {
+            size_t target = enqueuePos.load();
+
+            while (written.load(std::memory_order_acquire) < target)
+            {
+                wakeCondition.notify_one();
+                std::this_thread::yield();
+            }
+        }
+
+        void setRateLimit(uint32_t messagesPerSecond)
+        {
+            rateLimit.store(messagesPerSecond, std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr size_t capacity = 4096;
+
+        struct Slot
+        {
+            std::atomic<size_t> sequence{ 0 };
+            LogSite* site = nullptr;
+            std::time_t time = 0;
+            std::string text;
+        };
+
+        std::ofstream m_file;
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<size_t> enqueuePos{ 0 };
+        size_t dequeuePos = 0;
+        std::atomic<size_t> written{ 0 };
+
+        std::atomic<uint32_t> rateLimit{ 10 };
+        std::atomic<LogSite*> suppressedSites{ nullptr };
+
+        std::time_t cachedTime = -1;
+        char cachedStamp[16] = { 0 };
+        std::unordered_map<const char*, std::string> relativePaths;
+
+        std::thread thread;
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+        std::atomic<bool> stopping{ false };
+
+        LogWriter()
+        {
+            m_file.open("log.txt", std::ios::out);
+
+            slots = std::make_unique<Slot[]>(capacity);
+
+            for (size_t i = 0; i < capacity; i++)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+
+            thread = std::thread(&LogWriter::writerLoop, this);
+        }
+
+        void writerLoop()
+        {
+            while (true)
+            {
+                bool stop = stopping.load();
+                size_t count = drain();
+
+                reportSuppressed();
+
+                if (count)
+                    m_file.flush();
+
+                if (stop)
+                    break;
+
+                if (!count)
+                {
+                    std::unique_lock<std::mutex> lock(wakeMutex);
+                    wakeCondition.wait_for(lock, std::chrono::milliseconds(20));
+                }
+            }
+        }
+
+        size_t drain()
+        {
+            size_t count = 0;
+
+            while (true)
+            {
+                Slot& slot = slots[dequeuePos & (capacity - 1)];
+
+                if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+                    break;
+
+                writePrefix(*slot.site, slot.time);
+                m_file << slot.text << "\n";
+
+                slot.text.clear();
+                slot.sequence.store(dequeuePos + capacity, std::memory_order_release);
+                dequeuePos++;
+                count++;
+
+                written.store(dequeuePos, std::memory_order_release);
+            }
+
+            return count;
+        }
+
+        void reportSuppressed()
+        {
+            for (LogSite* site = suppressedSites.load(); site; site = site->next)
+            {
+                uint32_t count = site->suppressed.exchange(0, std::memory_order_relaxed);
+
+                if (!count)
+                    continue;
+
+                writePrefix(*site, std::time(nullptr));
+                m_file << "(" << count << " similar messages suppressed)\n";
+            }
+        }
+
+        void writePrefix(LogSite& site, std::time_t time)
+        {
+            // localtime only once per second
+            if (time != cachedTime)
+            {
+                cachedTime = time;
+                std::strftime(cachedStamp, sizeof(cachedStamp), "%H:%M:%S", std::localtime(&time));
+            }
+
+#ifndef NDEBUG
+            auto it = relativePaths.find(site.file);
+
+            if (it == relativePaths.end())
+                it = relativePaths.emplace(site.file, relProjectPath(site.file)).first;
+
+            m_file << "[" << levelName(site.level) << "][" << cachedStamp << "][" << it->second << ":" << site.line << "] ";
+#else
+            m_file << "[" << levelName(site.level) << "][" << cachedStamp << "] ";
+#endif
+        }
+    };
+}
+
+void Logger::setRateLimit(uint32_t messagesPerSecond)
+{
+    LogWriter::instance().setRateLimit(messagesPerSecond);
+}
+
+void Logger::flush()
+{
+    LogWriter::instance().flush();
+}
+
+LogMessage::LogMessage(LogSite& logSite) : site(logSite), time(std::time(nullptr))
+{
+    active = LogWriter::instance().allow(site, static_cast<uint32_t>(time));
+
+    // take over the thread's spare buffer, a nested LOG_* in an argument just starts with an empty one
+    if (active)
+        text.swap(threadStream.spare);
+}
+
+LogMessage::~LogMessage()
+{
+    if (!active)
+        return;
+
+    // the slot hands back the previous message's buffer, which becomes the next spare
+    LogWriter::instance().push(site, time, text);
+    text.clear();
+    threadStream.spare.swap(text);
+}
+
+std::ostream& LogMessage::stream()
+{
+    threadStream.buffer.target = &text;
+    return threadStream.stream;
+}
+
+std::string relProjectPath(std::string const& pathIn)
+{
+    return std::filesystem::relative(pathIn, dirname).string();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+#include <string>
+
+enum LogLevel : uint8_t
+{
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_NONE
+};
+
+// messages below this level are compiled out entirely
+#ifndef TOEE_LOG_MIN_LEVEL
+#define TOEE_LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+std::string relProjectPath(std::string const& pathIn);
+
+// one per LOG_* statement, keeps the rate limiting state of that call site.
+// Trivially destructible on purpose, the writer may still read it while statics are torn down.
+struct LogSite
+{
+    const char* file;
+    int line;
+    LogLevel level;
+
+    std::atomic<uint32_t> windowStart{ 0 };
+    std::atomic<uint32_t> windowCount{ 0 };
+    std::atomic<uint32_t> suppressed{ 0 };
+    std::atomic<bool> registered{ false };
+    LogSite* next = nullptr;
+
+    LogSite(const char* siteFile, int siteLine, LogLevel siteLevel) : file(siteFile), line(siteLine), level(siteLevel) {}
+};
+
+// Messages are formatted on the calling thread and handed to a background writer through a bounded lock-free MPSC ring,
+// so logging never waits on the disk and is safe from any thread.
+class Logger
+{
+public:
+    static bool isEnabled(LogLevel level) { return level >= minLevel.load(std::memory_order_relaxed); }
+    static void setLevel(LogLevel level) { minLevel.store(level, std::memory_order_relaxed); }
+
+    // messages per second a single WARN/INFO/DEBUG call site may emit, the rest is counted and reported once
+    static void setRateLimit(uint32_t messagesPerSecond);
+
+    // blocks until everything logged so far is in log.txt
+    static void flush();
+
+private:
+    static std::atomic<LogLevel> minLevel;
+};
+
+class LogMessage
+{
+public:
+    LogMessage(LogSite& site);
+    ~LogMessage();
+
+    LogMessage(const LogMessage&) = delete;
+    LogMessage& operator=(const LogMessage&) = delete;
+
+    template <typename T>
+    LogMessage& operator<<(T const& obj)
+    {
+        if (active)
+            stream() << obj;
+
+        return *this;
+    }
+
+private:
+    LogSite& site;
+    std::time_t time;
+    bool active;
+    std::string text;
+
+    std::ostream& stream();
+};
+
+// lets the macro be a single expression, & binds looser than << so the whole message is built first
+struct LogVoidify
+{
+    void operator&(const LogMessage&) {}
+};
+
+#define TOEE_LOG(level) \
+    !((level) >= TOEE_LOG_MIN_LEVEL && Logger::isEnabled(level)) ? (void)0 \
+    : LogVoidify() & LogMessage([]() -> LogSite& { static LogSite site(__FILE__, __LINE__, level); return site; }())
+
+#define LOG_DEBUG TOEE_LOG(LOG_LEVEL_DEBUG)
+#define LOG_ERROR TOEE_LOG(LOG_LEVEL_ERROR)
+#define LOG_INFO TOEE_LOG(LOG_LEVEL_INFO)
+#define LOG_WARN TOEE_LOG(LOG_LEVEL_WARN)
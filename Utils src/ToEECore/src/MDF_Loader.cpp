@@ -0,0 +1,496 @@
+#include "LoadStats.hpp"
+#include "Logger.hpp"
+#include "MDF_Loader.hpp"
+#include "VFS.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+namespace MDF
+{
+    enum Keyword : uint8_t
+    {
+        KEYWORD_UNKNOWN,
+        KEYWORD_TEXTURED,
+        KEYWORD_GENERAL,
+        KEYWORD_CLIPPER,
+        KEYWORD_HIGH_QUALITY,
+        KEYWORD_TEXTURE,
+        KEYWORD_UV_TYPE,
+        KEYWORD_BLEND_TYPE,
+        KEYWORD_SPEED_U,
+        KEYWORD_SPEED_V,
+        KEYWORD_SPEED,
+        KEYWORD_GLOSS_MAP,
+        KEYWORD_MATERIAL_BLEND_TYPE,
+        KEYWORD_SPECULAR_POWER,
+        KEYWORD_COLOR,
+        KEYWORD_SPECULAR
+    };
+
+    static char toLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    static bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    // lower has to be a lower case literal
+    static bool equalsLower(std::string_view text, std::string_view lower)
+    {
+        if (text.size() != lower.size())
+            return false;
+
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (toLower(text[i]) != lower[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    static std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && isSpace(s.front()))
+            s.remove_prefix(1);
+
+        while (!s.empty() && isSpace(s.back()))
+            s.remove_suffix(1);
+
+        return s;
+    }
+
+    static std::string_view stripQuotes(std::string_view s)
+    {
+        if (s.size() >= 2 && s.front() == '"' && s.back() == '"')
+            return s.substr(1, s.size() - 2);
+
+        return s;
+    }
+
+    // length and first letter pick the candidate, so every keyword costs at most one full comparison
+    static Keyword matchKeyword(std::string_view word)
+    {
+        if (word.empty())
+            return KEYWORD_UNKNOWN;
+
+        char first = toLower(word[0]);
+        char last = toLower(word.back());
+
+        switch (word.size())
+        {
+            case 5:
+                if (first == 'c')
+                    return equalsLower(word, "color") ? KEYWORD_COLOR : KEYWORD_UNKNOWN;
+                if (first == 's')
+                    return equalsLower(word, "speed") ? KEYWORD_SPEED : KEYWORD_UNKNOWN;
+                break;
+            case 6:
+                if (first == 'u')
+                    return equalsLower(word, "uvtype") ? KEYWORD_UV_TYPE : KEYWORD_UNKNOWN;
+                if (first == 's' && last == 'u')
+                    return equalsLower(word, "speedu") ? KEYWORD_SPEED_U : KEYWORD_UNKNOWN;
+                if (first == 's' && last == 'v')
+                    return equalsLower(word, "speedv") ? KEYWORD_SPEED_V : KEYWORD_UNKNOWN;
+                break;
+            case 7:
+                if (first == 'g')
+                    return equalsLower(word, "general") ? KEYWORD_GENERAL : KEYWORD_UNKNOWN;
+                if (first == 'c')
+                    return equalsLower(word, "clipper") ? KEYWORD_CLIPPER : KEYWORD_UNKNOWN;
+                if (first == 't')
+                    return equalsLower(word, "texture") ? KEYWORD_TEXTURE : KEYWORD_UNKNOWN;
+                break;
+            case 8:
+                if (first == 't')
+                    return equalsLower(word, "textured") ? KEYWORD_TEXTURED : KEYWORD_UNKNOWN;
+                if (first == 'g')
+                    return equalsLower(word, "glossmap") ? KEYWORD_GLOSS_MAP : KEYWORD_UNKNOWN;
+                if (first == 's')
+                    return equalsLower(word, "specular") ? KEYWORD_SPECULAR : KEYWORD_UNKNOWN;
+                break;
+            case 9:
+                if (first == 'b')
+                    return equalsLower(word, "blendtype") ? KEYWORD_BLEND_TYPE : KEYWORD_UNKNOWN;
+                break;
+            case 11:
+                if (first == 'h')
+                    return equalsLower(word, "highquality") ? KEYWORD_HIGH_QUALITY : KEYWORD_UNKNOWN;
+                break;
+            case 13:
+                if (first == 's')
+                    return equalsLower(word, "specularpower") ? KEYWORD_SPECULAR_POWER : KEYWORD_UNKNOWN;
+                break;
+            case 17:
+                if (first == 'm')
+                    return equalsLower(word, "materialblendtype") ? KEYWORD_MATERIAL_BLEND_TYPE : KEYWORD_UNKNOWN;
+                break;
+        }
+
+        return KEYWORD_UNKNOWN;
+    }
+
+    template <typename T>
+    static bool parseNumber(std::string_view token, T& value)
+    {
+        return std::from_chars(token.data(), token.data() + token.size(), value).ec == std::errc();
+    }
+
+    // floating point from_chars is missing from older libc++, strtof needs the token null terminated there
+    static bool parseNumber(std::string_view token, float& value)
+    {
+#if defined(__cpp_lib_to_chars)
+        return std::from_chars(token.data(), token.data() + token.size(), value).ec == std::errc();
+#else
+        char buffer[64];
+
+        if (token.size() >= sizeof(buffer))
+            return false;
+
+        std::memcpy(buffer, token.data(), token.size());
+        buffer[token.size()] = '\0';
+
+        char* end = nullptr;
+        errno = 0;
+        float parsed = std::strtof(buffer, &end);
+
+        if (end == buffer || errno == ERANGE)
+            return false;
+
+        value = parsed;
+        return true;
+#endif
+    }
+
+    // whitespace separated tokens of one line, numbers are parsed in place
+    struct LineTokens
+    {
+        std::string_view rest;
+
+        std::string_view next()
+        {
+            size_t start = 0;
+
+            while (start < rest.size() && isSpace(rest[start]))
+                start++;
+
+            size_t end = start;
+
+            while (end < rest.size() && !isSpace(rest[end]))
+                end++;
+
+            std::string_view token = rest.substr(start, end - start);
+            rest.remove_prefix(end);
+
+            return token;
+        }
+
+        template <typename T>
+        bool next(T& value)
+        {
+            std::string_view token = next();
+
+            if (!token.empty() && token.front() == '+')
+                token.remove_prefix(1);
+
+            return !token.empty() && parseNumber(token, value);
+        }
+
+        std::string_view remainder() const
+        {
+            return trim(rest);
+        }
+    };
+
+    // missing components are 0, not the color's defaults
+    template <typename Color>
+    static void readColor(LineTokens& line, Color& out)
+    {
+        uint32_t rgba[4] = { 0, 0, 0, 0 };
+
+        for (int i = 0; i < 4; i++)
+        {
+            if (!line.next(rgba[i]))
+                break;
+        }
+
+        out.r = static_cast<uint8_t>(rgba[0]);
+        out.g = static_cast<uint8_t>(rgba[1]);
+        out.b = static_cast<uint8_t>(rgba[2]);
+        out.a = static_cast<uint8_t>(rgba[3]);
+    }
+
+    void MDFFile::assignTexturePath(int layer, std::string_view rootPath, std::string_view path)
+    {
+        if (layer < 0 || layer > 3)
+            return;
+
+        std::string& target = texturePath[layer];
+        target.assign(rootPath.data(), rootPath.size()).append(path.data(), path.size());
+
+        std::replace(target.begin(), target.end(), '\\', '/');
+
+        if (layer + 1 > textureCount)
+        {
+            textureCount = static_cast<uint8_t>(layer + 1);
+        }
+    }
+
+    void MDFFile::checkAndSetRenderFlag(std::string_view keyword)
+    {
+        if (equalsLower(keyword, "double"))
+            renderFlags |= RENDER_FLAG_DOUBLE;
+        else if (equalsLower(keyword, "linearfiltering"))
+            renderFlags |= RENDER_FLAG_LINEAR_FILTERING;
+        else if (equalsLower(keyword, "recalculatenormals"))
+            renderFlags |= RENDER_FLAG_RECALCULATE_NORMALS;
+        else if (equalsLower(keyword, "zfillonly"))
+            renderFlags |= RENDER_FLAG_Z_FILL_ONLY;
+        else if (equalsLower(keyword, "colorfillonly"))
+            renderFlags |= RENDER_FLAG_COLOR_FILL_ONLY;
+        else if (equalsLower(keyword, "notlit"))
+            renderFlags |= RENDER_FLAG_NOT_LIT;
+        else if (equalsLower(keyword, "disablez"))
+            renderFlags |= RENDER_FLAG_DISABLE_Z;
+    }
+
+    void MDFFile::setBlendType(int layer, std::string_view typeStr)
+    {
+        if (layer < 0 || layer > 3)
+            return;
+
+        if (equalsLower(typeStr, "modulate"))
+            blendType[layer] = BLEND_TYPE_MODULATE;
+        else if (equalsLower(typeStr, "add"))
+            blendType[layer] = BLEND_TYPE_ADD;
+        else if (equalsLower(typeStr, "texturealpha"))
+            blendType[layer] = BLEND_TYPE_TEXTURE_ALPHA;
+        else if (equalsLower(typeStr, "currentalpha"))
+            blendType[layer] = BLEND_TYPE_CURRENT_ALPHA;
+        else if (equalsLower(typeStr, "currentalphaadd"))
+            blendType[layer] = BLEND_TYPE_CURRENT_ALPHA_ADD;
+    }
+
+    void MDFFile::setMaterialBlendType(std::string_view typeStr)
+    {
+        if (equalsLower(typeStr, "none"))
+            materialBlendType = MATERIAL_BLEND_TYPE_NONE;
+        else if (equalsLower(typeStr, "alpha"))
+            materialBlendType = MATERIAL_BLEND_TYPE_ALPHA;
+        else if (equalsLower(typeStr, "add"))
+            materialBlendType = MATERIAL_BLEND_TYPE_ADD;
+        else if (equalsLower(typeStr, "alphaadd"))
+            materialBlendType = MATERIAL_BLEND_TYPE_ALPHA_ADD;
+    }
+
+    void MDFFile::setUVType(int layer, std::string_view typeStr)
+    {
+        if (layer < 0 || layer > 3)
+            return;
+
+        if (equalsLower(typeStr, "mesh"))
+            uvType[layer] = UV_TYPE_MESH;
+        else if (equalsLower(typeStr, "environment"))
+            uvType[layer] = UV_TYPE_ENVIRONMENT;
+        else if (equalsLower(typeStr, "drift"))
+            uvType[layer] = UV_TYPE_DRIFT;
+        else if (equalsLower(typeStr, "swirl"))
+            uvType[layer] = UV_TYPE_SWIRL;
+        else if (equalsLower(typeStr, "wavey"))
+            uvType[layer] = UV_TYPE_WAVEY;
+    }
+
+    void MDFFile::setSpeed(int layer, float u, float v)
+    {
+        if (layer < 0 || layer > 3)
+            return;
+
+        speedU[layer] = u * 60.f;
+        speedV[layer] = v * 60.f;
+    }
+
+    // one pass over the file buffer, nothing is copied except the texture paths that end up in the material
+    bool MDFFile::parseMDFFile(const std::string& rootPath, const std::string& materialPath)
+    {
+        LOAD_STAGE("MDF parse");
+
+        VFS::File file(rootPath + materialPath);
+
+        if (!file)
+            return false;
+
+        LoadStats::addBytesRead(file.size());
+
+        std::string_view text(file.data(), file.size());
+
+        while (!text.empty())
+        {
+            size_t lineEnd = text.find('\n');
+            LineTokens line = { text.substr(0, lineEnd) };
+            text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+
+            std::string_view keyword = line.next();
+
+            if (keyword.empty())
+                continue;
+
+            switch (matchKeyword(keyword))
+            {
+                case KEYWORD_TEXTURED:
+                    materialType = MATERIAL_TYPE_TEXTURED;
+                    break;
+                case KEYWORD_GENERAL:
+                    materialType = MATERIAL_TYPE_GENERAL;
+                    break;
+                case KEYWORD_CLIPPER:
+                    materialType = MATERIAL_TYPE_CLIPPER;
+                    break;
+                case KEYWORD_HIGH_QUALITY:
+                    break;
+                case KEYWORD_TEXTURE:
+                {
+                    // Texture "path" is layer 0, Texture <layer> "path" otherwise, quotes are optional
+                    int layer = 0;
+                    std::string_view path = line.remainder();
+
+                    if (!path.empty() && path.front() != '"')
+                    {
+                        LineTokens layerToken = line;
+
+                        if (layerToken.next(layer))
+                            path = layerToken.remainder();
+                    }
+
+                    assignTexturePath(layer, rootPath, trim(stripQuotes(path)));
+                    break;
+                }
+                case KEYWORD_UV_TYPE:
+                {
+                    int layer = 0;
+
+                    if (line.next(layer))
+                        setUVType(layer, line.next());
+                    break;
+                }
+                case KEYWORD_BLEND_TYPE:
+                {
+                    int layer = 0;
+
+                    if (line.next(layer))
+                        setBlendType(layer, line.next());
+                    break;
+                }
+                case KEYWORD_SPEED_U:
+                case KEYWORD_SPEED_V:
+                {
+                    int layer = 0;
+                    float value = 0.f;
+
+                    // setting one direction resets the other, as it always has
+                    if (line.next(layer) && line.next(value))
+                    {
+                        if (toLower(keyword.back()) == 'u')
+                            setSpeed(layer, value, 0.f);
+                        else
+                            setSpeed(layer, 0.f, value);
+                    }
+                    break;
+                }
+                case KEYWORD_SPEED:
+                {
+                    float value = 0.f;
+
+                    if (line.next(value))
+                    {
+                        for (int i = 0; i < 4; i++)
+                            setSpeed(i, value, value);
+                    }
+                    break;
+                }
+                case KEYWORD_GLOSS_MAP:
+                {
+                    // a quoted path may contain spaces, an unquoted one ends at the first
+                    std::string_view path = line.remainder();
+
+                    if (!path.empty() && path.front() == '"')
+                        path = path.substr(1, path.find('"', 1) - 1);
+                    else
+                        path = line.next();
+
+                    glossMap.assign(rootPath).append(path.data(), path.size());
+                    break;
+                }
+                case KEYWORD_MATERIAL_BLEND_TYPE:
+                    setMaterialBlendType(line.next());
+                    break;
+                case KEYWORD_SPECULAR_POWER:
+                    line.next(specularPower);
+                    break;
+                case KEYWORD_COLOR:
+                    readColor(line, color);
+                    break;
+                case KEYWORD_SPECULAR:
+                    readColor(line, specular);
+                    break;
+                case KEYWORD_UNKNOWN:
+                    checkAndSetRenderFlag(keyword);
+                    break;
+            }
+        }
+
+        return true;
+    }
+
+    void MDFFile::debugPrint() const
+    {
+        LOG_DEBUG << "Material type: " << (int)materialType;
+
+        for (int i = 0; i < 4; i++)
+        {
+            LOG_DEBUG << "Texture" << i << ": " << texturePath[i];
+            LOG_DEBUG << "UVType" << i << ": " << (int)uvType[i];
+            LOG_DEBUG << "BlendType" << i << ": " << (int)blendType[i];
+            LOG_DEBUG << "SpeedU" << i << ": " << speedU[i];
+            LOG_DEBUG << "SpeedV" << i << ": " << speedV[i];
+        }
+
+        LOG_DEBUG << "Gloss texture: " << glossMap;
+        LOG_DEBUG << "Color: " << (unsigned int)color.r << " " << (unsigned int)color.g << " " << (unsigned int)color.b << " " << (unsigned int)color.a;
+        LOG_DEBUG << "Specular: " << (unsigned int)specular.r << " " << (unsigned int)specular.g << " " << (unsigned int)specular.b << " " << (unsigned int)specular.a;
+        LOG_DEBUG << "Specular power: " << specularPower;
+        LOG_DEBUG << "Material blend type: " << (unsigned int)materialBlendType;
+        LOG_DEBUG << "Render flags: " << (unsigned int)renderFlags;
+        LOG_DEBUG << "Texture count: " << (unsigned int)textureCount;
+    }
+
+    ColorRGBAFloat toRGBAFloat(ColorRGBA color)
+    {
+        ColorRGBAFloat tempColor;
+
+        tempColor.r = (float)color.r / 255.f;
+        tempColor.g = (float)color.g / 255.f;
+        tempColor.b = (float)color.b / 255.f;
+        tempColor.a = (float)color.a / 255.f;
+
+        return tempColor;
+    }
+
+    ColorRGBAFloat toRGBAFloat(SpecularRGBA color)
+    {
+        ColorRGBAFloat tempColor;
+
+        tempColor.r = (float)color.r / 255.f;
+        tempColor.g = (float)color.g / 255.f;
+        tempColor.b = (float)color.b / 255.f;
+        tempColor.a = (float)color.a / 255.f;
+
+        return tempColor;
+    }
+}
@@ -1,8 +1,8 @@
 #pragma once
 
-#include <glad/glad.h>
-
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace MDF
 {
@@ -40,14 +40,12 @@ namespace MDF
 		float speedV[4] = { 0.f };
 		ColorRGBA color;
 		SpecularRGBA specular; // doesn't seem to exist in any existing material file, glossMap texture is used instead
-		float specularPower;
+		float specularPower = 0.f;
 		uint8_t materialBlendType = 1;
 		uint8_t renderFlags = 0;
 		uint8_t textureCount = 0; // seems like valid count is 0-4
 		uint8_t materialType = 0;
 
-		GLuint textureIDs[4] = { 0 };
-
 		enum UVType : uint8_t
 		{
 			UV_TYPE_MESH = 0, // default
@@ -93,11 +91,11 @@ namespace MDF
 			MATERIAL_TYPE_CLIPPER = 2
 		};
 
-		void assignTexturePath(int layer, const std::string& path);
-		void checkAndSetRenderFlag(const std::string& keyword);
-		void setBlendType(int layer, const std::string& typeStr);
-		void setMaterialBlendType(const std::string& typeStr);
-		void setUVType(int layer, const std::string& typeStr);
+		void assignTexturePath(int layer, std::string_view rootPath, std::string_view path);
+		void checkAndSetRenderFlag(std::string_view keyword);
+		void setBlendType(int layer, std::string_view typeStr);
+		void setMaterialBlendType(std::string_view typeStr);
+		void setUVType(int layer, std::string_view typeStr);
 		void setSpeed(int layer, float u, float v);
 
 		bool parseMDFFile(const std::string& rootPath, const std::string& materialPath);
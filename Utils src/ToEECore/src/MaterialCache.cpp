@@ -0,0 +1,146 @@
+#include "Logger.hpp"
+#include "MaterialCache.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+namespace MDF
+{
+    static std::string normalize(const std::string& path)
+    {
+        std::string result = path;
+
+        for (char& c : result)
+            c = c == '\\' ? '/' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+        return result;
+    }
+
+    // live entry for key, an expired one is erased
+    template <typename T>
+    static std::shared_ptr<const T> lookup(std::unordered_map<std::string, std::weak_ptr<const T>>& map, const std::string& key)
+    {
+        auto found = map.find(key);
+
+        if (found == map.end())
+            return nullptr;
+
+        if (auto existing = found->second.lock())
+            return existing;
+
+        map.erase(found);
+        return nullptr;
+    }
+
+    // entries nobody asks for again would stay forever, so sweep them before the map outgrows twice its live size
+    template <typename T>
+    static void insert(std::unordered_map<std::string, std::weak_ptr<const T>>& map, const std::string& key, const std::shared_ptr<const T>& value, size_t& sweepSize)
+    {
+        if (map.size() >= sweepSize)
+        {
+            for (auto it = map.begin(); it != map.end();)
+                it = it->second.expired() ? map.erase(it) : std::next(it);
+
+            sweepSize = std::max<size_t>(64, map.size() * 2);
+        }
+
+        map[key] = value;
+    }
+
+    MaterialCache& MaterialCache::get()
+    {
+        static MaterialCache cache;
+        return cache;
+    }
+
+    // parsing happens outside the lock, if another thread finished the same file first its copy wins and ours is dropped
+    MaterialRef MaterialCache::acquire(const std::string& rootPath, const std::string& materialPath)
+    {
+        std::string key = normalize(rootPath + materialPath);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (MaterialRef existing = lookup(materials, key))
+            {
+                stats.materialsShared++;
+                return existing;
+            }
+        }
+
+        auto material = std::make_shared<Material>();
+
+        // a broken file gets an empty material of its own, not cached so the next load tries again
+        if (!material->parseMDFFile(rootPath, materialPath))
+        {
+            LOG_ERROR << "Failed to parse material file: " << materialPath;
+            return material;
+        }
+
+        for (int i = 0; i < material->textureCount; i++)
+            material->textures[i] = acquireTexture(material->texturePath[i]);
+
+        if (!material->glossMap.empty())
+            material->gloss = acquireTexture(material->glossMap);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (MaterialRef existing = lookup(materials, key))
+            return existing;
+
+        insert<Material>(materials, key, material, materialSweepSize);
+        stats.materialsParsed++;
+
+        return material;
+    }
+
+    std::shared_ptr<const TGA::TGAImage> MaterialCache::acquireTexture(const std::string& path)
+    {
+        std::string key = normalize(path);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (auto existing = lookup(textures, key))
+            {
+                stats.texturesShared++;
+                return existing;
+            }
+        }
+
+        auto image = std::make_shared<TGA::TGAImage>();
+
+        if (!TGA::loadTGA(path, *image))
+        {
+            LOG_ERROR << "Failed to load TGA: " << path;
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (auto existing = lookup(textures, key))
+            return existing;
+
+        insert<TGA::TGAImage>(textures, key, image, textureSweepSize);
+        stats.texturesDecoded++;
+
+        return image;
+    }
+
+    void MaterialCache::invalidate()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        materials.clear();
+        textures.clear();
+        materialSweepSize = 64;
+        textureSweepSize = 64;
+    }
+
+    MaterialCache::Stats MaterialCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+}
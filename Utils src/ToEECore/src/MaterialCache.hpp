@@ -0,0 +1,56 @@
+#pragma once
+
+#include "MDF_Loader.hpp"
+#include "TGA_Loader.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace MDF
+{
+    // parsed MDF with its decoded textures, never modified once built so meshes can share it freely
+    struct Material : MDFFile
+    {
+        std::shared_ptr<const TGA::TGAImage> textures[4]; // null when the file is missing or not a supported TGA
+        std::shared_ptr<const TGA::TGAImage> gloss;
+    };
+
+    using MaterialRef = std::shared_ptr<const Material>;
+
+    // Process wide registry keyed by normalized path, so every MDF and TGA is parsed once no matter how many models use it.
+    // Entries are weak: a material and its textures are freed together with the last mesh referencing them, the expired
+    // entries are dropped when looked up again or swept whenever a map has doubled since the last sweep.
+    class MaterialCache
+    {
+    public:
+        struct Stats
+        {
+            uint64_t materialsParsed = 0;
+            uint64_t materialsShared = 0;
+            uint64_t texturesDecoded = 0;
+            uint64_t texturesShared = 0;
+        };
+
+        static MaterialCache& get();
+
+        MaterialRef acquire(const std::string& rootPath, const std::string& materialPath);
+
+        // forgets every entry so the next acquire reads the files again, materials already handed out stay valid
+        void invalidate();
+
+        Stats getStats() const;
+
+    private:
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::weak_ptr<const Material>> materials;
+        std::unordered_map<std::string, std::weak_ptr<const TGA::TGAImage>> textures;
+        size_t materialSweepSize = 64;
+        size_t textureSweepSize = 64;
+        Stats stats;
+
+        std::shared_ptr<const TGA::TGAImage> acquireTexture(const std::string& path);
+    };
+}
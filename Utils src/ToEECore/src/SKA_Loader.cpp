@@ -0,0 +1,338 @@
+#include "LoadStats.hpp"
+#include "Logger.hpp"
+#include "SKA_Loader.hpp"
+#include "VFS.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // Keyframe stream, starts dataOffset bytes after its animation header:
+    //   float scaleFactor, float translationFactor
+    //   keys at frame 0 until a bone index of -2: int16 bone, then scale, rotation and translation
+    //   later keys, a uint16 header each:
+    //     bit 0 set: frame marker, the keys up to the next marker are at frame header >> 1, a frame past frameCount ends
+    //     the stream
+    //     otherwise: bone header >> 4, followed by the channels flagged by bit 3 (scale), bit 2 (rotation) and bit 1 (translation)
+    // Every channel is int16 frame of the bone's next key for it, then int16 components: scale xyz * scaleFactor,
+    // rotation xyzw / 32767 and translation xyz * translationFactor. The engine needs the next key frame to know when
+    // to read on, with whole key lists it is redundant.
+    class StreamReader
+    {
+    public:
+        StreamReader(const char* data, size_t size) : data(data), size(size) {}
+
+        template <typename T>
+        bool read(T& value)
+        {
+            if (size - position < sizeof(T))
+            {
+                failed = true;
+                return false;
+            }
+
+            std::memcpy(&value, data + position, sizeof(T));
+            position += sizeof(T);
+            return true;
+        }
+
+        bool readVec3(float factor, glm::vec3& value)
+        {
+            int16_t nextFrame, x, y, z;
+
+            if (!read(nextFrame) || !read(x) || !read(y) || !read(z))
+                return false;
+
+            value = glm::vec3(x * factor, y * factor, z * factor);
+            return true;
+        }
+
+        bool readQuat(glm::quat& value)
+        {
+            int16_t nextFrame, x, y, z, w;
+
+            if (!read(nextFrame) || !read(x) || !read(y) || !read(z) || !read(w))
+                return false;
+
+            value = glm::normalize(glm::quat(w / 32767.f, x / 32767.f, y / 32767.f, z / 32767.f));
+            return true;
+        }
+
+        size_t remaining() const { return size - position; }
+        size_t getPosition() const { return position; }
+        bool hasFailed() const { return failed; }
+
+    private:
+        const char* data;
+        size_t size;
+        size_t position = 0;
+        bool failed = false;
+    };
+
+    template <typename T, typename Blend>
+    T sampleKeys(const std::vector<SKA::Key<T>>& keys, float frame, const T& rest, Blend blend)
+    {
+        if (keys.empty())
+            return rest;
+
+        auto next = std::upper_bound(keys.begin(), keys.end(), frame, [](float value, const SKA::Key<T>& key) { return value < key.frame; });
+
+        // before the first key or after the last one the nearest key holds
+        if (next == keys.begin())
+            return next->value;
+
+        auto previous = next - 1;
+
+        if (next == keys.end())
+            return previous->value;
+
+        return blend(previous->value, next->value, (frame - previous->frame) / float(next->frame - previous->frame));
+    }
+
+    template <typename T>
+    void sortKeys(std::vector<SKA::Key<T>>& keys)
+    {
+        std::stable_sort(keys.begin(), keys.end(), [](const SKA::Key<T>& a, const SKA::Key<T>& b) { return a.frame < b.frame; });
+    }
+}
+
+namespace SKA
+{
+    bool SKAFile::loadFromFile(const std::string& path)
+    {
+        LOAD_STAGE("SKA parse");
+
+        clear();
+        this->path = path;
+
+        VFS::File file(path);
+        if (!file) {
+            LOG_ERROR << "[SKA] Failed to open file: " << path;
+            return false;
+        }
+
+        file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+        LoadStats::addBytesRead(file.gcount());
+        if (!file)
+        {
+            LOG_ERROR << "[SKM] Failed to read header.";
+            return false;
+        }
+
+        file.seekg(header.boneDataOffset);
+        boneData.resize(header.boneCount);
+        file.read(reinterpret_cast<char*>(boneData.data()), boneData.size() * sizeof(BoneData));
+        LoadStats::addBytesRead(file.gcount());
+
+        file.seekg(header.animDataOffset);
+        animHeaderData.resize(header.animCount);
+        file.read(reinterpret_cast<char*>(animHeaderData.data()), animHeaderData.size() * sizeof(AnimationHeader));
+        LoadStats::addBytesRead(file.gcount());
+
+        int16_t animEventCount = computeAnimEventCount();
+        if (animEventCount)
+        {
+            uint32_t animEventDataOffset = sizeof(Header) + (boneData.size() * sizeof(BoneData)) + (animHeaderData.size() * sizeof(AnimationHeader));
+            animEventData.resize(animEventCount);
+            file.read(reinterpret_cast<char*>(animEventData.data()), animEventData.size() * sizeof(AnimationEvent));
+            LoadStats::addBytesRead(file.gcount());
+        }
+
+        computeTransforms();
+
+        return true;
+    }
+
+    bool SKAFile::loadClip(size_t index, AnimationClip& clip) const
+    {
+        LOAD_STAGE("SKA keyframes");
+
+        clip = AnimationClip();
+
+        if (index >= animHeaderData.size())
+        {
+            LOG_ERROR << "[SKA] " << path << " has no animation " << index;
+            return false;
+        }
+
+        const AnimationHeader& animation = animHeaderData[index];
+        clip.name.assign(animation.name, strnlen(animation.name, sizeof(animation.name)));
+
+        if (animation.streamCount < 1)
+        {
+            LOG_ERROR << "[SKA] " << path << ": " << clip.name << " has no keyframe stream.";
+            return false;
+        }
+
+        const AnimationStreamHeader& stream = animation.streamHeaderData[0];
+        clip.frameCount = std::max<int16_t>(stream.frameCount, 1);
+        clip.frameRate = stream.frameRate > 0.f ? stream.frameRate : 30.f;
+        clip.loopable = animation.loopable != 0;
+        clip.bones.resize(boneData.size());
+
+        VFS::File file(path);
+        if (!file)
+        {
+            LOG_ERROR << "[SKA] Failed to open file: " << path;
+            return false;
+        }
+
+        size_t start = header.animDataOffset + index * sizeof(AnimationHeader) + stream.dataOffset;
+        if (start >= file.size())
+        {
+            LOG_ERROR << "[SKA] " << path << ": keyframe stream of " << clip.name << " is past the end of the file.";
+            return false;
+        }
+
+        StreamReader reader(file.data() + start, file.size() - start);
+        float scaleFactor = 0.f, translationFactor = 0.f;
+        reader.read(scaleFactor);
+        reader.read(translationFactor);
+
+        auto trackOf = [&](int bone) -> BoneTrack*
+        {
+            if (bone < 0 || bone >= static_cast<int>(clip.bones.size()))
+            {
+                LOG_ERROR << "[SKA] " << path << ": " << clip.name << " has keys for bone " << bone << ", the skeleton has " << clip.bones.size();
+                return nullptr;
+            }
+
+            return &clip.bones[bone];
+        };
+
+        int16_t bone = 0;
+        while (reader.read(bone) && bone != -2)
+        {
+            BoneTrack* track = trackOf(bone);
+            if (!track)
+                return false;
+
+            Key<glm::vec3> scale, position;
+            Key<glm::quat> rotation;
+
+            if (!reader.readVec3(scaleFactor, scale.value) || !reader.readQuat(rotation.value) || !reader.readVec3(translationFactor, position.value))
+                break;
+
+            track->scale.push_back(scale);
+            track->rotation.push_back(rotation);
+            track->position.push_back(position);
+        }
+
+        int16_t frame = 0;
+        uint16_t keyHeader = 0;
+
+        while (!reader.hasFailed() && reader.remaining() && reader.read(keyHeader))
+        {
+            if (keyHeader & 1)
+            {
+                frame = static_cast<int16_t>(keyHeader >> 1);
+
+                if (frame > clip.frameCount)
+                    break;
+
+                continue;
+            }
+
+            BoneTrack* track = trackOf(keyHeader >> 4);
+            if (!track)
+                return false;
+
+            if (keyHeader & 8)
+            {
+                Key<glm::vec3> key = { frame };
+                if (reader.readVec3(scaleFactor, key.value))
+                    track->scale.push_back(key);
+            }
+
+            if (keyHeader & 4)
+            {
+                Key<glm::quat> key = { frame };
+                if (reader.readQuat(key.value))
+                    track->rotation.push_back(key);
+            }
+
+            if (keyHeader & 2)
+            {
+                Key<glm::vec3> key = { frame };
+                if (reader.readVec3(translationFactor, key.value))
+                    track->position.push_back(key);
+            }
+        }
+
+        LoadStats::addBytesRead(reader.getPosition());
+
+        if (reader.hasFailed())
+        {
+            LOG_ERROR << "[SKA] " << path << ": keyframe stream of " << clip.name << " is truncated.";
+            return false;
+        }
+
+        // markers should only go forward, but sampling relies on it
+        for (auto& track : clip.bones)
+        {
+            sortKeys(track.scale);
+            sortKeys(track.rotation);
+            sortKeys(track.position);
+        }
+
+        return true;
+    }
+
+    void AnimationClip::sample(float frame, const std::vector<BoneTransform>& rest, std::vector<BoneTransform>& out) const
+    {
+        out.resize(rest.size());
+
+        auto lerp = [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); };
+        auto slerp = [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); };
+
+        for (size_t i = 0; i < rest.size(); i++)
+        {
+            if (i >= bones.size())
+            {
+                out[i] = rest[i];
+                continue;
+            }
+
+            const BoneTrack& track = bones[i];
+            out[i].scale = sampleKeys(track.scale, frame, rest[i].scale, lerp);
+            out[i].rotation = sampleKeys(track.rotation, frame, rest[i].rotation, slerp);
+            out[i].position = sampleKeys(track.position, frame, rest[i].position, lerp);
+        }
+    }
+
+    void SKAFile::computeTransforms()
+    {
+        boneTransforms.reserve(boneData.size());
+
+        for (const auto& bone : boneData)
+        {
+            BoneTransform transform = { };
+            transform.scale = glm::vec3(bone.scale.x, bone.scale.y, bone.scale.z);
+            transform.rotation = glm::quat(bone.rotQuaternions.w, bone.rotQuaternions.x, bone.rotQuaternions.y, bone.rotQuaternions.z);
+            transform.position = glm::vec3(bone.position.x, bone.position.y, bone.position.z);
+            boneTransforms.push_back(transform);
+        }
+    }
+
+    int16_t SKAFile::computeAnimEventCount()
+    {
+        int16_t temp = 0;
+
+        for (const auto& anim : animHeaderData)
+            temp += anim.eventCount;
+
+        return temp;
+    }
+
+    void SKAFile::clear()
+    {
+        header = { };
+        path.clear();
+        boneData.resize(0);
+        boneTransforms.resize(0);
+        animHeaderData.resize(0);
+        animEventData.resize(0);
+    }
+}
@@ -82,6 +82,34 @@ namespace SKA
         glm::vec3 position;
     };
 
+    template <typename T>
+    struct Key
+    {
+        int16_t frame = 0;
+        T value;
+    };
+
+    // keys of one bone sorted by frame, empty channels keep the rest pose
+    struct BoneTrack
+    {
+        std::vector<Key<glm::vec3>> scale;
+        std::vector<Key<glm::quat>> rotation;
+        std::vector<Key<glm::vec3>> position;
+    };
+
+    // First stream of one animation decoded into key lists, so any frame can be sampled on its own (and from any thread)
+    struct AnimationClip
+    {
+        std::string name;
+        int16_t frameCount = 0;
+        float frameRate = 30.f;
+        bool loopable = false;
+        std::vector<BoneTrack> bones; // indexed like SKAFile::boneData
+
+        // local transforms at frame, fractional frames interpolate between keys, rest is used for bones without keys
+        void sample(float frame, const std::vector<BoneTransform>& rest, std::vector<BoneTransform>& out) const;
+    };
+
     struct SKAFile
     {
         Header header = { };
@@ -91,9 +119,15 @@ namespace SKA
 
         std::vector<BoneTransform> boneTransforms;
 
+        std::string path;
+
         bool loadFromFile(const std::string& path);
+
+        // reads the keyframe stream of animation index from path again, only headers are kept after loading
+        bool loadClip(size_t index, AnimationClip& clip) const;
+
         void computeTransforms();
         int16_t computeAnimEventCount();
-        void SKAFile::clear();
+        void clear();
     };
 }
@@ -0,0 +1,475 @@
+#include "Logger.hpp"
+#include "SKA_Writer.hpp"
+#include "VFS.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace
+{
+    const int maxStreams = 10;
+
+    template <typename T>
+    void writeArray(std::ostream& stream, const std::vector<T>& values)
+    {
+        stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    std::string nameOf(const SKA::AnimationHeader& header)
+    {
+        return std::string(header.name, strnlen(header.name, sizeof(header.name)));
+    }
+
+    std::string boneName(const SKA::BoneData& bone)
+    {
+        return std::string(bone.boneName, strnlen(bone.boneName, sizeof(bone.boneName)));
+    }
+
+    // Walks one keyframe stream (layout described in SKA_Loader.cpp) and copies it to out with bone indices mapped
+    // through boneMap, keys of bones mapped to -1 are left out. size is the stream's length in the source.
+    bool copyStream(const char* data, size_t available, int16_t frameCount, const std::vector<int>& boneMap, std::vector<char>* out, size_t& size)
+    {
+        size_t position = 0;
+
+        auto take = [&](size_t count) -> const char*
+        {
+            if (available - position < count)
+                return nullptr;
+
+            const char* bytes = data + position;
+            position += count;
+            return bytes;
+        };
+
+        auto emit = [&](const void* bytes, size_t count)
+        {
+            if (out)
+                out->insert(out->end(), static_cast<const char*>(bytes), static_cast<const char*>(bytes) + count);
+        };
+
+        auto mapBone = [&](int bone, int& mapped)
+        {
+            if (bone < 0 || bone >= static_cast<int>(boneMap.size()))
+                return false;
+
+            mapped = boneMap[bone];
+            return true;
+        };
+
+        // scale and translation factors
+        const char* factors = take(2 * sizeof(float));
+        if (!factors)
+            return false;
+        emit(factors, 2 * sizeof(float));
+
+        // keys at frame 0: bone, then 13 int16, the next key frame and components of scale, rotation and translation
+        const size_t initialKeySize = 13 * sizeof(int16_t);
+
+        while (true)
+        {
+            const char* entry = take(sizeof(int16_t));
+            if (!entry)
+                return false;
+
+            int16_t bone;
+            std::memcpy(&bone, entry, sizeof(bone));
+
+            if (bone == -2)
+            {
+                emit(entry, sizeof(bone));
+                break;
+            }
+
+            const char* channels = take(initialKeySize);
+            int mapped = -1;
+
+            if (!channels || !mapBone(bone, mapped))
+                return false;
+
+            if (mapped < 0)
+                continue;
+
+            int16_t newBone = static_cast<int16_t>(mapped);
+            emit(&newBone, sizeof(newBone));
+            emit(channels, initialKeySize);
+        }
+
+        // the stream may also just end at the end of the file
+        while (position < available)
+        {
+            const char* entry = take(sizeof(uint16_t));
+            if (!entry)
+                return false;
+
+            uint16_t keyHeader;
+            std::memcpy(&keyHeader, entry, sizeof(keyHeader));
+
+            if (keyHeader & 1)
+            {
+                emit(entry, sizeof(keyHeader));
+
+                if ((keyHeader >> 1) > frameCount)
+                    break;
+
+                continue;
+            }
+
+            size_t length = ((keyHeader & 8) ? 4 : 0) + ((keyHeader & 4) ? 5 : 0) + ((keyHeader & 2) ? 4 : 0);
+            const char* channels = take(length * sizeof(int16_t));
+            int mapped = -1;
+
+            if (!channels || !mapBone(keyHeader >> 4, mapped))
+                return false;
+
+            if (mapped < 0)
+                continue;
+
+            uint16_t newHeader = static_cast<uint16_t>(mapped << 4 | (keyHeader & 0xF));
+            emit(&newHeader, sizeof(newHeader));
+            emit(channels, length * sizeof(int16_t));
+        }
+
+        size = position;
+        return true;
+    }
+
+    template <typename T>
+    bool sameKeys(const std::vector<SKA::Key<T>>& a, const std::vector<SKA::Key<T>>& b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const SKA::Key<T>& x, const SKA::Key<T>& y)
+        {
+            return x.frame == y.frame && std::memcmp(&x.value, &y.value, sizeof(T)) == 0;
+        });
+    }
+}
+
+namespace SKA
+{
+    bool write(std::ostream& stream, const Header& source, const std::vector<BoneData>& bones, const std::vector<AnimationRecord>& animations)
+    {
+        Header header = source;
+        header.boneCount = static_cast<uint32_t>(bones.size());
+        header.boneDataOffset = sizeof(Header);
+        header.animCount = static_cast<uint32_t>(animations.size());
+        header.animDataOffset = header.boneDataOffset + header.boneCount * sizeof(BoneData);
+
+        size_t eventTotal = 0;
+        for (const auto& animation : animations)
+            eventTotal += animation.events.size();
+
+        // the loader counts every event of the file in an int16_t
+        if (eventTotal > INT16_MAX)
+        {
+            LOG_ERROR << "[SKA] " << eventTotal << " events in total, at most " << INT16_MAX << " fit.";
+            return false;
+        }
+
+        // the loader reads every event right after the animation headers
+        const size_t eventStart = header.animDataOffset + animations.size() * sizeof(AnimationHeader);
+        const size_t streamStart = eventStart + eventTotal * sizeof(AnimationEvent);
+
+        std::vector<AnimationHeader> headers;
+        std::vector<AnimationEvent> events;
+        std::vector<char> streams;
+        std::unordered_map<std::string, size_t> streamOffsets;
+
+        headers.reserve(animations.size());
+        events.reserve(eventTotal);
+
+        for (size_t i = 0; i < animations.size(); i++)
+        {
+            const AnimationRecord& animation = animations[i];
+            const size_t headerOffset = header.animDataOffset + i * sizeof(AnimationHeader);
+
+            if (animation.streams.size() > maxStreams || animation.events.size() > INT16_MAX)
+            {
+                LOG_ERROR << "[SKA] " << nameOf(animation.header) << " has " << animation.streams.size() << " streams and " << animation.events.size()
+                    << " events, at most " << maxStreams << " and " << INT16_MAX << " fit.";
+                return false;
+            }
+
+            // offsets are from the start of the animation's header
+            AnimationHeader out = animation.header;
+            out.eventCount = static_cast<int16_t>(animation.events.size());
+            out.eventOffset = animation.events.empty() ? 0 : static_cast<uint32_t>(eventStart + events.size() * sizeof(AnimationEvent) - headerOffset);
+            out.streamCount = static_cast<int16_t>(animation.streams.size());
+            events.insert(events.end(), animation.events.begin(), animation.events.end());
+
+            for (size_t s = 0; s < animation.streams.size(); s++)
+            {
+                std::string key(animation.streams[s].begin(), animation.streams[s].end());
+                auto found = streamOffsets.find(key);
+
+                if (found == streamOffsets.end())
+                {
+                    found = streamOffsets.emplace(std::move(key), streams.size()).first;
+                    streams.insert(streams.end(), animation.streams[s].begin(), animation.streams[s].end());
+                }
+
+                out.streamHeaderData[s].dataOffset = static_cast<uint32_t>(streamStart + found->second - headerOffset);
+            }
+
+            headers.push_back(out);
+        }
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        writeArray(stream, bones);
+        writeArray(stream, headers);
+        writeArray(stream, events);
+        writeArray(stream, streams);
+
+        return static_cast<bool>(stream);
+    }
+
+    bool writeToFile(const std::string& path, const Header& header, const std::vector<BoneData>& bones, const std::vector<AnimationRecord>& animations)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            LOG_ERROR << "[SKA] Failed to create " << path;
+            return false;
+        }
+
+        if (!write(file, header, bones, animations))
+            return false;
+
+        file.close();
+
+        if (!file)
+        {
+            LOG_ERROR << "[SKA] Failed to write " << path;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool loadRecords(const SKAFile& ska, std::vector<AnimationRecord>& records)
+    {
+        records.clear();
+
+        VFS::File file(ska.path);
+        if (!file)
+        {
+            LOG_ERROR << "[SKA] Failed to open file: " << ska.path;
+            return false;
+        }
+
+        std::vector<int> identity(ska.boneData.size());
+        for (size_t i = 0; i < identity.size(); i++)
+            identity[i] = static_cast<int>(i);
+
+        records.resize(ska.animHeaderData.size());
+
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            AnimationRecord& record = records[i];
+            record.header = ska.animHeaderData[i];
+
+            const int streamCount = std::clamp<int>(record.header.streamCount, 0, maxStreams);
+            const size_t headerOffset = ska.header.animDataOffset + i * sizeof(AnimationHeader);
+
+            // events are where the header points, not necessarily in animation order
+            if (record.header.eventCount > 0)
+            {
+                const size_t start = headerOffset + record.header.eventOffset;
+                const size_t eventCount = static_cast<size_t>(record.header.eventCount);
+
+                if (start > file.size() || (file.size() - start) / sizeof(AnimationEvent) < eventCount)
+                {
+                    LOG_ERROR << "[SKA] " << ska.path << ": events of " << nameOf(record.header) << " are past the end of the file.";
+                    return false;
+                }
+
+                record.events.resize(eventCount);
+                std::memcpy(record.events.data(), file.data() + start, eventCount * sizeof(AnimationEvent));
+            }
+
+            for (int s = 0; s < streamCount; s++)
+            {
+                const AnimationStreamHeader& streamHeader = record.header.streamHeaderData[s];
+                const size_t start = headerOffset + streamHeader.dataOffset;
+                size_t size = 0;
+
+                if (start >= file.size() || !copyStream(file.data() + start, file.size() - start, streamHeader.frameCount, identity, nullptr, size))
+                {
+                    LOG_ERROR << "[SKA] " << ska.path << ": stream " << s << " of " << nameOf(record.header) << " is truncated or has keys for missing bones.";
+                    return false;
+                }
+
+                record.streams.emplace_back(file.data() + start, file.data() + start + size);
+            }
+        }
+
+        return true;
+    }
+
+    bool repack(const std::string& inputPath, const std::string& outputPath, const RepackOptions& options)
+    {
+        SKAFile ska;
+        std::vector<AnimationRecord> records;
+
+        if (!ska.loadFromFile(inputPath) || !loadRecords(ska, records))
+            return false;
+
+        // animations
+        std::vector<size_t> kept;
+
+        if (options.animations.empty())
+        {
+            for (size_t i = 0; i < records.size(); i++)
+                kept.push_back(i);
+        }
+
+        for (const std::string& name : options.animations)
+        {
+            auto found = std::find_if(records.begin(), records.end(), [&](const AnimationRecord& record) { return nameOf(record.header) == name; });
+
+            if (found == records.end())
+            {
+                LOG_ERROR << "[SKA] " << inputPath << " has no animation named " << name;
+                return false;
+            }
+
+            kept.push_back(found - records.begin());
+        }
+
+        std::sort(kept.begin(), kept.end());
+        kept.erase(std::unique(kept.begin(), kept.end()), kept.end());
+
+        // bones, a used bone keeps its whole parent chain
+        std::vector<bool> used(ska.boneData.size(), options.models.empty());
+
+        for (const auto& model : options.models)
+        {
+            for (const std::string& name : model)
+            {
+                bool found = false;
+
+                for (size_t i = 0; i < ska.boneData.size(); i++)
+                {
+                    if (name != boneName(ska.boneData[i]))
+                        continue;
+
+                    found = true;
+
+                    for (int bone = static_cast<int>(i); bone >= 0 && bone < static_cast<int>(used.size()) && !used[bone]; bone = ska.boneData[bone].parentBone)
+                        used[bone] = true;
+                }
+
+                if (!found)
+                    LOG_WARN << "[SKA] " << inputPath << " has no bone named " << name;
+            }
+        }
+
+        std::vector<int> boneMap(ska.boneData.size(), -1);
+        std::vector<BoneData> bones;
+
+        for (size_t i = 0; i < ska.boneData.size(); i++)
+        {
+            if (!used[i])
+                continue;
+
+            BoneData bone = ska.boneData[i];
+            int parent = bone.parentBone;
+            bone.parentBone = static_cast<int16_t>(parent >= 0 && parent < static_cast<int>(boneMap.size()) ? boneMap[parent] : -1);
+
+            boneMap[i] = static_cast<int>(bones.size());
+            bones.push_back(bone);
+        }
+
+        // dropping a bone shifts the ones after it, which only works if the models shift the same way
+        for (size_t m = 0; m < options.models.size(); m++)
+        {
+            const auto& model = options.models[m];
+
+            for (size_t i = 0; i < model.size(); i++)
+            {
+                if (i < bones.size() && model[i] == boneName(bones[i]))
+                    continue;
+
+                LOG_ERROR << "[SKA] " << inputPath << ": bone " << i << " of model " << m << " is " << model[i] << ", the repacked file would have "
+                    << (i < bones.size() ? boneName(bones[i]) : std::string("none")) << " there.";
+                return false;
+            }
+        }
+
+        // everything is decoded before writing, so the input can be overwritten
+        std::vector<AnimationRecord> packed;
+        std::vector<AnimationClip> expected(kept.size());
+
+        for (size_t k = 0; k < kept.size(); k++)
+        {
+            AnimationRecord record = records[kept[k]];
+
+            for (size_t s = 0; s < record.streams.size(); s++)
+            {
+                std::vector<char> stream;
+                size_t size = 0;
+
+                if (!copyStream(records[kept[k]].streams[s].data(), records[kept[k]].streams[s].size(), record.header.streamHeaderData[s].frameCount, boneMap, &stream, size))
+                {
+                    LOG_ERROR << "[SKA] " << inputPath << ": failed to copy stream " << s << " of " << nameOf(record.header);
+                    return false;
+                }
+
+                record.streams[s] = std::move(stream);
+            }
+
+            if (record.header.streamCount > 0 && !ska.loadClip(kept[k], expected[k]))
+                return false;
+
+            packed.push_back(std::move(record));
+        }
+
+        if (!writeToFile(outputPath, ska.header, bones, packed))
+            return false;
+
+        SKAFile result;
+        std::vector<AnimationRecord> written;
+
+        if (!result.loadFromFile(outputPath) || !loadRecords(result, written))
+            return false;
+
+        for (size_t k = 0; k < kept.size(); k++)
+        {
+            AnimationClip clip;
+
+            const auto& events = packed[k].events;
+            if (written[k].events.size() != events.size()
+                || (!events.empty() && std::memcmp(written[k].events.data(), events.data(), events.size() * sizeof(AnimationEvent)) != 0))
+            {
+                LOG_ERROR << "[SKA] " << outputPath << ": events of " << nameOf(packed[k].header) << " changed while repacking.";
+                return false;
+            }
+
+            if (packed[k].header.streamCount <= 0)
+                continue;
+
+            if (!result.loadClip(k, clip))
+                return false;
+
+            for (size_t i = 0; i < boneMap.size(); i++)
+            {
+                if (boneMap[i] < 0)
+                    continue;
+
+                const BoneTrack& before = expected[k].bones[i];
+                const BoneTrack& after = clip.bones[boneMap[i]];
+
+                if (!sameKeys(before.scale, after.scale) || !sameKeys(before.rotation, after.rotation) || !sameKeys(before.position, after.position))
+                {
+                    LOG_ERROR << "[SKA] " << outputPath << ": keys of bone " << i << " in " << clip.name << " changed while repacking.";
+                    return false;
+                }
+            }
+        }
+
+        LOG_INFO << "[SKA] Repacked " << inputPath << " to " << outputPath << ": " << packed.size() << " of " << records.size() << " animations, "
+            << bones.size() << " of " << ska.boneData.size() << " bones";
+
+        return true;
+    }
+}
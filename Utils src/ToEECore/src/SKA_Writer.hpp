@@ -0,0 +1,39 @@
+#pragma once
+
+#include "SKA_Loader.hpp"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Writes SKA files: header, bones, animation headers, every animation's events, then the keyframe streams in animation
+// order, so a reader going through the animations one by one only ever reads forward. Streams are copied as raw bytes,
+// identical streams (variations sharing their keys) are stored once.
+namespace SKA
+{
+    // one animation as it goes into a file, events and streams are its own, offsets are recomputed on write
+    struct AnimationRecord
+    {
+        AnimationHeader header;
+        std::vector<AnimationEvent> events;
+        std::vector<std::vector<char>> streams; // at most 10, in the order of header.streamHeaderData
+    };
+
+    bool write(std::ostream& stream, const Header& header, const std::vector<BoneData>& bones, const std::vector<AnimationRecord>& animations);
+    bool writeToFile(const std::string& path, const Header& header, const std::vector<BoneData>& bones, const std::vector<AnimationRecord>& animations);
+
+    // events and raw stream bytes of every animation of a loaded file, streams are read from ska.path again
+    bool loadRecords(const SKAFile& ska, std::vector<AnimationRecord>& records);
+
+    struct RepackOptions
+    {
+        std::vector<std::string> animations; // names to keep, empty = all
+        std::vector<std::vector<std::string>> models; // bone names of every model using the file in SKM order, empty = all bones
+    };
+
+    // Rewrites inputPath to outputPath (which may be the same file) without the animations and bones that aren't needed.
+    // Bones keep their order, stream keys of dropped bones are left out. Models find their bones by index, so every model's
+    // bone i has to be bone i of the result too. Every kept animation is decoded from both files afterwards and has to
+    // match key for key and event for event.
+    bool repack(const std::string& inputPath, const std::string& outputPath, const RepackOptions& options);
+}
@@ -1,12 +1,15 @@
+#include "LoadStats.hpp"
 #include "Logger.hpp"
 #include "SKM_Loader.hpp"
+#include "VFS.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/component_wise.hpp>
 #include <glm/gtx/quaternion.hpp>
 
-#include <fstream>
+#include <algorithm>
+#include <cfloat>
 #include <iostream>
 
 namespace SKM
@@ -30,6 +33,8 @@ namespace SKM
 
     bool SKMFile::loadFromFile(const std::string& path)
     {
+        LOAD_STAGE("SKM parse");
+
         skmFilename = path.substr(path.find_last_of("/\\") + 1);
 
         if (!rootPath.length())
@@ -42,7 +47,7 @@ namespace SKM
                 LOG_ERROR << "\"" << path << "\" is not a valid Temple of Elemental Evil data directory.";
         }
 
-        std::ifstream file(path, std::ios::binary);
+        VFS::File file(path);
         if (!file)
         {
             LOG_ERROR << "[SKM] Failed to open file: " << path;
@@ -50,6 +55,7 @@ namespace SKM
         }
 
         file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+        LoadStats::addBytesRead(file.gcount());
         if (!file)
         {
             LOG_ERROR << "[SKM] Failed to read header.";
@@ -59,6 +65,7 @@ namespace SKM
         file.seekg(header.boneDataOffset);
         bones.resize(header.boneCount);
         file.read(reinterpret_cast<char*>(bones.data()), bones.size() * sizeof(BoneData));
+        LoadStats::addBytesRead(file.gcount());
 
         skmInverseWorldMatrices.resize(header.boneCount);
         skmWorldMatrices.resize(header.boneCount);
@@ -73,6 +80,7 @@ namespace SKM
         std::vector<MaterialData> materialTemp(header.materialCount);
         materials.resize(header.materialCount);
         file.read(reinterpret_cast<char*>(materialTemp.data()), materialTemp.size() * sizeof(MaterialData));
+        LoadStats::addBytesRead(file.gcount());
         for (uint32_t i = 0; i < header.materialCount; i++)
         {
             std::string temp = materialTemp[i].materialFilePath;
@@ -82,36 +90,18 @@ namespace SKM
         file.seekg(header.vertexDataOffset);
         vertices.resize(header.vertexCount);
         file.read(reinterpret_cast<char*>(vertices.data()), vertices.size() * sizeof(VertexData));
+        LoadStats::addBytesRead(file.gcount());
 
         file.seekg(header.faceDataOffset);
         faces.resize(header.faceCount);
         file.read(reinterpret_cast<char*>(faces.data()), faces.size() * sizeof(FaceData));
+        LoadStats::addBytesRead(file.gcount());
 
         // ska part
-        std::string skaFilepath = path.substr(0, path.size() - 1) + "A";
+        std::string skaFilepath = animationPath.length() ? animationPath : path.substr(0, path.size() - 1) + "A";
         
         if (loadAnimation(skaFilepath))
-        {
-            skaWorldMatrices.resize(bones.size());
-            for (size_t i = 0; i < bones.size(); i++)
-            {
-                const auto& transform = animation.boneTransforms[i];
-                glm::mat4 T = glm::translate(glm::mat4(1.0f), transform.position);
-                glm::mat4 R = glm::toMat4(transform.rotation);
-                glm::mat4 S = glm::scale(glm::mat4(1.0f), transform.scale);
-                glm::mat4 localMatrix = T * R * S;
-                int parent = bones[i].parentBone;
-
-                if (parent >= 0)
-                {
-                    skaWorldMatrices[i] = skaWorldMatrices[parent] * localMatrix;
-                }
-                else
-                {
-                    skaWorldMatrices[i] = localMatrix;
-                }
-            }
-        }
+            computeWorldMatrices(animation.boneTransforms, skaWorldMatrices);
         else
             exception = true;
 
@@ -125,6 +115,40 @@ namespace SKM
         return true;
     }
 
+    void SKMFile::computeWorldMatrices(const std::vector<SKA::BoneTransform>& pose, std::vector<glm::mat4>& world) const
+    {
+        world.resize(bones.size());
+
+        for (size_t i = 0; i < bones.size(); i++)
+        {
+            if (i >= pose.size())
+            {
+                world[i] = skmWorldMatrices[i];
+                continue;
+            }
+
+            const auto& transform = pose[i];
+            glm::mat4 T = glm::translate(glm::mat4(1.0f), transform.position);
+            glm::mat4 R = glm::toMat4(transform.rotation);
+            glm::mat4 S = glm::scale(glm::mat4(1.0f), transform.scale);
+            glm::mat4 localMatrix = T * R * S;
+            int parent = bones[i].parentBone;
+
+            if (parent >= 0 && static_cast<size_t>(parent) < i)
+                world[i] = world[parent] * localMatrix;
+            else
+                world[i] = localMatrix;
+        }
+    }
+
+    void SKMFile::computeSkinningMatrices(const std::vector<SKA::BoneTransform>& pose, std::vector<glm::mat4>& palette) const
+    {
+        computeWorldMatrices(pose, palette);
+
+        for (size_t i = 0; i < palette.size(); i++)
+            palette[i] = palette[i] * skmInverseWorldMatrices[i];
+    }
+
     void SKMFile::clear()
     {
         header = { 0 };
@@ -143,6 +167,8 @@ namespace SKM
 
     MeshBuffer SKMFile::toMesh()
     {
+        LOAD_STAGE("toMesh");
+
         uint32_t vertexID = 0;
         MeshBuffer mesh;
         glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
@@ -260,79 +286,101 @@ namespace SKM
         mesh.materialGroup.resize(materialGroup.size());
         mesh.materialGroup = materialGroup;
 
-        mesh.loadTextures();
+        mesh.computeBounds();
 
-        for (size_t i = 0; i < mesh.materialData.size(); i++)
+        return mesh;
+    }
+
+    void MeshBuffer::computeBounds()
+    {
+        const size_t boneCount = skinningMatrix.size();
+        std::vector<Bounds> meshBones(boneCount);
+        std::vector<Bounds> groupBones(boneCount);
+
+        bounds = SkinnedBounds();
+
+        for (auto& group : materialGroup)
         {
-            glGenTextures(4, mesh.materialData[i].textureIDs);
+            SkinnedBounds& groupBounds = group.bounds;
+            groupBounds = SkinnedBounds();
+            std::fill(groupBones.begin(), groupBones.end(), Bounds());
 
-            for (uint32_t j = 0; j < mesh.materialData[i].textureCount; j++)
+            for (size_t i = group.indexOffset; i < group.indexOffset + group.indexCount && i < indices.size(); i++)
             {
-                auto& image = TGA::getOrLoadTexture(mesh.materialData[i].texturePath[j], mesh.textureCache);
+                if (indices[i] >= vertices.size())
+                    continue;
+
+                const GPUVertex& vertex = vertices[indices[i]];
+                float weightSum = 0.f;
+
+                groupBounds.bindPose.add(vertex.position);
 
-                glBindTexture(GL_TEXTURE_2D, mesh.materialData[i].textureIDs[j]);
+                for (int j = 0; j < 4; j++)
+                {
+                    if (vertex.boneWeights[j] <= 0.f)
+                        continue;
 
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+                    weightSum += vertex.boneWeights[j];
 
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+                    if (vertex.boneIDs[j] < boneCount)
+                        groupBones[vertex.boneIDs[j]].add(vertex.position);
+                    else
+                        groupBounds.reachesOrigin = true;
+                }
 
-                glGenerateMipmap(GL_TEXTURE_2D);
+                if (weightSum < .999f)
+                    groupBounds.reachesOrigin = true;
             }
-        }
 
-        return mesh;
-    }
+            for (uint32_t bone = 0; bone < boneCount; bone++)
+            {
+                if (groupBones[bone].isEmpty())
+                    continue;
 
-    void MeshBuffer::upload()
-    {
-        glGenVertexArrays(1, &modelVAO);
-        glGenBuffers(1, &modelVBO);
-        glGenBuffers(1, &modelEBO);
+                groupBounds.bones.push_back({ bone, groupBones[bone].getCenter(), groupBones[bone].getRadius() });
+                meshBones[bone].add(groupBones[bone]);
+            }
 
-        glBindVertexArray(modelVAO);
+            bounds.bindPose.add(groupBounds.bindPose);
+            bounds.reachesOrigin |= groupBounds.reachesOrigin;
+        }
 
-        glBindBuffer(GL_ARRAY_BUFFER, modelVBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GPUVertex), vertices.data(), GL_STATIC_DRAW);
+        for (uint32_t bone = 0; bone < boneCount; bone++)
+        {
+            if (!meshBones[bone].isEmpty())
+                bounds.bones.push_back({ bone, meshBones[bone].getCenter(), meshBones[bone].getRadius() });
+        }
+    }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, modelEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    Bounds SkinnedBounds::pose(const std::vector<glm::mat4>& palette) const
+    {
+        if (palette.empty())
+            return bindPose;
 
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GPUVertex), (void*)0);
+        Bounds result;
 
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GPUVertex), (void*)offsetof(GPUVertex, uv));
+        for (const BoneSphere& sphere : bones)
+        {
+            if (sphere.bone >= palette.size())
+            {
+                result.add(glm::vec3(0.f));
+                continue;
+            }
 
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(GPUVertex), (void*)offsetof(GPUVertex, normal));
+            const glm::mat4& matrix = palette[sphere.bone];
+            float scale = std::max(glm::length(glm::vec3(matrix[0])), std::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
 
-        glEnableVertexAttribArray(3);
-        glVertexAttribIPointer(3, 4, GL_UNSIGNED_INT, sizeof(GPUVertex), (void*)offsetof(GPUVertex, boneIDs));
+            result.add(glm::vec3(matrix * glm::vec4(sphere.center, 1.f)), sphere.radius * scale);
+        }
 
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(GPUVertex), (void*)offsetof(GPUVertex, boneWeights));
+        if (reachesOrigin)
+            result.add(glm::vec3(0.f));
 
-        glBindVertexArray(0);
+        return result;
     }
 
-    void MeshBuffer::destroy()
+    void MeshBuffer::clear()
     {
-        if (modelVAO)
-            glDeleteVertexArrays(1, &modelVAO);
-
-        if (modelVBO)
-            glDeleteBuffers(1, &modelVBO);
-
-        if (modelEBO)
-            glDeleteBuffers(1, &modelEBO);
-
-        modelVAO = 0;
-        modelVBO = 0;
-        modelEBO = 0;
-
         vertices.resize(0);
         indices.resize(0);
 
@@ -342,28 +390,14 @@ namespace SKM
         tPoseSkinningMatrix.resize(0);
 
         materialData.resize(0);
-        textureCache.clear();
 
         modelMatrix = glm::mat4(1.0f);
         modelCenter = glm::vec3(0.0f);
+        bounds = SkinnedBounds();
 
         materialGroup.resize(0);
     }
 
-    void MeshBuffer::loadTextures()
-    {
-        for (size_t i = 0; i < materialData.size(); i++)
-        {
-            for (int j = 0; j < materialData[i].textureCount; j++)
-            {
-                TGA::getOrLoadTexture(materialData[i].texturePath[j], textureCache);
-            }
-
-            if (materialData[i].glossMap.length())
-                TGA::getOrLoadTexture(materialData[i].glossMap, textureCache);
-        }
-    }
-
     glm::mat4 toMat(const SKM::Matrix3x4& matrix)
     {
         return glm::mat4(
@@ -385,16 +419,15 @@ namespace SKM
 
         for (size_t i = 0; i < materialData.size(); i++)
         {
-            if (!materialData[i].parseMDFFile(rootPath, materials[i]))
-            {
-                LOG_ERROR << "Failed to parse material file: " << materials[i];
-            }
+            materialData[i] = MDF::MaterialCache::get().acquire(rootPath, materials[i]);
 
 #ifndef NDEBUG
-            materialData[i].debugPrint();
+            materialData[i]->debugPrint();
 #endif
         }
 
+        LOAD_STAGE("Material groups");
+
         std::unordered_map<uint8_t, MaterialGroup> groupMap;
         for (const FaceData& face : faces)
         {
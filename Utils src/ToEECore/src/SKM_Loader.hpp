@@ -1,14 +1,14 @@
 #pragma once
 
-#include "MDF_Loader.hpp"
+#include "Bounds.hpp"
+#include "MaterialCache.hpp"
 #include "SKA_Loader.hpp"
-#include "TGA_Loader.hpp"
 
-#include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace SKM
@@ -42,6 +42,7 @@ namespace SKM
         uint32_t vertexDataOffset = 0;
         uint32_t faceCount = 0;
         uint32_t faceDataOffset = 0;
+        uint32_t padding[2] = { 0 };
     };
 
     struct BoneData
@@ -85,12 +86,33 @@ namespace SKM
         glm::vec4 boneWeights = glm::vec4(0.0f);
     };
 
+    // box around the bind pose positions of every vertex one bone moves, kept as a sphere so poses only transform it
+    struct BoneSphere
+    {
+        uint32_t bone = 0;
+        glm::vec3 center = glm::vec3(0.f);
+        float radius = 0.f;
+    };
+
+    // Bind pose bounds plus what is needed to bound any pose without touching vertices. A skinned vertex is a weighted
+    // average of its bones' transforms of it, so it stays inside the box around those bones' transformed spheres.
+    struct SkinnedBounds
+    {
+        Bounds bindPose;
+        std::vector<BoneSphere> bones;
+        bool reachesOrigin = false; // weights summing to less than one (or bones past the palette) pull vertices toward 0
+
+        // mesh space, the model matrix is not applied
+        Bounds pose(const std::vector<glm::mat4>& palette) const;
+    };
+
     struct MaterialGroup
     {
         int32_t materialID = -1;
         size_t indexOffset = 0;
         size_t indexCount = 0;
         std::vector<uint32_t> vertexIndices;
+        SkinnedBounds bounds; // filled by toMesh
     };
 
     struct MeshBuffer
@@ -103,22 +125,18 @@ namespace SKM
         std::vector<glm::mat4> skinningMatrix;
         std::vector<glm::mat4> tPoseSkinningMatrix;
 
-        std::vector<MDF::MDFFile> materialData;
-        std::unordered_map<std::string, TGA::TGAImage> textureCache;
+        std::vector<MDF::MaterialRef> materialData; // shared with every other mesh using the same MDF, textures included
 
         std::vector<MaterialGroup> materialGroup;
 
         glm::mat4 modelMatrix = glm::mat4(1.0f);
         glm::vec3 modelCenter = glm::vec3(0.0f);
+        SkinnedBounds bounds; // union of the group bounds
 
-        GLuint modelVAO = 0;
-        GLuint modelVBO = 0;
-        GLuint modelEBO = 0;
+        void clear();
 
-        void upload();
-        void destroy();
-
-        void loadTextures();
+        // group and mesh bounds from vertices, indices and the size of skinningMatrix
+        void computeBounds();
     };
 
     struct SKMFile
@@ -137,11 +155,12 @@ namespace SKM
 
         std::string rootPath;
         std::string skmFilename;
+        std::string animationPath; // resolved by the asset database, empty means the SKA next to the SKM
 
         bool loaded = false;
         bool exception = false;
 
-        void SKMFile::clear();
+        void clear();
 
         bool loadAnimation(const std::string& path);
         bool loadFromFile(const std::string& path);
@@ -149,9 +168,14 @@ namespace SKM
 
         bool populateAnimNames(std::vector<std::string>& animList);
 
+        // world matrices of the SKM hierarchy with bone i posed by SKA transform i, bones past the pose keep the SKM bind pose
+        void computeWorldMatrices(const std::vector<SKA::BoneTransform>& pose, std::vector<glm::mat4>& world) const;
+        // world * inverse bind, the palette Skinning and the shaders take
+        void computeSkinningMatrices(const std::vector<SKA::BoneTransform>& pose, std::vector<glm::mat4>& palette) const;
+
         MeshBuffer toMesh();
         SKA::SKAFile animation;
-        std::vector<MDF::MDFFile> materialData;
+        std::vector<MDF::MaterialRef> materialData;
     };
 
     glm::mat4 toMat(const SKM::Matrix3x4& matrix);
@@ -0,0 +1,139 @@
+#include "Logger.hpp"
+#include "SKM_Writer.hpp"
+#include "VFS.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    template <typename T>
+    void writeArray(std::ostream& stream, const std::vector<T>& values)
+    {
+        stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    const char* sectionAt(const SKM::Header& header, size_t offset)
+    {
+        if (offset < header.boneDataOffset)
+            return "header";
+        if (offset < header.materialDataOffset)
+            return "bones";
+        if (offset < header.vertexDataOffset)
+            return "materials";
+        if (offset < header.faceDataOffset)
+            return "vertices";
+
+        return "faces";
+    }
+}
+
+namespace SKM
+{
+    Header computeLayout(const SKMFile& skm)
+    {
+        Header header = skm.header;
+        header.boneCount = static_cast<uint32_t>(skm.bones.size());
+        header.boneDataOffset = sizeof(Header);
+        header.materialCount = static_cast<uint32_t>(skm.materials.size());
+        header.materialDataOffset = header.boneDataOffset + header.boneCount * sizeof(BoneData);
+        header.vertexCount = static_cast<uint32_t>(skm.vertices.size());
+        header.vertexDataOffset = header.materialDataOffset + header.materialCount * sizeof(MaterialData);
+        header.faceCount = static_cast<uint32_t>(skm.faces.size());
+        header.faceDataOffset = header.vertexDataOffset + header.vertexCount * sizeof(VertexData);
+
+        return header;
+    }
+
+    bool write(std::ostream& stream, const SKMFile& skm)
+    {
+        // faces index vertices with 16 bits
+        if (skm.vertices.size() > 65536)
+        {
+            LOG_ERROR << "[SKM] " << skm.skmFilename << " has " << skm.vertices.size() << " vertices, faces can only index 65536.";
+            return false;
+        }
+
+        std::vector<MaterialData> materials(skm.materials.size());
+
+        for (size_t i = 0; i < materials.size(); i++)
+        {
+            const std::string& path = skm.materials[i];
+
+            if (path.size() >= sizeof(materials[i].materialFilePath))
+            {
+                LOG_ERROR << "[SKM] " << skm.skmFilename << ": material path is too long: " << path;
+                return false;
+            }
+
+            std::memset(materials[i].materialFilePath, 0, sizeof(materials[i].materialFilePath));
+            std::memcpy(materials[i].materialFilePath, path.data(), path.size());
+        }
+
+        const Header header = computeLayout(skm);
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        writeArray(stream, skm.bones);
+        writeArray(stream, materials);
+        writeArray(stream, skm.vertices);
+        writeArray(stream, skm.faces);
+
+        return static_cast<bool>(stream);
+    }
+
+    bool writeToFile(const std::string& path, const SKMFile& skm)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            LOG_ERROR << "[SKM] Failed to create " << path;
+            return false;
+        }
+
+        if (!write(file, skm))
+            return false;
+
+        file.close();
+
+        if (!file)
+        {
+            LOG_ERROR << "[SKM] Failed to write " << path;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool verifyRoundTrip(const std::string& path)
+    {
+        VFS::File original(path);
+        if (!original)
+        {
+            LOG_ERROR << "[SKM] Failed to open file: " << path;
+            return false;
+        }
+
+        SKMFile skm;
+        if (!skm.loadFromFile(path))
+            return false;
+
+        std::ostringstream stream(std::ios::binary);
+        if (!write(stream, skm))
+            return false;
+
+        const std::string written = stream.str();
+        const size_t common = std::min(written.size(), original.size());
+        const auto mismatch = std::mismatch(written.begin(), written.begin() + common, original.data());
+        const size_t offset = mismatch.first - written.begin();
+
+        if (offset == common && written.size() == original.size())
+            return true;
+
+        LOG_ERROR << "[SKM] " << path << " doesn't survive a round trip, first difference at byte " << offset << " ("
+            << sectionAt(computeLayout(skm), offset) << "), " << original.size() << " bytes read, " << written.size() << " written";
+
+        return false;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "SKM_Loader.hpp"
+
+#include <ostream>
+#include <string>
+
+// Writes SKMFile's arrays back out as an SKM: header, bones, materials, vertices and faces, each section right after the
+// previous one (the layout of the game's files) and written with a single call. Material paths are the only section
+// that is converted, everything else goes out exactly as loadFromFile read it.
+namespace SKM
+{
+    // skm.header with counts and offsets of the layout above
+    Header computeLayout(const SKMFile& skm);
+
+    bool write(std::ostream& stream, const SKMFile& skm);
+    bool writeToFile(const std::string& path, const SKMFile& skm);
+
+    // loads path with SKMFile::loadFromFile, writes it to memory and compares that with the file byte by byte,
+    // the first difference is logged with the section it is in
+    bool verifyRoundTrip(const std::string& path);
+}
@@ -0,0 +1,248 @@
+#include "Skinning.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TOEE_SKINNING_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TOEE_AVX2_TARGET
+#else
+// only these functions are built for AVX2, the rest of the library keeps running on any x86 CPU
+#define TOEE_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "palette is read as packed column major floats");
+
+namespace
+{
+    constexpr size_t chunkSize = 4096;
+
+    // the two vertex layouts only differ in where things are and how many influences there are
+    const float* positionOf(const SKM::GPUVertex& vertex) { return &vertex.position.x; }
+    const float* normalOf(const SKM::GPUVertex& vertex) { return &vertex.normal.x; }
+    int influenceCount(const SKM::GPUVertex&) { return 4; }
+    uint32_t boneOf(const SKM::GPUVertex& vertex, int i) { return vertex.boneIDs[i]; }
+    float weightOf(const SKM::GPUVertex& vertex, int i) { return vertex.boneWeights[i]; }
+
+    const float* positionOf(const SKM::VertexData& vertex) { return &vertex.vertexPosition.x; }
+    const float* normalOf(const SKM::VertexData& vertex) { return &vertex.normals.x; }
+    int influenceCount(const SKM::VertexData& vertex) { return std::min<int>(vertex.vertexWeightsCount, 6); }
+    uint32_t boneOf(const SKM::VertexData& vertex, int i) { return vertex.boneID[i]; }
+    float weightOf(const SKM::VertexData& vertex, int i) { return vertex.boneWeight[i]; }
+
+    template <typename Vertex>
+    void skinScalar(const Vertex* vertices, size_t count, const float* palette, size_t boneCount, glm::vec3* positions, glm::vec3* normals)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const Vertex& vertex = vertices[i];
+            const int influences = influenceCount(vertex);
+
+            // xyz of the blended matrix's columns, the palette is affine so w is not needed
+            float m[12] = { 0.f };
+
+            for (int b = 0; b < influences; b++)
+            {
+                uint32_t bone = boneOf(vertex, b);
+
+                if (bone >= boneCount)
+                    continue;
+
+                const float* matrix = palette + bone * 16;
+                const float weight = weightOf(vertex, b);
+
+                for (int column = 0; column < 4; column++)
+                {
+                    m[column * 3 + 0] += weight * matrix[column * 4 + 0];
+                    m[column * 3 + 1] += weight * matrix[column * 4 + 1];
+                    m[column * 3 + 2] += weight * matrix[column * 4 + 2];
+                }
+            }
+
+            const float* p = positionOf(vertex);
+            positions[i] = glm::vec3(
+                m[0] * p[0] + m[3] * p[1] + m[6] * p[2] + m[9],
+                m[1] * p[0] + m[4] * p[1] + m[7] * p[2] + m[10],
+                m[2] * p[0] + m[5] * p[1] + m[8] * p[2] + m[11]);
+
+            if (normals)
+            {
+                const float* n = normalOf(vertex);
+                normals[i] = glm::vec3(
+                    m[0] * n[0] + m[3] * n[1] + m[6] * n[2],
+                    m[1] * n[0] + m[4] * n[1] + m[7] * n[2],
+                    m[2] * n[0] + m[5] * n[1] + m[8] * n[2]);
+            }
+        }
+    }
+
+#ifdef TOEE_SKINNING_AVX2
+    TOEE_AVX2_TARGET inline __m256 splat(float low, float high)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(low)), _mm_set1_ps(high), 1);
+    }
+
+    TOEE_AVX2_TARGET inline glm::vec3 addHalves(__m256 value)
+    {
+        alignas(16) float sum[4];
+        _mm_store_ps(sum, _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1)));
+
+        return glm::vec3(sum[0], sum[1], sum[2]);
+    }
+
+    // a column major mat4 is exactly two registers, blending is two FMAs per influence and applying the result takes
+    // one multiply and one FMA on [column 0 | column 1] and [column 2 | column 3]
+    template <typename Vertex>
+    TOEE_AVX2_TARGET void skinAVX2(const Vertex* vertices, size_t count, const float* palette, size_t boneCount, glm::vec3* positions, glm::vec3* normals)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const Vertex& vertex = vertices[i];
+            const int influences = influenceCount(vertex);
+
+            __m256 columns01 = _mm256_setzero_ps();
+            __m256 columns23 = _mm256_setzero_ps();
+
+            for (int b = 0; b < influences; b++)
+            {
+                uint32_t bone = boneOf(vertex, b);
+
+                if (bone >= boneCount)
+                    continue;
+
+                const float* matrix = palette + bone * 16;
+                const __m256 weight = _mm256_set1_ps(weightOf(vertex, b));
+
+                columns01 = _mm256_fmadd_ps(weight, _mm256_loadu_ps(matrix), columns01);
+                columns23 = _mm256_fmadd_ps(weight, _mm256_loadu_ps(matrix + 8), columns23);
+            }
+
+            const float* p = positionOf(vertex);
+            positions[i] = addHalves(_mm256_fmadd_ps(columns23, splat(p[2], 1.f), _mm256_mul_ps(columns01, splat(p[0], p[1]))));
+
+            if (normals)
+            {
+                const float* n = normalOf(vertex);
+                normals[i] = addHalves(_mm256_fmadd_ps(columns23, splat(n[2], 0.f), _mm256_mul_ps(columns01, splat(n[0], n[1]))));
+            }
+        }
+    }
+#endif
+
+    bool detectAVX2()
+    {
+#if defined(TOEE_SKINNING_AVX2) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+
+        if (info[0] < 7)
+            return false;
+
+        // FMA, OSXSAVE and AVX, then the OS has to save the YMM registers
+        const int needed = (1 << 12) | (1 << 27) | (1 << 28);
+        __cpuid(info, 1);
+
+        if ((info[2] & needed) != needed || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+
+        return (info[1] & (1 << 5)) != 0;
+#elif defined(TOEE_SKINNING_AVX2)
+        __builtin_cpu_init();
+
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+        return false;
+#endif
+    }
+
+    template <typename Vertex>
+    void skinRange(const Vertex* vertices, size_t count, const std::vector<glm::mat4>& palette, glm::vec3* positions, glm::vec3* normals, Skinning::Kernel kernel)
+    {
+        const float* matrices = palette.empty() ? nullptr : &palette[0][0][0];
+
+#ifdef TOEE_SKINNING_AVX2
+        if (Skinning::resolve(kernel) == Skinning::Kernel::AVX2)
+        {
+            skinAVX2(vertices, count, matrices, palette.size(), positions, normals);
+            return;
+        }
+#endif
+
+        skinScalar(vertices, count, matrices, palette.size(), positions, normals);
+    }
+
+    template <typename Vertex>
+    void skinAll(const std::vector<Vertex>& vertices, const std::vector<glm::mat4>& palette, Skinning::PosedMesh& out, ThreadPool* pool, Skinning::Kernel kernel)
+    {
+        const size_t count = vertices.size();
+        const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        out.positions.resize(count);
+        out.normals.resize(count);
+        kernel = Skinning::resolve(kernel);
+
+        auto job = [&](size_t chunk)
+        {
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(begin + chunkSize, count);
+
+            skinRange(vertices.data() + begin, end - begin, palette, out.positions.data() + begin, out.normals.data() + begin, kernel);
+        };
+
+        if (pool && chunkCount > 1)
+            pool->parallelFor(chunkCount, job);
+        else
+        {
+            for (size_t chunk = 0; chunk < chunkCount; chunk++)
+                job(chunk);
+        }
+    }
+}
+
+namespace Skinning
+{
+    bool isAVX2Supported()
+    {
+        static const bool supported = detectAVX2();
+        return supported;
+    }
+
+    Kernel resolve(Kernel kernel)
+    {
+        if (kernel == Kernel::Scalar || !isAVX2Supported())
+            return Kernel::Scalar;
+
+        return Kernel::AVX2;
+    }
+
+    const char* getKernelName(Kernel kernel)
+    {
+        return resolve(kernel) == Kernel::AVX2 ? "AVX2" : "scalar";
+    }
+
+    void skin(const SKM::GPUVertex* vertices, size_t count, const std::vector<glm::mat4>& palette, glm::vec3* positions, glm::vec3* normals, Kernel kernel)
+    {
+        skinRange(vertices, count, palette, positions, normals, kernel);
+    }
+
+    void skin(const SKM::VertexData* vertices, size_t count, const std::vector<glm::mat4>& palette, glm::vec3* positions, glm::vec3* normals, Kernel kernel)
+    {
+        skinRange(vertices, count, palette, positions, normals, kernel);
+    }
+
+    void skinMesh(const SKM::MeshBuffer& mesh, const std::vector<glm::mat4>& palette, PosedMesh& out, ThreadPool* pool, Kernel kernel)
+    {
+        skinAll(mesh.vertices, palette, out, pool, kernel);
+    }
+
+    void skinMesh(const SKM::SKMFile& skm, const std::vector<glm::mat4>& palette, PosedMesh& out, ThreadPool* pool, Kernel kernel)
+    {
+        skinAll(skm.vertices, palette, out, pool, kernel);
+    }
+}
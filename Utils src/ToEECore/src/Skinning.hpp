@@ -0,0 +1,44 @@
+#pragma once
+
+#include "SKM_Loader.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// Linear blend skinning on the CPU, the same math as the model vertex shader: each vertex is transformed by the
+// weighted sum of its bones' palette matrices, bones past the end of the palette contribute nothing and normals are
+// not renormalized. Gives the posed mesh without rendering it (exporters, the software renderer, collision).
+namespace Skinning
+{
+    enum class Kernel
+    {
+        Auto,   // AVX2 when the CPU has it, scalar otherwise
+        Scalar,
+        AVX2,   // runs the scalar kernel on CPUs or builds without AVX2
+    };
+
+    struct PosedMesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+    };
+
+    bool isAVX2Supported();
+
+    // the kernel a request for kernel ends up running
+    Kernel resolve(Kernel kernel);
+    const char* getKernelName(Kernel kernel);
+
+    // one range on the calling thread, results go to the same indices as the vertices, normals can be null
+    // GPUVertex has 4 influences, the SKM file's VertexData up to 6 (vertexWeightsCount)
+    void skin(const SKM::GPUVertex* vertices, size_t count, const std::vector<glm::mat4>& palette, glm::vec3* positions, glm::vec3* normals, Kernel kernel = Kernel::Auto);
+    void skin(const SKM::VertexData* vertices, size_t count, const std::vector<glm::mat4>& palette, glm::vec3* positions, glm::vec3* normals, Kernel kernel = Kernel::Auto);
+
+    // every vertex, split into chunks over the pool (the calling thread alone without one)
+    void skinMesh(const SKM::MeshBuffer& mesh, const std::vector<glm::mat4>& palette, PosedMesh& out, ThreadPool* pool = nullptr, Kernel kernel = Kernel::Auto);
+    void skinMesh(const SKM::SKMFile& skm, const std::vector<glm::mat4>& palette, PosedMesh& out, ThreadPool* pool = nullptr, Kernel kernel = Kernel::Auto);
+}
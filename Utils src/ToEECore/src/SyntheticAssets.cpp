@@ -0,0 +1,593 @@
+#include "DAG_Loader.hpp"
+#include "Logger.hpp"
+#include "SKA_Loader.hpp"
+#include "SKA_Writer.hpp"
+#include "SKM_Loader.hpp"
+#include "SKM_Writer.hpp"
+#include "SyntheticAssets.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // ToEE units, a human is roughly 70 tall; bones are spread evenly over the height in both SKM and SKA
+    const float meshHeight = 100.f;
+    const float meshRadius = 15.f;
+    const float pi = 3.14159265f;
+
+    const char* animationNames[] = {
+        "unarmed_unarmed_idle",
+        "unarmed_unarmed_walk",
+        "unarmed_unarmed_run",
+        "unarmed_unarmed_rattack",
+        "unarmed_unarmed_lattack",
+        "unarmed_unarmed_rturn",
+        "unarmed_unarmed_hit",
+        "unarmed_unarmed_death"
+    };
+
+    struct Random
+    {
+        uint32_t state;
+
+        explicit Random(uint32_t seed) : state(seed * 747796405u + 2891336453u) {}
+
+        uint32_t next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+        float range(float min, float max)
+        {
+            return min + (max - min) * (next() & 0xFFFFFF) / float(0xFFFFFF);
+        }
+    };
+
+    template <typename T>
+    void writeRaw(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    bool openForWrite(std::ofstream& file, const std::string& path, std::ios::openmode mode)
+    {
+        file.open(path, mode | std::ios::trunc);
+
+        if (!file)
+            LOG_ERROR << "[SyntheticAssets] Failed to create " << path;
+
+        return static_cast<bool>(file);
+    }
+
+    bool finish(std::ofstream& file, const std::string& path)
+    {
+        file.close();
+
+        if (!file)
+        {
+            LOG_ERROR << "[SyntheticAssets] Failed to write " << path;
+            return false;
+        }
+
+        return true;
+    }
+
+    // vertex indices of face number index on a grid of columns x rows, wrapped around in X when closed
+    void gridFace(uint32_t index, uint32_t columns, uint32_t rows, uint32_t vertexCount, bool closed, uint16_t out[3])
+    {
+        uint32_t quadColumns = closed ? columns : columns - 1;
+        uint32_t quadCount = quadColumns * (rows - 1);
+
+        if (!quadCount)
+        {
+            // a single row, fan over it instead
+            uint32_t k = index % (vertexCount - 2);
+            out[0] = 0;
+            out[1] = static_cast<uint16_t>(k + 1);
+            out[2] = static_cast<uint16_t>(k + 2);
+            return;
+        }
+
+        uint32_t quad = (index / 2) % quadCount;
+        uint32_t row = quad / quadColumns;
+        uint32_t column = quad % quadColumns;
+
+        uint32_t a = row * columns + column;
+        uint32_t b = row * columns + (column + 1) % columns;
+        uint32_t c = std::min(a + columns, vertexCount - 1);
+        uint32_t d = std::min(b + columns, vertexCount - 1);
+
+        if (index % 2 == 0)
+        {
+            out[0] = static_cast<uint16_t>(a);
+            out[1] = static_cast<uint16_t>(c);
+            out[2] = static_cast<uint16_t>(b);
+        }
+        else
+        {
+            out[0] = static_cast<uint16_t>(b);
+            out[1] = static_cast<uint16_t>(c);
+            out[2] = static_cast<uint16_t>(d);
+        }
+    }
+
+    uint32_t defaultFaceCount(uint32_t columns, uint32_t rows, uint32_t vertexCount, bool closed)
+    {
+        uint32_t quadCount = (closed ? columns : columns - 1) * (rows - 1);
+
+        return quadCount ? quadCount * 2 : vertexCount - 2;
+    }
+
+    void fillName(char* out, size_t size, const char* format, uint32_t value)
+    {
+        std::memset(out, 0, size);
+        snprintf(out, size, format, value);
+    }
+}
+
+namespace SyntheticAssets
+{
+    // vertices on a closed cylinder around Y, skinned to the nearest bones along its height
+    bool writeSKM(const std::string& path, const MeshParams& params, const std::vector<std::string>& materialPaths)
+    {
+        Random random(params.seed);
+
+        uint32_t vertexCount = std::clamp<uint32_t>(params.vertexCount, 3, 65535);
+        uint32_t boneCount = std::max<uint32_t>(params.boneCount, 1);
+        uint32_t weightCount = std::clamp<uint32_t>(params.weightsPerVertex, 1, std::min<uint32_t>(6, boneCount));
+        uint32_t materialCount = std::max<uint32_t>(static_cast<uint32_t>(materialPaths.size()), 1);
+
+        uint32_t columns = std::min<uint32_t>(32, vertexCount);
+        uint32_t rows = (vertexCount + columns - 1) / columns;
+        uint32_t faceCount = params.faceCount ? params.faceCount : defaultFaceCount(columns, rows, vertexCount, true);
+        float boneSpacing = meshHeight / boneCount;
+
+        SKM::SKMFile skm;
+        skm.skmFilename = path;
+        skm.bones.resize(boneCount);
+        skm.materials.resize(materialCount);
+        skm.vertices.resize(vertexCount);
+        skm.faces.resize(faceCount);
+
+        for (uint32_t i = 0; i < boneCount; i++)
+        {
+            SKM::BoneData& bone = skm.bones[i];
+            fillName(bone.boneName, sizeof(bone.boneName), i ? "Bip01 Bone%02u" : "Bip01", i);
+            bone.parentBone = static_cast<int16_t>(i) - 1;
+            bone.worldInverse.rows[0] = { 1.f, 0.f, 0.f, 0.f };
+            bone.worldInverse.rows[1] = { 0.f, 1.f, 0.f, -boneSpacing * i };
+            bone.worldInverse.rows[2] = { 0.f, 0.f, 1.f, 0.f };
+        }
+
+        for (uint32_t i = 0; i < materialCount && i < materialPaths.size(); i++)
+            skm.materials[i] = materialPaths[i];
+
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            uint32_t column = i % columns;
+            uint32_t row = i / columns;
+            float angle = 2.f * pi * column / columns;
+            float height = rows > 1 ? meshHeight * row / (rows - 1) : 0.f;
+            float radius = meshRadius + random.range(-.5f, .5f);
+
+            SKM::VertexData& vertex = skm.vertices[i];
+            vertex.vertexPosition = { std::cos(angle) * radius, height, std::sin(angle) * radius, 1.f };
+            vertex.normals = { std::cos(angle), 0.f, std::sin(angle), 0.f };
+            vertex.uvPosition = { static_cast<float>(column) / columns, static_cast<float>(row) / rows };
+
+            uint32_t nearest = std::min(static_cast<uint32_t>(height / boneSpacing), boneCount - 1);
+            float weightSum = weightCount * (weightCount + 1) * .5f;
+
+            vertex.vertexWeightsCount = static_cast<uint16_t>(weightCount);
+
+            for (uint32_t k = 0; k < weightCount; k++)
+            {
+                vertex.boneID[k] = static_cast<uint16_t>((nearest + k) % boneCount);
+                vertex.boneWeight[k] = (weightCount - k) / weightSum;
+            }
+        }
+
+        // materials get consecutive bands of faces, like the per-part materials of real models
+        for (uint32_t i = 0; i < faceCount; i++)
+        {
+            SKM::FaceData& face = skm.faces[i];
+            face.materialIndex = static_cast<uint16_t>(static_cast<uint64_t>(i) * materialCount / faceCount);
+            gridFace(i, columns, rows, vertexCount, true, face.vertexIndex);
+        }
+
+        return SKM::writeToFile(path, skm);
+    }
+
+    // every animation bends the bone chain around Z and back, the stream layout is described in SKA_Loader.cpp
+    bool writeSKA(const std::string& path, uint32_t boneCount, uint32_t animationCount)
+    {
+        boneCount = std::max<uint32_t>(boneCount, 1);
+        animationCount = std::min<uint32_t>(animationCount, INT16_MAX);
+
+        float boneSpacing = meshHeight / boneCount;
+
+        const int16_t frameCount = 30;
+        const int16_t keyFrames[] = { 0, 10, 20, frameCount - 1 };
+        const float scaleFactor = 1.f / 1024.f;
+        const float translationFactor = meshHeight / 16384.f;
+
+        auto buildStream = [&](uint32_t animation)
+        {
+            std::vector<char> stream;
+            auto put = [&](auto value) { stream.insert(stream.end(), reinterpret_cast<const char*>(&value), reinterpret_cast<const char*>(&value) + sizeof(value)); };
+
+            float amplitude = pi * .5f * ((animation % 8) + 1) / 8.f / boneCount;
+            auto putRotation = [&](int key)
+            {
+                float angle = amplitude * std::sin(2.f * pi * keyFrames[key] / (frameCount - 1));
+                put(static_cast<int16_t>(key + 1 < 4 ? keyFrames[key + 1] : frameCount));
+                put(int16_t(0));
+                put(int16_t(0));
+                put(static_cast<int16_t>(std::lround(std::sin(angle * .5f) * 32767.f)));
+                put(static_cast<int16_t>(std::lround(std::cos(angle * .5f) * 32767.f)));
+            };
+
+            put(scaleFactor);
+            put(translationFactor);
+
+            for (uint32_t i = 0; i < boneCount; i++)
+            {
+                put(static_cast<int16_t>(i));
+                put(frameCount);
+                for (int j = 0; j < 3; j++)
+                    put(static_cast<int16_t>(1024));
+                putRotation(0);
+                put(frameCount);
+                put(int16_t(0));
+                put(static_cast<int16_t>(i ? std::lround(boneSpacing / translationFactor) : 0));
+                put(int16_t(0));
+            }
+
+            put(int16_t(-2));
+
+            for (int key = 1; key < 4; key++)
+            {
+                put(static_cast<uint16_t>(keyFrames[key] << 1 | 1));
+
+                for (uint32_t i = 0; i < boneCount; i++)
+                {
+                    put(static_cast<uint16_t>(i << 4 | 4));
+                    putRotation(key);
+                }
+            }
+
+            put(static_cast<uint16_t>((frameCount + 1) << 1 | 1));
+
+            return stream;
+        };
+
+        std::vector<SKA::BoneData> bones(boneCount);
+
+        for (uint32_t i = 0; i < boneCount; i++)
+        {
+            SKA::BoneData& bone = bones[i];
+            fillName(bone.boneName, sizeof(bone.boneName), i ? "Bip01 Bone%02u" : "Bip01", i);
+            bone.parentBone = static_cast<int16_t>(i) - 1;
+            bone.scale = { 1.f, 1.f, 1.f };
+            bone.rotQuaternions = { 0.f, 0.f, 0.f, 1.f };
+            bone.position = { 0.f, i ? boneSpacing : 0.f, 0.f };
+        }
+
+        std::vector<SKA::AnimationRecord> animations(animationCount);
+
+        for (uint32_t i = 0; i < animationCount; i++)
+        {
+            const char* baseName = animationNames[i % 8];
+
+            SKA::AnimationHeader& animation = animations[i].header;
+            std::memset(&animation, 0, sizeof(animation));
+
+            if (i < 8)
+                snprintf(animation.name, sizeof(animation.name), "%s", baseName);
+            else
+                snprintf(animation.name, sizeof(animation.name), "%s%u", baseName, i / 8);
+
+            animation.driveType = 0;
+            animation.loopable = (i % 8) < 3;
+            animation.streamHeaderData[0].frameCount = frameCount;
+            animation.streamHeaderData[0].variationId = 0;
+            animation.streamHeaderData[0].frameRate = 30.f;
+            animation.streamHeaderData[0].drawingRate = 30.f;
+
+            SKA::AnimationEvent event;
+            std::memset(&event, 0, sizeof(event));
+            event.frameId = 15;
+            snprintf(event.eventType, sizeof(event.eventType), "script");
+            snprintf(event.action, sizeof(event.action), "anim_event_%u", i);
+
+            animations[i].events.push_back(event);
+            animations[i].streams.push_back(buildStream(i));
+        }
+
+        return SKA::writeToFile(path, SKA::Header(), bones, animations);
+    }
+
+    bool writeMDF(const std::string& path, const std::vector<std::string>& texturePaths, uint32_t extraLines)
+    {
+        const char* extras[] = {
+            "LinearFiltering",
+            "Double",
+            "UVType 0 Mesh",
+            "BlendType 0 Modulate",
+            "SpeedU 0 0.5",
+            "SpeedV 0 0.25",
+            "Color 255 255 255 255",
+            "SpecularPower 50"
+        };
+
+        std::ofstream file;
+        if (!openForWrite(file, path, std::ios::out))
+            return false;
+
+        file << "Textured\n";
+
+        for (size_t i = 0; i < texturePaths.size() && i < 4; i++)
+        {
+            if (i)
+                file << "Texture " << i << " \"" << texturePaths[i] << "\"\n";
+            else
+                file << "Texture \"" << texturePaths[i] << "\"\n";
+        }
+
+        for (uint32_t i = 0; i < extraLines; i++)
+            file << extras[i % 8] << "\n";
+
+        return finish(file, path);
+    }
+
+    // uncompressed 32 bit, 8x8 checkerboard of two seeded colors
+    bool writeTGA(const std::string& path, uint32_t width, uint32_t height, uint32_t seed)
+    {
+        Random random(seed);
+
+        width = std::clamp<uint32_t>(width, 1, 65535);
+        height = std::clamp<uint32_t>(height, 1, 65535);
+
+        uint8_t header[18] = { 0 };
+        header[2] = 2;
+        header[12] = width & 0xFF;
+        header[13] = (width >> 8) & 0xFF;
+        header[14] = height & 0xFF;
+        header[15] = (height >> 8) & 0xFF;
+        header[16] = 32;
+        header[17] = 8; // alpha bits
+
+        uint32_t colors[2] = { random.next() | 0xFF000000u, random.next() | 0xFF000000u };
+        uint32_t cellWidth = std::max<uint32_t>(width / 8, 1);
+        uint32_t cellHeight = std::max<uint32_t>(height / 8, 1);
+
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint32_t color = colors[(x / cellWidth + y / cellHeight) % 2];
+                std::memcpy(&pixels[(static_cast<size_t>(y) * width + x) * 4], &color, 4);
+            }
+        }
+
+        std::ofstream file;
+        if (!openForWrite(file, path, std::ios::binary))
+            return false;
+
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+
+        return finish(file, path);
+    }
+
+    // a bumpy square patch of ground, Z-up like the game's clipping meshes
+    bool writeDAG(const std::string& path, uint32_t vertexCount, uint32_t faceCount, uint32_t seed)
+    {
+        Random random(seed);
+
+        vertexCount = std::clamp<uint32_t>(vertexCount, 3, 65535);
+
+        uint32_t columns = std::max<uint32_t>(static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(vertexCount)))), 2);
+        uint32_t rows = (vertexCount + columns - 1) / columns;
+
+        if (!faceCount)
+            faceCount = defaultFaceCount(columns, rows, vertexCount, false);
+
+        const float spacing = 10.f;
+
+        std::vector<DAG::Vertex> vertices(vertexCount);
+
+        DAG::Header header;
+        header.xOffset = (columns - 1) * spacing * .5f;
+        header.yOffset = (rows - 1) * spacing * .5f;
+
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            vertices[i].x = (i % columns) * spacing;
+            vertices[i].y = (i / columns) * spacing;
+            vertices[i].z = random.range(0.f, 2.f);
+
+            float dx = vertices[i].x - header.xOffset;
+            float dy = vertices[i].y - header.yOffset;
+            header.boundingBoxRadius = std::max(header.boundingBoxRadius, std::sqrt(dx * dx + dy * dy));
+        }
+
+        DAG::DataBlock dataBlock;
+        dataBlock.vertexCount = vertexCount;
+        dataBlock.faceCount = faceCount;
+        dataBlock.faceDataOffset = dataBlock.vertexDataOffset + vertexCount * sizeof(DAG::Vertex);
+
+        std::ofstream file;
+        if (!openForWrite(file, path, std::ios::binary))
+            return false;
+
+        writeRaw(file, header);
+        writeRaw(file, dataBlock);
+        file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(DAG::Vertex));
+
+        for (uint32_t i = 0; i < faceCount; i++)
+        {
+            DAG::Face face;
+            gridFace(i, columns, rows, vertexCount, false, face.vertexIndex);
+            writeRaw(file, face);
+        }
+
+        return finish(file, path);
+    }
+
+    bool generate(const Options& options)
+    {
+        const fs::path root = options.outputPath;
+        const std::string meshDir = "art/meshes/synthetic/";
+        const std::string clipDir = "art/clip/synthetic/";
+
+        std::error_code error;
+        fs::create_directories(root / meshDir / "materials", error);
+        fs::create_directories(root / meshDir / "textures", error);
+        fs::create_directories(root / clipDir, error);
+
+        if (error)
+        {
+            LOG_ERROR << "[SyntheticAssets] Failed to create " << options.outputPath << ": " << error.message();
+            return false;
+        }
+
+        auto numbered = [](const std::string& prefix, uint32_t index, const char* extension)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "%04u%s", index, extension);
+            return prefix + name;
+        };
+
+        uint32_t texturePool = std::max<uint32_t>(options.texturePool, 1);
+        uint32_t materialPool = std::max<uint32_t>(options.materialPool, 1);
+        uint32_t materialCount = std::max<uint32_t>(options.materialCount, 1);
+
+        std::vector<std::function<bool()>> jobs;
+
+        for (uint32_t i = 0; i < texturePool; i++)
+        {
+            std::string path = (root / numbered(meshDir + "textures/texture_", i, ".tga")).generic_string();
+            jobs.push_back([=]() { return writeTGA(path, options.textureSize, options.textureSize, options.mesh.seed + i); });
+        }
+
+        for (uint32_t i = 0; i < materialPool; i++)
+        {
+            std::string path = (root / numbered(meshDir + "materials/material_", i, ".mdf")).generic_string();
+            std::vector<std::string> textures = { numbered(meshDir + "textures/texture_", i % texturePool, ".tga") };
+            jobs.push_back([=]() { return writeMDF(path, textures); });
+        }
+
+        for (uint32_t i = 0; i < options.modelCount; i++)
+        {
+            std::string skmPath = (root / numbered(meshDir + "model_", i, ".SKM")).generic_string();
+            std::string skaPath = skmPath.substr(0, skmPath.size() - 1) + "A";
+
+            std::vector<std::string> materials;
+
+            for (uint32_t j = 0; j < materialCount; j++)
+                materials.push_back(numbered(meshDir + "materials/material_", (i * materialCount + j) % materialPool, ".mdf"));
+
+            MeshParams mesh = options.mesh;
+            mesh.seed += i;
+
+            jobs.push_back([=]() { return writeSKM(skmPath, mesh, materials) && writeSKA(skaPath, mesh.boneCount, options.animationCount); });
+        }
+
+        for (uint32_t i = 0; i < options.dagCount; i++)
+        {
+            std::string path = (root / numbered(clipDir + "clip_", i, ".dag")).generic_string();
+            jobs.push_back([=]() { return writeDAG(path, options.dagVertexCount, options.dagFaceCount, options.mesh.seed + i); });
+        }
+
+        std::atomic<bool> success{ true };
+        ThreadPool pool(options.threads);
+
+        pool.parallelFor(jobs.size(), [&](size_t index)
+        {
+            if (!jobs[index]())
+                success = false;
+        });
+
+        LOG_INFO << "[SyntheticAssets] Wrote " << options.modelCount << " models, " << materialPool << " materials, " << texturePool << " textures and "
+            << options.dagCount << " DAGs to " << options.outputPath;
+
+        return success;
+    }
+
+    bool parseArgs(int argc, char* argv[], Options& options)
+    {
+        // SyntheticAssets <output data dir> [--models N] [--vertices N] [--faces N] [--bones N] [--weights N] [--materials N] [--material-pool N]
+        //     [--animations N] [--texture-size N] [--textures N] [--dags N] [--dag-vertices N] [--dag-faces N] [--seed N] [--threads N]
+        if (argc < 2 || argv[1][0] == '-')
+            return false;
+
+        options.outputPath = argv[1];
+        std::replace(options.outputPath.begin(), options.outputPath.end(), '\\', '/');
+
+        struct Flag
+        {
+            const char* name;
+            uint32_t* value;
+            uint32_t min;
+            uint32_t max;
+        };
+
+        const Flag flags[] = {
+            { "--models", &options.modelCount, 0, 1000000 },
+            { "--vertices", &options.mesh.vertexCount, 3, 65535 },
+            { "--faces", &options.mesh.faceCount, 0, 10000000 },
+            { "--bones", &options.mesh.boneCount, 1, 1024 },
+            { "--weights", &options.mesh.weightsPerVertex, 1, 6 },
+            { "--materials", &options.materialCount, 1, 256 },
+            { "--material-pool", &options.materialPool, 1, 1000000 },
+            { "--animations", &options.animationCount, 0, INT16_MAX },
+            { "--texture-size", &options.textureSize, 1, 8192 },
+            { "--textures", &options.texturePool, 1, 1000000 },
+            { "--dags", &options.dagCount, 0, 1000000 },
+            { "--dag-vertices", &options.dagVertexCount, 3, 65535 },
+            { "--dag-faces", &options.dagFaceCount, 0, 10000000 },
+            { "--seed", &options.mesh.seed, 0, UINT32_MAX },
+            { "--threads", &options.threads, 0, 256 }
+        };
+
+        for (int i = 2; i < argc; i++)
+        {
+            bool known = false;
+
+            for (const auto& flag : flags)
+            {
+                if (strcmp(argv[i], flag.name) == 0 && i + 1 < argc)
+                {
+                    *flag.value = static_cast<uint32_t>(std::clamp<unsigned long long>(strtoull(argv[++i], nullptr, 10), flag.min, flag.max));
+                    known = true;
+                    break;
+                }
+            }
+
+            if (!known)
+            {
+                LOG_ERROR << "[SyntheticAssets] Unknown argument " << argv[i];
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Writes valid but made up DAG, SKM, SKA, MDF and TGA files, so loaders and tools can be measured without the game's art.
+// Everything is deterministic for a given seed.
+namespace SyntheticAssets
+{
+    struct MeshParams
+    {
+        uint32_t vertexCount = 2048;   // 3-65535, faces index vertices with 16 bits
+        uint32_t faceCount = 0;        // 0 = about two per vertex
+        uint32_t boneCount = 32;
+        uint32_t weightsPerVertex = 2; // 1-6, more than 4 hits the viewer's weight reduction path
+        uint32_t seed = 1;
+    };
+
+    struct Options
+    {
+        std::string outputPath;        // data directory, files go to <outputPath>/art/...
+        MeshParams mesh;
+        uint32_t modelCount = 16;
+        uint32_t materialCount = 2;    // per model
+        uint32_t materialPool = 8;     // distinct MDF files shared by all models
+        uint32_t animationCount = 16;  // per SKA
+        uint32_t textureSize = 256;
+        uint32_t texturePool = 8;      // distinct TGA files shared by all materials
+        uint32_t dagCount = 16;
+        uint32_t dagVertexCount = 1024;
+        uint32_t dagFaceCount = 0;     // 0 = about two per vertex
+        uint32_t threads = 0;          // 0 = one per hardware thread
+    };
+
+    // material paths are relative to the data directory, like in the game files
+    bool writeSKM(const std::string& path, const MeshParams& params, const std::vector<std::string>& materialPaths);
+    bool writeSKA(const std::string& path, uint32_t boneCount, uint32_t animationCount);
+    bool writeMDF(const std::string& path, const std::vector<std::string>& texturePaths, uint32_t extraLines = 0);
+    bool writeTGA(const std::string& path, uint32_t width, uint32_t height, uint32_t seed = 1);
+    bool writeDAG(const std::string& path, uint32_t vertexCount, uint32_t faceCount = 0, uint32_t seed = 1);
+
+    // full fake art tree:
+    // art/meshes/synthetic/model_NNNN.SKM + .SKA, art/meshes/synthetic/materials/*.mdf,
+    // art/meshes/synthetic/textures/*.tga and art/clip/synthetic/*.dag
+    bool generate(const Options& options);
+
+    bool parseArgs(int argc, char* argv[], Options& options);
+}
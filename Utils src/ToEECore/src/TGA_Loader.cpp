@@ -1,12 +1,14 @@
+#include "LoadStats.hpp"
 #include "TGA_Loader.hpp"
-
-#include <fstream>
+#include "VFS.hpp"
 
 namespace TGA
 {
     bool loadTGA(const std::string& filepath, TGAImage& outImage)
     {
-        std::ifstream file(filepath, std::ios::binary);
+        LOAD_STAGE("TGA decode");
+
+        VFS::File file(filepath);
 
         if (!file)
             return false;
@@ -14,6 +16,7 @@ namespace TGA
         uint8_t header[18] = { 0 };
 
         file.read(reinterpret_cast<char*>(header), 18);
+        LoadStats::addBytesRead(file.gcount());
         if (file.gcount() != 18)
             return false;
 
@@ -30,6 +33,7 @@ namespace TGA
 
         std::vector<uint8_t> rawData(pixelCount * bytesPerPixel);
         file.read(reinterpret_cast<char*>(rawData.data()), rawData.size());
+        LoadStats::addBytesRead(file.gcount());
         if (!file)
             return false;
 
@@ -50,21 +54,4 @@ namespace TGA
 
         return true;
     }
-
-    TGAImage& getOrLoadTexture(const std::string& fullPath, std::unordered_map<std::string, TGAImage>& textureCache)
-    {
-        auto it = textureCache.find(fullPath);
-
-        if (it != textureCache.end())
-            return it->second;
-
-        TGAImage tex;
-        if (loadTGA(fullPath, tex))
-        {
-            textureCache[fullPath] = std::move(tex);
-            return textureCache[fullPath];
-        }
-
-        throw std::runtime_error("Failed to load TGA: " + fullPath);
-    }
 }
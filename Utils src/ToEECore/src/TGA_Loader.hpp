@@ -1,8 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <string>
-#include <unordered_map>
 
 namespace TGA
 {
@@ -13,7 +13,6 @@ namespace TGA
         std::vector<uint8_t> pixels;
     };
 
+    // decoded images are shared through MDF::MaterialCache, which decodes every file once
     bool loadTGA(const std::string& filepath, TGAImage& outImage);
-
-    TGAImage& getOrLoadTexture(const std::string& fullPath, std::unordered_map<std::string, TGAImage>& textureCache);
 }
@@ -0,0 +1,127 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+static thread_local bool insidePoolJob = false;
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (!threadCount)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threadCount - 1);
+
+    for (uint32_t i = 1; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    wakeCondition.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+    if (!count)
+        return;
+
+    if (insidePoolJob || workers.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            job(i);
+
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock(submitMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentJob = &job;
+        jobCount = count;
+        nextIndex = 0;
+        activeWorkers = static_cast<uint32_t>(workers.size());
+        generation++;
+    }
+
+    wakeCondition.notify_all();
+
+    insidePoolJob = true;
+    runIndices();
+    insidePoolJob = false;
+
+    std::exception_ptr thrown;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+        currentJob = nullptr;
+        thrown = std::move(error);
+        error = nullptr;
+    }
+
+    if (thrown)
+        std::rethrow_exception(thrown);
+}
+
+void ThreadPool::workerLoop()
+{
+    uint64_t seenGeneration = 0;
+    insidePoolJob = true;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+
+            if (stopping)
+                return;
+
+            seenGeneration = generation;
+        }
+
+        runIndices();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWorkers--;
+        }
+
+        doneCondition.notify_one();
+    }
+}
+
+void ThreadPool::runIndices()
+{
+    while (true)
+    {
+        size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+
+        if (index >= jobCount)
+            break;
+
+        // an exception must not leave a worker thread, parallelFor rethrows it once every thread is done
+        try
+        {
+            (*currentJob)(index);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!error)
+                error = std::current_exception();
+
+            nextIndex = jobCount;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent workers for data-parallel loops. The calling thread takes part in the work.
+// Calling parallelFor from inside a job runs the nested loop serially instead of deadlocking.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(uint32_t threadCount = 0); // 0 = one per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // runs job(index) for every index in [0, count), returns once all are done; if a job throws, the indices not
+    // started yet are skipped and the first exception is rethrown here
+    void parallelFor(size_t count, const std::function<void(size_t)>& job);
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::mutex submitMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    const std::function<void(size_t)>* currentJob = nullptr;
+    size_t jobCount = 0;
+    uint64_t generation = 0;
+    std::atomic<size_t> nextIndex{ 0 };
+    uint32_t activeWorkers = 0;
+    std::exception_ptr error; // first exception of the current loop
+    bool stopping = false;
+
+    void workerLoop();
+    void runIndices();
+};
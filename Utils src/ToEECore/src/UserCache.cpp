@@ -0,0 +1,34 @@
+#include "UserCache.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace UserCache
+{
+    std::string getDirectory()
+    {
+        fs::path cache;
+
+        for (const char* variable : { "LOCALAPPDATA", "XDG_CACHE_HOME" })
+        {
+            const char* value = std::getenv(variable);
+
+            if (value && *value)
+            {
+                cache = value;
+                break;
+            }
+        }
+
+        if (cache.empty())
+        {
+            const char* home = std::getenv("HOME");
+            std::error_code ec;
+            cache = home && *home ? fs::path(home) / ".cache" : fs::temp_directory_path(ec);
+        }
+
+        return (cache / "ToEEModelViewer").generic_string() + "/";
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+// Per user directory for files that can be rebuilt at any time (asset index, shader binaries), so nothing has to be
+// written next to the game data or into the working directory.
+namespace UserCache
+{
+    // %LOCALAPPDATA%, $XDG_CACHE_HOME or ~/.cache (the system temp directory if none of them is set) plus
+    // ToEEModelViewer/, forward slashes and a trailing slash; not created here, writers create what they need
+    std::string getDirectory();
+}
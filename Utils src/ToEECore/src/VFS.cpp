@@ -0,0 +1,531 @@
+#include "Inflate.hpp"
+#include "LoadStats.hpp"
+#include "Logger.hpp"
+#include "VFS.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace VFS
+{
+    namespace
+    {
+#pragma pack(push, 1)
+        // last 28 bytes of a .dat, dataSize counts back from the end of the file to the directory table
+        struct Footer
+        {
+            uint8_t guid[16];
+            char magic[4];
+            uint32_t filenameSize;
+            uint32_t dataSize;
+        };
+
+        struct EntryData
+        {
+            uint32_t namePointer;
+            uint32_t flags;
+            uint32_t uncompressedSize;
+            uint32_t compressedSize;
+            uint32_t offset;
+            int32_t parent;
+            int32_t firstChild;
+            int32_t nextSibling;
+        };
+#pragma pack(pop)
+
+        enum EntryFlags : uint32_t
+        {
+            ENTRY_FLAG_RAW = 0x1,
+            ENTRY_FLAG_COMPRESSED = 0x2,
+            ENTRY_FLAG_DIRECTORY = 0x400
+        };
+
+        struct Entry
+        {
+            uint32_t flags = 0;
+            uint32_t uncompressedSize = 0;
+            uint32_t compressedSize = 0;
+            uint32_t offset = 0;
+        };
+
+        struct Archive
+        {
+            std::string path;
+            std::FILE* file = nullptr;
+            std::mutex mutex;
+            int64_t modified = 0;
+            std::unordered_map<std::string, Entry> entries;
+
+            ~Archive()
+            {
+                if (file)
+                    fclose(file);
+            }
+        };
+
+        struct Mount
+        {
+            std::string directory; // original case with a trailing slash, empty for archives
+            std::string directoryKey;
+            std::unique_ptr<Archive> archive;
+        };
+
+        struct Location
+        {
+            std::string loosePath;
+            Archive* archive = nullptr;
+            const Entry* entry = nullptr;
+        };
+
+        // reads hold it shared for the whole lookup and read, so changing the mounts waits for every read in flight
+        std::shared_mutex mountMutex;
+        std::vector<Mount> mounts;
+
+        // freed buffers keep their capacity for the next file, big one-off files aren't kept around
+        const size_t maxPooledBuffers = 16;
+        const size_t maxPooledCapacity = 16 * 1024 * 1024;
+
+        std::mutex poolMutex;
+        std::vector<std::vector<uint8_t>> bufferPool;
+
+        std::vector<uint8_t> acquireBuffer()
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+
+            if (bufferPool.empty())
+                return {};
+
+            std::vector<uint8_t> buffer = std::move(bufferPool.back());
+            bufferPool.pop_back();
+
+            return buffer;
+        }
+
+        void releaseBuffer(std::vector<uint8_t>&& buffer)
+        {
+            if (buffer.capacity() == 0 || buffer.capacity() > maxPooledCapacity)
+                return;
+
+            buffer.clear();
+
+            std::lock_guard<std::mutex> lock(poolMutex);
+
+            if (bufferPool.size() < maxPooledBuffers)
+                bufferPool.push_back(std::move(buffer));
+        }
+
+        std::string normalize(const std::string& path)
+        {
+            std::string result = path;
+
+            for (char& c : result)
+                c = c == '\\' ? '/' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+            return result;
+        }
+
+        std::string withTrailingSlash(const std::string& path)
+        {
+            std::string result = path;
+            std::replace(result.begin(), result.end(), '\\', '/');
+
+            if (!result.empty() && result.back() != '/')
+                result += '/';
+
+            return result;
+        }
+
+        bool readLoose(const std::string& path, std::vector<uint8_t>& buffer)
+        {
+            std::FILE* file = fopen(path.c_str(), "rb");
+
+            if (!file)
+                return false;
+
+            bool ok = fseek(file, 0, SEEK_END) == 0;
+            long size = ok ? ftell(file) : -1;
+            ok = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+
+            if (ok)
+            {
+                buffer.resize(static_cast<size_t>(size));
+                ok = fread(buffer.data(), 1, buffer.size(), file) == buffer.size();
+            }
+
+            fclose(file);
+
+            return ok;
+        }
+
+        bool readEntry(Archive& archive, const Entry& entry, std::vector<uint8_t>& buffer)
+        {
+            bool compressed = (entry.flags & ENTRY_FLAG_COMPRESSED) != 0;
+            std::vector<uint8_t> packed = compressed ? acquireBuffer() : std::vector<uint8_t>();
+            std::vector<uint8_t>& target = compressed ? packed : buffer;
+
+            target.resize(compressed ? entry.compressedSize : entry.uncompressedSize);
+
+            {
+                std::lock_guard<std::mutex> lock(archive.mutex);
+
+                if (fseek(archive.file, static_cast<long>(entry.offset), SEEK_SET) != 0 || fread(target.data(), 1, target.size(), archive.file) != target.size())
+                {
+                    releaseBuffer(std::move(packed));
+                    return false;
+                }
+            }
+
+            if (!compressed)
+                return true;
+
+            // decompressed outside the lock so parallel loads from one archive only serialize on the raw read
+            buffer.resize(entry.uncompressedSize);
+            size_t written = Inflate::zlibDecompress(packed.data(), packed.size(), buffer.data(), buffer.size());
+            releaseBuffer(std::move(packed));
+
+            if (written != entry.uncompressedSize)
+            {
+                LOG_ERROR << "[VFS] Corrupt entry in " << archive.path;
+                return false;
+            }
+
+            return true;
+        }
+
+        // newest mount first, absolute paths outside every mounted folder are left to the file system
+        bool locate(const std::string& path, Location& location)
+        {
+            std::string fixedPath = path;
+            std::replace(fixedPath.begin(), fixedPath.end(), '\\', '/');
+
+            std::string key = normalize(fixedPath);
+            std::string relative = fixedPath;
+            bool absolute = fs::path(fixedPath).is_absolute();
+            bool insideMount = !absolute;
+
+            for (const auto& mount : mounts)
+            {
+                if (!mount.archive && key.compare(0, mount.directoryKey.size(), mount.directoryKey) == 0)
+                {
+                    relative = fixedPath.substr(mount.directory.size());
+                    key.erase(0, mount.directoryKey.size());
+                    insideMount = true;
+                    break;
+                }
+            }
+
+            if (insideMount)
+            {
+                std::error_code ec;
+
+                for (auto it = mounts.rbegin(); it != mounts.rend(); ++it)
+                {
+                    if (it->archive)
+                    {
+                        auto entry = it->archive->entries.find(key);
+
+                        if (entry != it->archive->entries.end())
+                        {
+                            location.archive = it->archive.get();
+                            location.entry = &entry->second;
+                            return true;
+                        }
+                    }
+                    else if (fs::is_regular_file(it->directory + relative, ec))
+                    {
+                        location.loosePath = it->directory + relative;
+                        return true;
+                    }
+                }
+            }
+
+            // relative paths that no mount knows about are still tried against the working directory
+            location.loosePath = fixedPath;
+
+            std::error_code ec;
+            return fs::is_regular_file(fixedPath, ec);
+        }
+    }
+
+    File::File(const std::string& path)
+    {
+        open(path);
+    }
+
+    File::~File()
+    {
+        close();
+    }
+
+    bool File::open(const std::string& path)
+    {
+        LOAD_STAGE("File read");
+
+        close();
+
+        buffer = acquireBuffer();
+
+        Location location;
+        std::shared_lock<std::shared_mutex> lock(mountMutex);
+
+        if (mounts.empty())
+            opened = readLoose(path, buffer);
+        else if (locate(path, location))
+            opened = location.archive ? readEntry(*location.archive, *location.entry, buffer) : readLoose(location.loosePath, buffer);
+
+        return opened;
+    }
+
+    void File::close()
+    {
+        releaseBuffer(std::move(buffer));
+        buffer = std::vector<uint8_t>();
+
+        position = 0;
+        lastRead = 0;
+        opened = false;
+        failed = false;
+    }
+
+    // short reads copy what is there and put the file in a failed state, like a stream would
+    File& File::read(char* destination, size_t count)
+    {
+        lastRead = 0;
+
+        if (!*this)
+            return *this;
+
+        lastRead = std::min(count, buffer.size() - position);
+
+        if (lastRead)
+            memcpy(destination, buffer.data() + position, lastRead);
+
+        position += lastRead;
+        failed = lastRead != count;
+
+        return *this;
+    }
+
+    File& File::seekg(size_t newPosition)
+    {
+        if (!*this)
+            return *this;
+
+        if (newPosition > buffer.size())
+            failed = true;
+        else
+            position = newPosition;
+
+        return *this;
+    }
+
+    bool mountArchive(const std::string& datPath)
+    {
+        auto archive = std::make_unique<Archive>();
+        archive->path = datPath;
+        archive->file = fopen(datPath.c_str(), "rb");
+
+        if (!archive->file)
+        {
+            LOG_ERROR << "[VFS] Failed to open archive: " << datPath;
+            return false;
+        }
+
+        Footer footer;
+        long fileSize = 0;
+
+        if (fseek(archive->file, 0, SEEK_END) != 0 || (fileSize = ftell(archive->file)) < static_cast<long>(sizeof(Footer)) ||
+            fseek(archive->file, fileSize - static_cast<long>(sizeof(Footer)), SEEK_SET) != 0 || fread(&footer, sizeof(Footer), 1, archive->file) != 1 ||
+            (memcmp(footer.magic, "1TAD", 4) != 0 && memcmp(footer.magic, "DAT1", 4) != 0) || footer.dataSize > static_cast<uint32_t>(fileSize))
+        {
+            LOG_ERROR << "[VFS] Not a ToEE .dat archive: " << datPath;
+            return false;
+        }
+
+        // the directory table is read once here and searched through a hash map afterwards
+        std::vector<uint8_t> table(footer.dataSize);
+
+        if (fseek(archive->file, fileSize - static_cast<long>(footer.dataSize), SEEK_SET) != 0 || fread(table.data(), 1, table.size(), archive->file) != table.size())
+        {
+            LOG_ERROR << "[VFS] Failed to read directory of " << datPath;
+            return false;
+        }
+
+        LoadStats::addBytesRead(table.size());
+
+        size_t offset = 0;
+        auto readU32 = [&](uint32_t& value)
+        {
+            if (offset + 4 > table.size())
+                return false;
+
+            memcpy(&value, table.data() + offset, 4);
+            offset += 4;
+
+            return true;
+        };
+
+        uint32_t entryCount = 0;
+        readU32(entryCount);
+
+        std::vector<std::string> names;
+        std::vector<EntryData> entries;
+
+        for (uint32_t i = 0; i < entryCount; i++)
+        {
+            uint32_t nameLength = 0;
+            EntryData data;
+
+            if (!readU32(nameLength) || offset + nameLength + sizeof(EntryData) > table.size())
+            {
+                LOG_ERROR << "[VFS] Truncated directory in " << datPath;
+                return false;
+            }
+
+            const char* name = reinterpret_cast<const char*>(table.data() + offset);
+            names.emplace_back(name, strnlen(name, nameLength));
+            offset += nameLength;
+
+            memcpy(&data, table.data() + offset, sizeof(EntryData));
+            offset += sizeof(EntryData);
+            entries.push_back(data);
+        }
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            // bare names are relative to their parent directory entry
+            if (names[i].find_first_of("/\\") == std::string::npos && entries[i].parent >= 0 && static_cast<size_t>(entries[i].parent) < i)
+                names[i] = names[entries[i].parent] + "/" + names[i];
+
+            if (entries[i].flags & ENTRY_FLAG_DIRECTORY)
+                continue;
+
+            Entry entry;
+            entry.flags = entries[i].flags;
+            entry.uncompressedSize = entries[i].uncompressedSize;
+            entry.compressedSize = entries[i].compressedSize;
+            entry.offset = entries[i].offset;
+
+            archive->entries[normalize(names[i])] = entry;
+        }
+
+        std::error_code ec;
+        archive->modified = static_cast<int64_t>(fs::last_write_time(datPath, ec).time_since_epoch().count());
+
+        LOG_INFO << "[VFS] Mounted " << datPath << " (" << archive->entries.size() << " files)";
+
+        Mount mount;
+        mount.archive = std::move(archive);
+
+        std::unique_lock<std::shared_mutex> lock(mountMutex);
+        mounts.push_back(std::move(mount));
+
+        return true;
+    }
+
+    bool mountDirectory(const std::string& path)
+    {
+        std::error_code ec;
+
+        if (!fs::is_directory(path, ec))
+        {
+            LOG_ERROR << "[VFS] Not a directory: " << path;
+            return false;
+        }
+
+        Mount mount;
+        mount.directory = withTrailingSlash(path);
+        mount.directoryKey = normalize(mount.directory);
+
+        std::unique_lock<std::shared_mutex> lock(mountMutex);
+        mounts.push_back(std::move(mount));
+
+        return true;
+    }
+
+    std::string mountGameDirectory(const std::string& installPath)
+    {
+        std::string root = withTrailingSlash(installPath);
+
+        for (const std::string& directory : { root, root + "modules/" })
+        {
+            std::vector<std::string> archives;
+            std::error_code ec;
+
+            for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+            {
+                std::string extension = normalize(it->path().extension().string());
+
+                if (extension == ".dat" && it->is_regular_file(ec))
+                    archives.push_back(it->path().generic_string());
+            }
+
+            // ToEE1.dat .. ToEE4.dat, later ones patch earlier ones
+            std::sort(archives.begin(), archives.end());
+
+            for (const auto& archive : archives)
+                mountArchive(archive);
+        }
+
+        std::error_code ec;
+        std::string loose = fs::is_directory(root + "data", ec) ? root + "data/" : root;
+
+        mountDirectory(loose);
+
+        return loose;
+    }
+
+    void unmountAll()
+    {
+        std::unique_lock<std::shared_mutex> lock(mountMutex);
+        mounts.clear();
+    }
+
+    bool hasArchives()
+    {
+        std::shared_lock<std::shared_mutex> lock(mountMutex);
+        return std::any_of(mounts.begin(), mounts.end(), [](const Mount& mount) { return mount.archive != nullptr; });
+    }
+
+    bool exists(const std::string& path)
+    {
+        Location location;
+        std::shared_lock<std::shared_mutex> lock(mountMutex);
+
+        if (mounts.empty())
+        {
+            std::error_code ec;
+            return fs::is_regular_file(path, ec);
+        }
+
+        return locate(path, location);
+    }
+
+    void forEachArchiveFile(const std::function<void(const std::string& path, uint64_t size, int64_t modified)>& callback)
+    {
+        std::unordered_set<std::string> seen;
+        std::shared_lock<std::shared_mutex> lock(mountMutex);
+
+        for (auto it = mounts.rbegin(); it != mounts.rend(); ++it)
+        {
+            if (!it->archive)
+                continue;
+
+            for (const auto& [key, entry] : it->archive->entries)
+            {
+                if (seen.insert(key).second)
+                    callback(key, entry.uncompressedSize, it->archive->modified);
+            }
+        }
+    }
+}
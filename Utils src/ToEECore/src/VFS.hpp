@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Virtual file system over ToEE .dat archives and loose folders. Mounts are searched newest first, so folders
+// mounted after the archives override files inside them, the same way the game's data directory does.
+// With nothing mounted (or for absolute paths outside every mounted folder) files are read straight from disk.
+// Reading is thread safe, mounting and unmounting wait for the reads in flight to finish.
+namespace VFS
+{
+    // Whole file in a pooled buffer with the ifstream subset the loaders use, so reading through it is a one line change.
+    // Archive entries are decompressed on open, loose files are read with a single call.
+    class File
+    {
+    public:
+        File() = default;
+        explicit File(const std::string& path);
+        ~File();
+
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+
+        bool open(const std::string& path);
+        void close();
+
+        File& read(char* destination, size_t count);
+        File& seekg(size_t position);
+        size_t gcount() const { return lastRead; }
+        explicit operator bool() const { return opened && !failed; }
+
+        const char* data() const { return reinterpret_cast<const char*>(buffer.data()); }
+        size_t size() const { return buffer.size(); }
+
+    private:
+        std::vector<uint8_t> buffer;
+        size_t position = 0;
+        size_t lastRead = 0;
+        bool opened = false;
+        bool failed = false;
+    };
+
+    bool mountArchive(const std::string& datPath);
+    bool mountDirectory(const std::string& path);
+
+    // every *.dat in installPath and installPath/modules, then installPath/data as the loose override folder,
+    // returns the folder loose files are expected in (installPath itself when there is no data subfolder)
+    std::string mountGameDirectory(const std::string& installPath);
+
+    void unmountAll();
+    bool hasArchives();
+
+    bool exists(const std::string& path);
+
+    // files inside mounted archives as lower case relative paths, shadowed entries listed once; callback must not mount or unmount
+    void forEachArchiveFile(const std::function<void(const std::string& path, uint64_t size, int64_t modified)>& callback);
+}
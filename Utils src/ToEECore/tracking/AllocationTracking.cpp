@@ -0,0 +1,49 @@
+#include "LoadStats.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation operators to count every heap allocation for LoadStats. Not part of the ToEECore library:
+// only programs linking ToEEAllocationTracking compile this file, everything else keeps the default operators.
+void* operator new(std::size_t size)
+{
+    LoadStats::addAllocation(size);
+
+    for (;;)
+    {
+        if (void* ptr = std::malloc(size ? size : 1))
+            return ptr;
+
+        // same as the default operator: let the handler free memory and retry, throw once there is none
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
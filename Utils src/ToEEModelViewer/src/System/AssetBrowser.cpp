@@ -0,0 +1,124 @@
+#include "AssetBrowser.hpp"
+#include "VFS.hpp"
+
+#include <imgui.h>
+#include <tinyfiledialogs.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace AssetBrowser
+{
+    bool drawPanel(AssetDatabase& database, bool* open, std::string& selectedPath)
+    {
+        static char query[256] = "";
+        static int highlighted = 0;
+        static std::vector<const AssetDatabase::Asset*> results;
+
+        ImGui::SetNextWindowSize(ImVec2(480.f, 520.f), ImGuiCond_FirstUseEver);
+
+        if (!ImGui::Begin("Open by Name", open))
+        {
+            ImGui::End();
+            return false;
+        }
+
+        if (ImGui::Button(database.isOpen() ? "Change data directory..." : "Open data directory..."))
+        {
+            const char* path = tinyfd_selectFolderDialog("Select Temple of Elemental Evil install or data directory", database.getRootPath().c_str());
+
+            // an install directory gets its .dat archives mounted under the loose data folder, nothing has to be extracted;
+            // unmounting blocks until every file still being read from the old mounts is done
+            if (path)
+            {
+                VFS::unmountAll();
+                database.open(VFS::mountGameDirectory(path));
+            }
+        }
+
+        if (!database.isOpen())
+        {
+            ImGui::TextWrapped("Pick the game install directory (with its .dat archives) or an extracted data directory containing art/ to index every model in it.");
+            ImGui::End();
+            return false;
+        }
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Rescan"))
+            database.open(database.getRootPath());
+
+        ImGui::TextUnformatted(database.getRootPath().c_str());
+        ImGui::Text("%zu assets, %zu parsed on last scan%s", database.getAssetCount(), database.getScannedCount(), VFS::hasArchives() ? ", archives mounted" : "");
+
+        if (ImGui::IsWindowAppearing())
+            ImGui::SetKeyboardFocusHere();
+
+        ImGui::SetNextItemWidth(-1.f);
+        bool queryChanged = ImGui::InputTextWithHint("##query", "model name", query, sizeof(query));
+        bool confirmed = ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) && ImGui::IsKeyPressed(ImGuiKey_Enter, false);
+
+        if (queryChanged)
+            highlighted = 0;
+
+        if (ImGui::IsKeyPressed(ImGuiKey_DownArrow))
+            highlighted++;
+
+        if (ImGui::IsKeyPressed(ImGuiKey_UpArrow))
+            highlighted--;
+
+        // a linear scan over a few thousand lower case names is cheap enough to redo every frame
+        database.search(query, AssetDatabase::TYPE_SKM, 1000, results);
+        highlighted = results.empty() ? 0 : std::max(0, std::min(highlighted, static_cast<int>(results.size()) - 1));
+
+        bool picked = false;
+        float detailsHeight = ImGui::GetTextLineHeightWithSpacing() * 4.f;
+
+        if (ImGui::BeginChild("Results", ImVec2(0.f, -detailsHeight), true))
+        {
+            for (int i = 0; i < static_cast<int>(results.size()); i++)
+            {
+                if (ImGui::Selectable(results[i]->path.c_str(), i == highlighted, ImGuiSelectableFlags_AllowDoubleClick))
+                {
+                    highlighted = i;
+                    picked = ImGui::IsMouseDoubleClicked(0);
+                }
+
+                if (i == highlighted && (queryChanged || ImGui::IsKeyPressed(ImGuiKey_DownArrow) || ImGui::IsKeyPressed(ImGuiKey_UpArrow)))
+                    ImGui::SetScrollHereY();
+            }
+        }
+
+        ImGui::EndChild();
+
+        if (!results.empty())
+        {
+            AssetDatabase::Dependencies dependencies = database.resolve(*results[highlighted]);
+
+            ImGui::Text("Animation: %s", dependencies.animation ? dependencies.animation->path.c_str() : "none");
+            ImGui::Text("%zu materials, %zu textures", dependencies.materials.size(), dependencies.textures.size());
+
+            if (!dependencies.missing.empty())
+            {
+                ImGui::TextColored(ImVec4(1.f, .4f, .4f, 1.f), "%zu missing", dependencies.missing.size());
+
+                if (ImGui::IsItemHovered())
+                {
+                    ImGui::BeginTooltip();
+
+                    for (const auto& key : dependencies.missing)
+                        ImGui::TextUnformatted(key.c_str());
+
+                    ImGui::EndTooltip();
+                }
+            }
+
+            if (picked || confirmed)
+                selectedPath = database.getFullPath(*results[highlighted]);
+        }
+
+        ImGui::End();
+
+        return !selectedPath.empty();
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "AssetDatabase.hpp"
+
+#include <string>
+
+namespace AssetBrowser
+{
+    // "open by name" search over the indexed data directory, returns true with selectedPath set once a model is picked
+    bool drawPanel(AssetDatabase& database, bool* open, std::string& selectedPath);
+}
@@ -0,0 +1,157 @@
+#include "HeadlessContext.hpp"
+#include "Logger.hpp"
+
+#include <glad/glad.h>
+
+#ifdef TOEE_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+#include <cstring>
+
+#ifdef TOEE_HAS_EGL
+bool HeadlessContext::create()
+{
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+
+    // surfaceless platform needs neither a window system nor a GPU, that's what we want on build machines
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+    if (clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, nullptr, nullptr))
+    {
+        LOG_ERROR << "[EGL] Failed to initialize display.";
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint configCount = 0;
+
+    if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &configCount) || !configCount)
+    {
+        LOG_ERROR << "[EGL] No config with OpenGL support.";
+        eglTerminate(eglDisplay);
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+
+    if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+    {
+        LOG_ERROR << "[EGL] Failed to create surfaceless GL 3.3 core context.";
+
+        if (eglContext != EGL_NO_CONTEXT)
+            eglDestroyContext(eglDisplay, eglContext);
+
+        eglTerminate(eglDisplay);
+        return false;
+    }
+
+    display = eglDisplay;
+    context = eglContext;
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        LOG_ERROR << "[EGL] Failed to initialize GLAD.";
+        destroy();
+        return false;
+    }
+
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if (!display)
+        return;
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    if (context)
+        eglDestroyContext(display, context);
+
+    eglTerminate(display);
+
+    display = nullptr;
+    context = nullptr;
+}
+
+const char* HeadlessContext::getBackendName() const
+{
+    return "EGL";
+}
+#else
+bool HeadlessContext::create()
+{
+    if (!glfwInit())
+    {
+        LOG_ERROR << "Failed to initialize GLFW.";
+        return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* hiddenWindow = glfwCreateWindow(16, 16, "ToEE Model Viewer (headless)", nullptr, nullptr);
+
+    if (!hiddenWindow)
+    {
+        LOG_ERROR << "Failed to create hidden GLFW window.";
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(hiddenWindow);
+    window = hiddenWindow;
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        LOG_ERROR << "Failed to initialize GLAD.";
+        destroy();
+        return false;
+    }
+
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if (!window)
+        return;
+
+    glfwDestroyWindow(static_cast<GLFWwindow*>(window));
+    glfwTerminate();
+
+    window = nullptr;
+}
+
+const char* HeadlessContext::getBackendName() const
+{
+    return "hidden GLFW window";
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+// Offscreen GL 3.3 context for batch jobs.
+// Uses EGL (surfaceless Mesa platform if present, so llvmpipe works without X/Wayland) when built with TOEE_HAS_EGL,
+// otherwise falls back to an invisible GLFW window.
+class HeadlessContext
+{
+public:
+    bool create();
+    void destroy();
+
+    const char* getBackendName() const;
+
+private:
+    void* display = nullptr;
+    void* context = nullptr;
+    void* window = nullptr;
+};
@@ -10,6 +10,28 @@ namespace Shape
         glm::vec3 normal;
     };
 
+    struct ColoredVertex
+    {
+        glm::vec3 position;
+        glm::vec3 color;
+    };
+
+    namespace Axes
+    {
+        const int vertexCount = 6;
+
+        // unit axis lines, scaled and oriented per bone in the vertex shader
+        const Shape::ColoredVertex modelVertices[] =
+        {
+            {{-1.f,  0.f,  0.f}, {1.f, 0.f, 0.f}},
+            {{ 1.f,  0.f,  0.f}, {1.f, 0.f, 0.f}},
+            {{ 0.f, -1.f,  0.f}, {0.f, 1.f, 0.f}},
+            {{ 0.f,  1.f,  0.f}, {0.f, 1.f, 0.f}},
+            {{ 0.f,  0.f, -1.f}, {0.f, 0.f, 1.f}},
+            {{ 0.f,  0.f,  1.f}, {0.f, 0.f, 1.f}},
+        };
+    }
+
     namespace Bone
     {
         const int vertexCount = 24;
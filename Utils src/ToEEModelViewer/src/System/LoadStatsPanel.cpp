@@ -0,0 +1,73 @@
+#include "LoadStats.hpp"
+#include "LoadStatsPanel.hpp"
+
+#include <imgui.h>
+#include <tinyfiledialogs.h>
+
+namespace LoadStats
+{
+    void drawPanel(const Report& report, bool* open)
+    {
+        ImGui::SetNextWindowSize(ImVec2(520.f, 260.f), ImGuiCond_FirstUseEver);
+
+        if (!ImGui::Begin("Load Stats", open))
+        {
+            ImGui::End();
+            return;
+        }
+
+        if (report.path.empty())
+        {
+            ImGui::Text("No model loaded yet.");
+            ImGui::End();
+            return;
+        }
+
+        ImGui::TextUnformatted(report.path.c_str());
+        ImGui::Text("Total: %.2f ms", report.totalMilliseconds);
+        ImGui::SameLine();
+
+        if (ImGui::Button("Dump JSON..."))
+        {
+            const char* filter[] = { "*.json" };
+            const char* path = tinyfd_saveFileDialog("Dump load stats", "load_stats.json", 1, filter, "JSON");
+
+            if (path)
+                writeJSON(report, path);
+        }
+
+        if (ImGui::BeginTable("LoadStages", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("Stage");
+            ImGui::TableSetupColumn("ms");
+            ImGui::TableSetupColumn("KB read");
+            ImGui::TableSetupColumn("Allocs");
+            ImGui::TableSetupColumn("KB allocated");
+            ImGui::TableHeadersRow();
+
+            auto row = [](const Stage& stage)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(stage.name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.3f", stage.milliseconds);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.1f", stage.bytesRead / 1024.);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%llu", static_cast<unsigned long long>(stage.allocations));
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%.1f", stage.allocatedBytes / 1024.);
+            };
+
+            for (const auto& stage : report.stages)
+                row(stage);
+
+            row(report.total());
+
+            ImGui::EndTable();
+        }
+
+        ImGui::End();
+    }
+}
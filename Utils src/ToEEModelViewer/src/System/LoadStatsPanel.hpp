@@ -0,0 +1,9 @@
+#pragma once
+
+#include "LoadStats.hpp"
+
+namespace LoadStats
+{
+    // ImGui table of the stages of the last load with a JSON dump button
+    void drawPanel(const Report& report, bool* open);
+}
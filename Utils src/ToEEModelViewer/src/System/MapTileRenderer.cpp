@@ -0,0 +1,427 @@
+#include "Camera.hpp"
+#include "Logger.hpp"
+#include "MapTileRenderer.hpp"
+#include "PNG_Writer.hpp"
+#include "SKM_Loader.hpp"
+#include "SoftwareRenderer.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MapTileRenderer
+{
+    constexpr float cameraDistance = 5000.f;
+
+    struct Model
+    {
+        SKM::MeshBuffer mesh;
+        Bounds bounds; // posed, model matrix applied
+    };
+
+    struct Instance
+    {
+        const Model* model = nullptr;
+        glm::mat4 matrix = glm::mat4(1.f);
+        glm::vec3 center = glm::vec3(0.f);
+        float radius = 0.f;
+    };
+
+    static std::vector<std::string> tokenize(const std::string& line)
+    {
+        std::vector<std::string> tokens;
+        size_t i = 0;
+
+        while (i < line.size())
+        {
+            if (isspace(static_cast<unsigned char>(line[i])))
+            {
+                i++;
+                continue;
+            }
+
+            if (line[i] == '#')
+                break;
+
+            if (line[i] == '"')
+            {
+                size_t end = line.find('"', i + 1);
+
+                if (end == std::string::npos)
+                    end = line.size();
+
+                tokens.push_back(line.substr(i + 1, end - i - 1));
+                i = end + 1;
+                continue;
+            }
+
+            size_t end = i;
+
+            while (end < line.size() && !isspace(static_cast<unsigned char>(line[end])))
+                end++;
+
+            tokens.push_back(line.substr(i, end - i));
+            i = end;
+        }
+
+        return tokens;
+    }
+
+    bool loadScene(const std::string& path, Scene& scene)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            LOG_ERROR << "[Map] Failed to open scene: " << path;
+            return false;
+        }
+
+        std::string line;
+        uint32_t lineNumber = 0;
+
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+
+            std::vector<std::string> tokens = tokenize(line);
+
+            if (tokens.empty())
+                continue;
+
+            const std::string& keyword = tokens[0];
+            auto arg = [&](size_t i, float fallback) { return i < tokens.size() ? static_cast<float>(atof(tokens[i].c_str())) : fallback; };
+
+            if (keyword == "data" && tokens.size() >= 2)
+                scene.dataPath = tokens[1];
+            else if (keyword == "grid" && tokens.size() >= 3)
+            {
+                scene.columns = std::clamp(atoi(tokens[1].c_str()), 1, 1000);
+                scene.rows = std::clamp(atoi(tokens[2].c_str()), 1, 1000);
+            }
+            else if (keyword == "tilesize" && tokens.size() >= 2)
+                scene.tileSize = std::clamp(atoi(tokens[1].c_str()), 16, 4096);
+            else if (keyword == "pixelsperunit" && tokens.size() >= 2)
+                scene.pixelsPerUnit = std::max(arg(1, defaultPixelsPerUnit), .0001f);
+            else if (keyword == "center" && tokens.size() >= 4)
+                scene.center = glm::vec3(arg(1, 0.f), arg(2, 0.f), arg(3, 0.f));
+            else if (keyword == "camera" && tokens.size() >= 3)
+            {
+                scene.cameraYaw = arg(1, defaultCameraYaw);
+                scene.cameraPitch = arg(2, defaultCameraPitch);
+            }
+            else if (keyword == "light" && tokens.size() >= 3)
+            {
+                scene.lightYaw = arg(1, 35.f);
+                scene.lightPitch = arg(2, 35.f);
+            }
+            else if (keyword == "background" && tokens.size() >= 4)
+                scene.background = glm::vec4(arg(1, 0.f), arg(2, 0.f), arg(3, 0.f), arg(4, 255.f)) / 255.f;
+            else if (keyword == "model" && tokens.size() >= 5)
+            {
+                Placement placement;
+                placement.path = tokens[1];
+                placement.position = glm::vec3(arg(2, 0.f), arg(3, 0.f), arg(4, 0.f));
+                placement.rotation = arg(5, 0.f);
+                placement.scale = arg(6, 1.f);
+                std::replace(placement.path.begin(), placement.path.end(), '\\', '/');
+
+                scene.placements.push_back(placement);
+            }
+            else if (keyword == "crowd" && tokens.size() >= 5)
+            {
+                // columns x rows copies of one model centered on x z, rows run along Z
+                int columns = std::clamp(atoi(tokens[2].c_str()), 1, 1000);
+                int rows = std::clamp(atoi(tokens[3].c_str()), 1, 1000);
+                float spacing = arg(4, 0.f);
+                glm::vec3 origin = glm::vec3(arg(5, 0.f), arg(6, 0.f), arg(7, 0.f));
+
+                Placement placement;
+                placement.path = tokens[1];
+                placement.rotation = arg(8, 0.f);
+                std::replace(placement.path.begin(), placement.path.end(), '\\', '/');
+
+                for (int row = 0; row < rows; row++)
+                {
+                    for (int column = 0; column < columns; column++)
+                    {
+                        placement.position = origin + glm::vec3((column - (columns - 1) * .5f) * spacing, 0.f, (row - (rows - 1) * .5f) * spacing);
+                        scene.placements.push_back(placement);
+                    }
+                }
+            }
+            else
+                LOG_WARN << "[Map] " << path << ":" << lineNumber << ": unknown or incomplete statement \"" << keyword << "\"";
+        }
+
+        if (scene.dataPath.empty())
+            scene.dataPath = std::filesystem::path(path).parent_path().generic_string();
+
+        std::replace(scene.dataPath.begin(), scene.dataPath.end(), '\\', '/');
+
+        return true;
+    }
+
+    bool loadMesh(const std::string& path, SKM::MeshBuffer& mesh)
+    {
+        SKM::SKMFile skm;
+
+        if (!skm.loadFromFile(path))
+            return false;
+
+        try
+        {
+            mesh = skm.toMesh();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR << e.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    glm::mat4 getPlacementMatrix(const Placement& placement)
+    {
+        glm::mat4 matrix = glm::translate(glm::mat4(1.f), placement.position);
+        matrix = glm::rotate(matrix, glm::radians(placement.rotation), glm::vec3(0.f, 1.f, 0.f));
+
+        return glm::scale(matrix, glm::vec3(placement.scale));
+    }
+
+    static std::unique_ptr<Model> loadModel(const std::string& path)
+    {
+        auto model = std::make_unique<Model>();
+
+        if (!loadMesh(path, model->mesh))
+            return nullptr;
+
+        model->bounds = model->mesh.bounds.pose(model->mesh.skinningMatrix).transformed(model->mesh.modelMatrix);
+
+        return model;
+    }
+
+    int run(const Options& options)
+    {
+        Scene scene;
+
+        if (!loadScene(options.scenePath, scene))
+        {
+            std::cerr << "Failed to load scene " << options.scenePath << "\n";
+            return -1;
+        }
+
+        // every distinct SKM is loaded once, instances only keep a pointer to it
+        std::map<std::string, std::unique_ptr<Model>> models;
+        std::vector<Instance> instances;
+        uint32_t failed = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (const auto& placement : scene.placements)
+        {
+            std::string path = (std::filesystem::path(scene.dataPath) / placement.path).generic_string();
+            auto it = models.find(path);
+
+            if (it == models.end())
+                it = models.emplace(path, loadModel(path)).first;
+
+            if (!it->second)
+            {
+                failed++;
+                continue;
+            }
+
+            glm::mat4 placementMatrix = getPlacementMatrix(placement);
+
+            Instance instance;
+            instance.model = it->second.get();
+            instance.matrix = placementMatrix * it->second->mesh.modelMatrix;
+            instance.center = glm::vec3(placementMatrix * glm::vec4(it->second->bounds.getCenter(), 1.f));
+            instance.radius = it->second->bounds.getRadius() * std::abs(placement.scale);
+
+            instances.push_back(instance);
+        }
+
+        double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Loaded " << models.size() << " models for " << instances.size() << " placements (" << failed << " failed) in " << loadSeconds << " s\n";
+
+        Camera camera;
+        camera.setEulerAngles(scene.cameraYaw, scene.cameraPitch);
+        camera.setTarget(scene.center);
+        camera.setDistance(cameraDistance);
+
+        glm::mat4 view = camera.getViewMatrix();
+        glm::vec3 cameraPos = camera.getPosition();
+
+        float lightYawRad = glm::radians(scene.lightYaw);
+        float lightPitchRad = glm::radians(scene.lightPitch);
+        glm::vec3 lightDir = glm::normalize(-glm::vec3(
+            cos(lightPitchRad) * sin(lightYawRad),
+            sin(lightPitchRad),
+            cos(lightPitchRad) * cos(lightYawRad)
+        ));
+
+        // instance spheres in view space, tiles are axis aligned rectangles there so culling is a 2D overlap test
+        std::vector<glm::vec3> viewCenters(instances.size());
+
+        for (size_t i = 0; i < instances.size(); i++)
+            viewCenters[i] = glm::vec3(view * glm::vec4(instances[i].center, 1.f));
+
+        const uint32_t tileSize = scene.tileSize;
+        const uint32_t tileCount = scene.columns * scene.rows;
+        const float tileExtent = tileSize / scene.pixelsPerUnit;
+        const float gridLeft = -tileExtent * scene.columns * .5f;
+        const float gridTop = tileExtent * scene.rows * .5f;
+
+        std::filesystem::path outputPath = options.outputPath;
+        std::error_code ec;
+        std::filesystem::create_directories(outputPath, ec);
+
+        // tiles run in parallel, each one is rasterized single threaded by its own renderer
+        ThreadPool pool(options.threads);
+        std::vector<std::unique_ptr<SoftwareRenderer>> renderers;
+        std::vector<SoftwareRenderer*> freeRenderers;
+        std::mutex rendererMutex;
+
+        for (uint32_t i = 0; i < pool.getThreadCount(); i++)
+        {
+            renderers.push_back(std::make_unique<SoftwareRenderer>());
+            renderers.back()->initialize(tileSize, tileSize, 1);
+            freeRenderers.push_back(renderers.back().get());
+        }
+
+        const size_t mergedWidth = static_cast<size_t>(scene.columns) * tileSize;
+        std::vector<uint8_t> mergedPixels(options.merged ? mergedWidth * scene.rows * tileSize * 4 : 0);
+
+        std::atomic<uint32_t> written(0);
+        std::atomic<uint32_t> drawCount(0);
+        std::atomic<uint32_t> culledCount(0);
+        std::vector<uint32_t> failedTiles;
+        std::mutex failedMutex;
+
+        start = std::chrono::steady_clock::now();
+
+        pool.parallelFor(tileCount, [&](size_t tile)
+        {
+            uint32_t column = static_cast<uint32_t>(tile % scene.columns);
+            uint32_t row = static_cast<uint32_t>(tile / scene.columns);
+            float left = gridLeft + column * tileExtent;
+            float right = left + tileExtent;
+            float top = gridTop - row * tileExtent;
+            float bottom = top - tileExtent;
+
+            glm::mat4 proj = glm::ortho(left, right, bottom, top, .1f, cameraDistance * 2.f);
+
+            SoftwareRenderer* renderer;
+            {
+                std::lock_guard<std::mutex> lock(rendererMutex);
+                renderer = freeRenderers.back();
+                freeRenderers.pop_back();
+            }
+
+            renderer->clear(scene.background);
+
+            uint32_t drawn = 0;
+
+            for (size_t i = 0; i < instances.size(); i++)
+            {
+                const glm::vec3& c = viewCenters[i];
+                float r = instances[i].radius;
+
+                if (c.x + r < left || c.x - r > right || c.y + r < bottom || c.y - r > top)
+                    continue;
+
+                renderer->bindMesh(instances[i].model->mesh);
+                renderer->setModelMatrix(instances[i].matrix);
+                renderer->render(view, proj, lightDir, cameraPos, false, false, 0.f);
+                drawn++;
+            }
+
+            std::vector<uint8_t> pixels;
+            renderer->readPixels(pixels);
+            renderer->clearMesh();
+
+            {
+                std::lock_guard<std::mutex> lock(rendererMutex);
+                freeRenderers.push_back(renderer);
+            }
+
+            drawCount += drawn;
+            culledCount += static_cast<uint32_t>(instances.size()) - drawn;
+
+            if (options.merged)
+            {
+                for (uint32_t y = 0; y < tileSize; y++)
+                {
+                    size_t dst = ((static_cast<size_t>(row) * tileSize + y) * mergedWidth + static_cast<size_t>(column) * tileSize) * 4;
+                    memcpy(&mergedPixels[dst], &pixels[static_cast<size_t>(y) * tileSize * 4], tileSize * 4);
+                }
+            }
+
+            // same numbering as the frames of the Blender template
+            char name[32];
+            snprintf(name, sizeof(name), "%04u.png", static_cast<uint32_t>(tile + 1));
+
+            if (PNG::writePNG((outputPath / name).string(), tileSize, tileSize, pixels.data(), false))
+                written++;
+            else
+            {
+                std::lock_guard<std::mutex> lock(failedMutex);
+                failedTiles.push_back(static_cast<uint32_t>(tile + 1));
+            }
+        });
+
+        for (uint32_t tile : failedTiles)
+            LOG_ERROR << "[Map] Failed to write tile " << tile;
+
+        if (options.merged && !PNG::writePNG((outputPath / "__merged.png").string(), static_cast<uint32_t>(mergedWidth), scene.rows * tileSize, mergedPixels.data(), false))
+        {
+            LOG_ERROR << "[Map] Failed to write merged image";
+            failed++;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Wrote " << written << "/" << tileCount << " tiles (" << scene.columns << "x" << scene.rows << ") in " << seconds << " s on " << pool.getThreadCount() << " threads, "
+            << drawCount << " model draws, " << culledCount << " culled\n";
+
+        for (auto& renderer : renderers)
+            renderer->shutdown();
+
+        return (failed || !failedTiles.empty()) ? 1 : 0;
+    }
+
+    bool parseArgs(int argc, char* argv[], Options& options)
+    {
+        // ToEEModelViewer --maptiles <scene.txt> <output dir> [--merged] [--threads N]
+        if (argc < 4 || strcmp(argv[1], "--maptiles") != 0)
+            return false;
+
+        options.scenePath = argv[2];
+        options.outputPath = argv[3];
+        std::replace(options.scenePath.begin(), options.scenePath.end(), '\\', '/');
+
+        for (int i = 4; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--merged") == 0)
+                options.merged = true;
+            else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+                options.threads = static_cast<uint32_t>(std::clamp(atoi(argv[++i]), 0, 256));
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "SKM_Loader.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MapTileRenderer
+{
+    // ToEE's fixed map camera: 135 degrees around the vertical axis, looking down at 44.427 degrees
+    constexpr float defaultCameraYaw = 135.f;
+    constexpr float defaultCameraPitch = -44.427f;
+
+    // toee_map_render_template_wip.blend: one 256px cell spans 6m at the importer's 0.0225 scale
+    constexpr float defaultPixelsPerUnit = 256.f / (6.f / .0225f);
+
+    struct Placement
+    {
+        std::string path;
+        glm::vec3 position = glm::vec3(0.f);
+        float rotation = 0.f; // degrees around Y
+        float scale = 1.f;
+    };
+
+    struct Scene
+    {
+        std::string dataPath;
+        uint32_t columns = 5;
+        uint32_t rows = 5;
+        uint32_t tileSize = 256;
+        float pixelsPerUnit = defaultPixelsPerUnit;
+        glm::vec3 center = glm::vec3(0.f);
+        float cameraYaw = defaultCameraYaw;
+        float cameraPitch = defaultCameraPitch;
+        float lightYaw = 35.f;
+        float lightPitch = 35.f;
+        glm::vec4 background = glm::vec4(0.f, 0.f, 0.f, 1.f);
+        std::vector<Placement> placements;
+    };
+
+    struct Options
+    {
+        std::string scenePath;  // text scene description, see README
+        std::string outputPath; // tiles are written as 0001.png, 0002.png, ... row by row from the top left
+        bool merged = false;    // also write __merged.png with the whole grid
+        uint32_t threads = 0;   // 0 = all hardware threads
+    };
+
+    // parses a scene file, the viewer opens the same files as a multi-model scene
+    bool loadScene(const std::string& path, Scene& scene);
+
+    // an SKM of a placement as a renderable mesh, failures are logged; shared with the viewer's Scene
+    bool loadMesh(const std::string& path, SKM::MeshBuffer& mesh);
+
+    // translation, rotation around Y, then uniform scale; the mesh's own model matrix goes after it
+    glm::mat4 getPlacementMatrix(const Placement& placement);
+
+    // renders the scene through the ToEE isometric camera into a grid of 256x256 tiles, returns process exit code
+    int run(const Options& options);
+
+    bool parseArgs(int argc, char* argv[], Options& options);
+}
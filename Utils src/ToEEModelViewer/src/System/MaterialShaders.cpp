@@ -0,0 +1,476 @@
+#include "MaterialShaders.hpp"
+#include "ProgramCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    // shared by the model variants and the skinning program
+    const char* skinningCommonSource = R"GLSL(
+        layout (location = 0) in vec3 aPos;
+        layout (location = 2) in vec3 aNormal;
+        layout (location = 3) in uvec4 aBoneIDs;
+        layout (location = 4) in vec4 aWeights;
+
+        uniform samplerBuffer boneMatrixTex;
+
+        mat4 fetchMatrix(int base)
+        {
+            return mat4(
+                texelFetch(boneMatrixTex, base + 0),
+                texelFetch(boneMatrixTex, base + 1),
+                texelFetch(boneMatrixTex, base + 2),
+                texelFetch(boneMatrixTex, base + 3)
+            );
+        }
+
+        mat4 getSkinMatrix(int boneBase)
+        {
+            return
+                fetchMatrix(boneBase + int(aBoneIDs.x) * 4) * aWeights.x +
+                fetchMatrix(boneBase + int(aBoneIDs.y) * 4) * aWeights.y +
+                fetchMatrix(boneBase + int(aBoneIDs.z) * 4) * aWeights.z +
+                fetchMatrix(boneBase + int(aBoneIDs.w) * 4) * aWeights.w;
+        }
+    )GLSL";
+
+    // #version, INSTANCE_TEXELS and the BATCHED and PRESKINNED switches are prepended per variant
+    const char* vertexCommonSource = R"GLSL(
+        layout (location = 1) in vec2 aUV;
+
+        out vec3 FragPos;
+        out vec3 Normal;
+        out vec2 TexCoord;
+
+        #ifdef BATCHED
+        layout (location = 5) in uint aMaterial; // the indirect command's baseInstance, same for all of its instances
+        flat out int MaterialIndex;
+        #endif
+
+        uniform mat4 view;
+        uniform mat4 projection;
+        uniform int instanceOffset; // in texels, this draw's first instance record in the stream buffer
+
+        void main() {
+            // instance record: model matrix, then the distance from the record to the instance's bone palette
+            int instanceBase = instanceOffset + gl_InstanceID * INSTANCE_TEXELS;
+            mat4 model = fetchMatrix(instanceBase);
+
+            #ifdef PRESKINNED
+            vec4 skinnedPosition = vec4(aPos, 1.0);
+            vec3 skinnedNormal = aNormal;
+            #else
+            int boneBase = instanceBase + int(texelFetch(boneMatrixTex, instanceBase + 4).x);
+            mat4 skinMatrix = getSkinMatrix(boneBase);
+
+            vec4 skinnedPosition = skinMatrix * vec4(aPos, 1.0);
+            vec3 skinnedNormal = mat3(skinMatrix) * aNormal;
+            #endif
+
+            FragPos = vec3(model * skinnedPosition);
+            Normal = mat3(transpose(inverse(model))) * skinnedNormal;
+            TexCoord = aUV;
+
+            #ifdef BATCHED
+            MaterialIndex = int(aMaterial);
+            #endif
+
+            gl_Position = projection * view * vec4(FragPos, 1.0);
+        }
+    )GLSL";
+
+    // one point per vertex with rasterization off, the outputs land in the mesh's skinning cache
+    const char* skinningVertexSource = R"GLSL(
+        uniform int paletteOffset;
+
+        out vec3 SkinnedPosition;
+        out vec3 SkinnedNormal;
+
+        void main()
+        {
+            mat4 skinMatrix = getSkinMatrix(paletteOffset);
+
+            SkinnedPosition = vec3(skinMatrix * vec4(aPos, 1.0));
+            SkinnedNormal = mat3(skinMatrix) * aNormal;
+        }
+    )GLSL";
+
+    // material set with uniforms per draw, one 2D texture per layer
+    const char* fragmentUniformSource = R"GLSL(
+        uniform vec4 baseColor;
+        uniform vec4 specularColor;
+        uniform bool uniformLight;
+
+        uniform sampler2D texture0;
+        uniform sampler2D texture1;
+        uniform sampler2D texture2;
+        uniform sampler2D texture3;
+        uniform sampler2D glossTexture;
+
+        // u, v
+        uniform vec2 speed0;
+        uniform vec2 speed1;
+        uniform vec2 speed2;
+        uniform vec2 speed3;
+
+        uniform float glossShininess;
+
+        void loadMaterial()
+        {
+        }
+
+        vec4 sampleLayer0(vec2 uv) { return texture(texture0, uv); }
+        vec4 sampleLayer1(vec2 uv) { return texture(texture1, uv); }
+        vec4 sampleLayer2(vec2 uv) { return texture(texture2, uv); }
+        vec4 sampleLayer3(vec2 uv) { return texture(texture3, uv); }
+        vec4 sampleGloss(vec2 uv) { return texture(glossTexture, uv); }
+    )GLSL";
+
+    // material read from the material buffer, textures packed into one array per size
+    const char* fragmentBatchedSource = R"GLSL(
+        flat in int MaterialIndex;
+
+        uniform samplerBuffer materialTex;
+        uniform sampler2DArray textureArray0;
+        uniform sampler2DArray textureArray1;
+        uniform sampler2DArray textureArray2;
+        uniform sampler2DArray textureArray3;
+        uniform bool uniformLighting;
+
+        vec4 baseColor;
+        vec4 specularColor;
+        bool uniformLight;
+        vec2 speed0;
+        vec2 speed1;
+        vec2 speed2;
+        vec2 speed3;
+        float glossShininess;
+        vec2 layerRefs[5]; // array, layer for the 4 layers and gloss
+
+        // layout written by Renderer::uploadMaterialBuffer
+        void loadMaterial()
+        {
+            int base = MaterialIndex * MATERIAL_TEXELS;
+
+            baseColor = texelFetch(materialTex, base + 0);
+            specularColor = texelFetch(materialTex, base + 1);
+
+            vec4 speeds = texelFetch(materialTex, base + 2);
+            speed0 = speeds.xy;
+            speed1 = speeds.zw;
+            speeds = texelFetch(materialTex, base + 3);
+            speed2 = speeds.xy;
+            speed3 = speeds.zw;
+
+            vec4 refs = texelFetch(materialTex, base + 4);
+            layerRefs[0] = refs.xy;
+            layerRefs[1] = refs.zw;
+            refs = texelFetch(materialTex, base + 5);
+            layerRefs[2] = refs.xy;
+            layerRefs[3] = refs.zw;
+
+            vec4 extra = texelFetch(materialTex, base + 6);
+            layerRefs[4] = extra.xy;
+            glossShininess = extra.z;
+            uniformLight = uniformLighting || extra.w != 0.0;
+        }
+
+        vec4 sampleArray(vec2 ref, vec2 uv)
+        {
+            // the array is picked per material, explicit gradients keep the lookups valid inside the branch
+            vec2 dx = dFdx(uv);
+            vec2 dy = dFdy(uv);
+            vec3 coord = vec3(uv, ref.y);
+            int array = int(ref.x);
+
+            if (array == 0)
+                return textureGrad(textureArray0, coord, dx, dy);
+
+            if (array == 1)
+                return textureGrad(textureArray1, coord, dx, dy);
+
+            if (array == 2)
+                return textureGrad(textureArray2, coord, dx, dy);
+
+            if (array == 3)
+                return textureGrad(textureArray3, coord, dx, dy);
+
+            return vec4(0.0, 0.0, 0.0, 1.0); // missing texture, what an unbound unit samples as
+        }
+
+        vec4 sampleLayer0(vec2 uv) { return sampleArray(layerRefs[0], uv); }
+        vec4 sampleLayer1(vec2 uv) { return sampleArray(layerRefs[1], uv); }
+        vec4 sampleLayer2(vec2 uv) { return sampleArray(layerRefs[2], uv); }
+        vec4 sampleLayer3(vec2 uv) { return sampleArray(layerRefs[3], uv); }
+        vec4 sampleGloss(vec2 uv) { return sampleArray(layerRefs[4], uv); }
+    )GLSL";
+
+    // everything but main(), which is generated per variant and only calls the UV and blend functions its layers use
+    const char* fragmentCommonSource = R"GLSL(
+        uniform vec3 cameraPos;
+        uniform vec3 lightDir;
+        uniform float time;
+
+        vec3 calculateSpecular(vec3 normal, vec3 viewDir)
+        {
+            vec3 halfDir = normalize(viewDir + lightDir);
+        #ifdef HAS_GLOSS
+            return sampleGloss(TexCoord).rgb * pow(max(dot(normal, halfDir), 0.0), glossShininess);
+        #else
+            return specularColor.rgb * pow(max(dot(normal, halfDir), 0.0), 2.0);
+        #endif
+        }
+
+        vec2 uvEnvironment()
+        {
+            vec3 r = reflect(normalize(FragPos - cameraPos), normalize(Normal));
+            float m = sqrt(r.x * r.x + r.y * r.y + (r.z + 1.0) * (r.z + 1.0));
+            return 0.5 * (r.xy / m + 1.0);
+        }
+
+        vec2 uvDrift(vec2 speed)
+        {
+            return TexCoord + speed * time;
+        }
+
+        vec2 uvSwirl(vec2 speed)
+        {
+            vec2 center = vec2(0.5);
+            vec2 uv = TexCoord - center;
+
+            float swirlSpeed = (speed.x == 0.0 && speed.y == 0.0) ? 60.0 : speed.x;
+            float angle = time * swirlSpeed * 0.0475;
+            float s = sin(angle);
+            float c = cos(angle);
+
+            return vec2(uv.x * c - uv.y * s, uv.x * s + uv.y * c) + center;
+        }
+
+        vec2 uvWavey(vec2 speed)
+        {
+            vec2 uv = TexCoord;
+            uv.y += sin((uv.x + time * speed.x) * 10.0) * 0.02;
+            uv.x += sin((uv.y + time * speed.y) * 10.0) * 0.02;
+            return uv;
+        }
+
+        vec4 blendModulate(vec4 base, vec4 tex)
+        {
+            return base * tex;
+        }
+
+        vec4 blendAdd(vec4 base, vec4 tex)
+        {
+            return vec4(base.rgb + tex.rgb, base.a * tex.a);
+        }
+
+        vec4 blendTextureAlpha(vec4 base, vec4 tex)
+        {
+            return vec4(mix(base.rgb, tex.rgb, tex.a), base.a);
+        }
+
+        vec4 blendCurrentAlpha(vec4 base, vec4 tex)
+        {
+            return vec4(mix(base.rgb, tex.rgb, base.a), tex.a);
+        }
+
+        vec4 blendCurrentAlphaAdd(vec4 base, vec4 tex)
+        {
+            return vec4(base.rgb + tex.a * tex.rgb, tex.a);
+        }
+    )GLSL";
+
+    // indexed by MDF uvType, %d is the layer
+    const char* uvExpressions[] = { "TexCoord", "uvEnvironment()", "uvDrift(speed%d)", "uvSwirl(speed%d)", "uvWavey(speed%d)" };
+
+    // indexed by MDF blendType
+    const char* blendFunctions[] = { "blendModulate", "blendAdd", "blendTextureAlpha", "blendCurrentAlpha", "blendCurrentAlphaAdd" };
+
+    constexpr uint32_t blendSkip = 7; // unknown blend types leave the color untouched, the layer is left out
+    constexpr uint32_t glossBit = 1u << 27;
+    constexpr uint32_t batchedBit = 1u << 28;
+}
+
+uint32_t MaterialShaders::makeKey(const MDF::MDFFile& material, bool hasGloss, bool batched)
+{
+    uint32_t layerCount = std::min<uint32_t>(material.textureCount, 4);
+    uint32_t key = layerCount;
+
+    for (uint32_t i = 0; i < layerCount; i++)
+    {
+        // unknown UV types sample the mesh UVs, same as type 0, so they share its variant
+        uint32_t uvType = material.uvType[i] <= MDF::MDFFile::UV_TYPE_WAVEY ? material.uvType[i] : 0;
+        uint32_t blendType = material.blendType[i] <= MDF::MDFFile::BLEND_TYPE_CURRENT_ALPHA_ADD ? material.blendType[i] : blendSkip;
+
+        key |= (uvType | (blendType << 3)) << (3 + i * 6);
+    }
+
+    if (hasGloss)
+        key |= glossBit;
+
+    if (batched)
+        key |= batchedBit;
+
+    return key;
+}
+
+std::string MaterialShaders::buildVertexSource(uint32_t key)
+{
+    std::string source = "#version 330 core\n#define INSTANCE_TEXELS " + std::to_string(instanceTexels) + "\n";
+
+    if (key & batchedBit)
+        source += "#define BATCHED\n";
+
+    if (key & preskinnedBit)
+        source += "#define PRESKINNED\n";
+
+    return source + skinningCommonSource + vertexCommonSource;
+}
+
+std::string MaterialShaders::buildFragmentSource(uint32_t key)
+{
+    std::string source = "#version 330 core\n";
+
+    if (key & wireframeBit)
+    {
+        return source + R"GLSL(
+            uniform vec4 baseColor;
+
+            out vec4 FragColor;
+
+            void main()
+            {
+                FragColor = baseColor;
+            }
+        )GLSL";
+    }
+
+    if (key & glossBit)
+        source += "#define HAS_GLOSS\n";
+
+    source += R"GLSL(
+        in vec2 TexCoord;
+        in vec3 FragPos;
+        in vec3 Normal;
+
+        out vec4 FragColor;
+    )GLSL";
+
+    if (key & batchedBit)
+        source += "#define MATERIAL_TEXELS " + std::to_string(materialTexels) + "\n" + fragmentBatchedSource;
+    else
+        source += fragmentUniformSource;
+
+    source += fragmentCommonSource;
+    source += R"GLSL(
+        void main()
+        {
+            loadMaterial();
+
+            float diff = uniformLight ? 1.0 : max(dot(normalize(Normal), -lightDir), 0.0);
+            vec3 specular = calculateSpecular(normalize(Normal), normalize(cameraPos - FragPos));
+
+            vec4 color = vec4(baseColor.rgb * diff, baseColor.a);
+    )GLSL";
+
+    for (uint32_t i = 0; i < getLayerCount(key); i++)
+    {
+        uint32_t layer = key >> (3 + i * 6);
+        uint32_t uvType = layer & 0x7;
+        uint32_t blendType = (layer >> 3) & 0x7;
+
+        if (blendType == blendSkip)
+            continue;
+
+        char uv[32];
+        snprintf(uv, sizeof(uv), uvExpressions[uvType], i);
+
+        source += "        color = ";
+        source += blendFunctions[blendType];
+        source += "(color, sampleLayer" + std::to_string(i) + "(" + uv + "));\n";
+    }
+
+    source += R"GLSL(
+            color.rgb += specular;
+
+            FragColor = color;
+        }
+    )GLSL";
+
+    return source;
+}
+
+void MaterialShaders::shutdown()
+{
+    for (auto& [key, program] : programs)
+        glDeleteProgram(program.id);
+
+    programs.clear();
+
+    if (skinning.id)
+        glDeleteProgram(skinning.id);
+
+    skinning = SkinningProgram();
+}
+
+MaterialShaders::Program& MaterialShaders::get(uint32_t key)
+{
+    auto it = programs.find(key);
+
+    if (it != programs.end())
+        return it->second;
+
+    std::string vertexSource = buildVertexSource(key);
+    std::string fragmentSource = buildFragmentSource(key);
+    std::string name = "model variant " + std::to_string(key);
+
+    Program& program = programs[key];
+    program.id = ProgramCache::get().build(name.c_str(), vertexSource.c_str(), fragmentSource.c_str());
+    program.key = key;
+
+    program.view = glGetUniformLocation(program.id, "view");
+    program.projection = glGetUniformLocation(program.id, "projection");
+    program.instanceOffset = glGetUniformLocation(program.id, "instanceOffset");
+    program.lightDir = glGetUniformLocation(program.id, "lightDir");
+    program.cameraPos = glGetUniformLocation(program.id, "cameraPos");
+    program.time = glGetUniformLocation(program.id, "time");
+    program.uniformLight = glGetUniformLocation(program.id, "uniformLight");
+    program.uniformLighting = glGetUniformLocation(program.id, "uniformLighting");
+    program.baseColor = glGetUniformLocation(program.id, "baseColor");
+    program.specularColor = glGetUniformLocation(program.id, "specularColor");
+    program.glossShininess = glGetUniformLocation(program.id, "glossShininess");
+
+    glUseProgram(program.id);
+
+    for (GLint i = 0; i < 4; i++)
+    {
+        std::string index = std::to_string(i);
+        program.speed[i] = glGetUniformLocation(program.id, ("speed" + index).c_str());
+        glUniform1i(glGetUniformLocation(program.id, ("texture" + index).c_str()), i);
+        glUniform1i(glGetUniformLocation(program.id, ("textureArray" + index).c_str()), i);
+    }
+
+    glUniform1i(glGetUniformLocation(program.id, "glossTexture"), glossUnit);
+    glUniform1i(glGetUniformLocation(program.id, "materialTex"), materialUnit);
+    glUniform1i(glGetUniformLocation(program.id, "boneMatrixTex"), boneMatrixUnit);
+
+    return program;
+}
+
+const MaterialShaders::SkinningProgram& MaterialShaders::getSkinning()
+{
+    if (skinning.id)
+        return skinning;
+
+    std::string vertexSource = std::string("#version 330 core\n") + skinningCommonSource + skinningVertexSource;
+
+    // nothing is rasterized, the fragment shader only completes the program
+    skinning.id = ProgramCache::get().build("skinning", vertexSource.c_str(), "#version 330 core\nvoid main() {}\n", { "SkinnedPosition", "SkinnedNormal" });
+    skinning.paletteOffset = glGetUniformLocation(skinning.id, "paletteOffset");
+
+    glUseProgram(skinning.id);
+    glUniform1i(glGetUniformLocation(skinning.id, "boneMatrixTex"), boneMatrixUnit);
+
+    return skinning;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "MDF_Loader.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Model shader variants specialized per material: layer count, UV and blend type of every layer and gloss presence
+// are baked into the fragment shader, so a fragment only pays for what its material actually uses.
+// Variants are built the first time a material asks for them (through ProgramCache) and stay until shutdown.
+class MaterialShaders
+{
+public:
+    struct Program
+    {
+        GLuint id = 0;
+        uint32_t key = 0;
+        uint64_t frame = 0; // last render() the per frame uniforms were set for
+
+        GLint instanceOffsetValue = -1; // last value set, changes per mesh rather than per frame
+
+        GLint view = -1;
+        GLint projection = -1;
+        GLint instanceOffset = -1;
+        GLint lightDir = -1;
+        GLint cameraPos = -1;
+        GLint time = -1;
+        GLint uniformLight = -1;
+        GLint uniformLighting = -1; // batched variants, per material unlit flag comes from the material buffer
+        GLint baseColor = -1;
+        GLint specularColor = -1;
+        GLint glossShininess = -1;
+        GLint speed[4] = { -1, -1, -1, -1 };
+    };
+
+    // transform feedback only, writes the skinned position and normal of every vertex (2 vec3, interleaved)
+    struct SkinningProgram
+    {
+        GLuint id = 0;
+        GLint paletteOffset = -1; // in texels, the palette's start in the bone matrix buffer
+    };
+
+    // texture units the samplers are bound to once at link time, layers (or texture arrays when batched) use 0-3
+    static constexpr GLint textureArrayCount = 4;
+    static constexpr GLint glossUnit = 5;
+    static constexpr GLint boneMatrixUnit = 6;
+    static constexpr GLint materialUnit = 7;
+
+    // RGBA32F texels per material in the material buffer of batched variants
+    static constexpr int materialTexels = 7;
+
+    // RGBA32F texels per instance record in the stream buffer: model matrix, then the bone palette's offset from the
+    // record in .x, every draw is instanced and reads its record with gl_InstanceID
+    static constexpr int instanceTexels = 5;
+
+    // no layers and no gloss, flat base color
+    static constexpr uint32_t untexturedKey = 0;
+
+    // added to a key by the renderer: preskinned variants take positions and normals already skinned by the skinning
+    // program instead of skinning every vertex, wireframe variants only output baseColor
+    static constexpr uint32_t preskinnedBit = 1u << 29;
+    static constexpr uint32_t wireframeBit = 1u << 30;
+
+    // 3 bits layer count, 3 bits UV type and 3 bits blend type per used layer, 1 bit gloss, 1 bit batched, then the two
+    // bits above. Batched variants read the material from a texture buffer and sample texture arrays, so every material
+    // with the same layout can go into one multi-draw
+    static uint32_t makeKey(const MDF::MDFFile& material, bool hasGloss, bool batched = false);
+    static uint32_t getLayerCount(uint32_t key) { return key & 0x7; }
+
+    void shutdown();
+
+    Program& get(uint32_t key);
+    size_t getVariantCount() const { return programs.size(); }
+
+    const SkinningProgram& getSkinning();
+
+private:
+    std::unordered_map<uint32_t, Program> programs;
+    SkinningProgram skinning;
+
+    static std::string buildVertexSource(uint32_t key);
+    static std::string buildFragmentSource(uint32_t key);
+};
@@ -0,0 +1,127 @@
+#include "PNG_Writer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace PNG
+{
+    struct CRCTable
+    {
+        uint32_t values[256];
+
+        CRCTable()
+        {
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+
+                values[n] = c;
+            }
+        }
+    };
+
+    static uint32_t updateCRC(uint32_t crc, const uint8_t* data, size_t length)
+    {
+        static const CRCTable table;
+
+        for (size_t i = 0; i < length; i++)
+            crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+        return crc;
+    }
+
+    static void putU32BE(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static void putChunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& data)
+    {
+        putU32BE(out, static_cast<uint32_t>(data.size()));
+
+        size_t typeStart = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+
+        uint32_t crc = updateCRC(0xFFFFFFFFu, out.data() + typeStart, out.size() - typeStart) ^ 0xFFFFFFFFu;
+        putU32BE(out, crc);
+    }
+
+    bool writePNG(const std::string& filepath, uint32_t width, uint32_t height, const uint8_t* pixels, bool flipY)
+    {
+        const size_t rowSize = static_cast<size_t>(width) * 4;
+
+        // filter type 0 per row
+        std::vector<uint8_t> raw;
+        raw.reserve((rowSize + 1) * height);
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            const uint8_t* row = pixels + (flipY ? height - 1 - y : y) * rowSize;
+
+            raw.push_back(0);
+            raw.insert(raw.end(), row, row + rowSize);
+        }
+
+        // zlib stream made of stored deflate blocks, no compression but no zlib dependency either
+        std::vector<uint8_t> idat;
+        idat.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+        idat.push_back(0x78);
+        idat.push_back(0x01);
+
+        size_t pos = 0;
+        do
+        {
+            size_t blockSize = std::min<size_t>(raw.size() - pos, 65535);
+            bool last = pos + blockSize == raw.size();
+
+            idat.push_back(last ? 1 : 0);
+            idat.push_back(static_cast<uint8_t>(blockSize));
+            idat.push_back(static_cast<uint8_t>(blockSize >> 8));
+            idat.push_back(static_cast<uint8_t>(~blockSize));
+            idat.push_back(static_cast<uint8_t>(~blockSize >> 8));
+            idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + blockSize);
+
+            pos += blockSize;
+        } while (pos < raw.size());
+
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (uint8_t byte : raw)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        putU32BE(idat, (b << 16) | a);
+
+        std::vector<uint8_t> ihdr;
+        putU32BE(ihdr, width);
+        putU32BE(ihdr, height);
+        ihdr.push_back(8); // bit depth
+        ihdr.push_back(6); // RGBA
+        ihdr.push_back(0); // compression
+        ihdr.push_back(0); // filter
+        ihdr.push_back(0); // interlace
+
+        std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        out.reserve(idat.size() + 64);
+        putChunk(out, "IHDR", ihdr);
+        putChunk(out, "IDAT", idat);
+        putChunk(out, "IEND", {});
+
+        std::ofstream file(filepath, std::ios::binary);
+        if (!file)
+            return false;
+
+        file.write(reinterpret_cast<const char*>(out.data()), out.size());
+
+        return static_cast<bool>(file);
+    }
+}
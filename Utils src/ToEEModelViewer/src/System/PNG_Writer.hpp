@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace PNG
+{
+    // 8-bit RGBA, rows top to bottom; flipY for data coming straight from glReadPixels
+    bool writePNG(const std::string& filepath, uint32_t width, uint32_t height, const uint8_t* pixels, bool flipY);
+}
@@ -0,0 +1,389 @@
+#include "Logger.hpp"
+#include "Profiler.hpp"
+
+#include <imgui.h>
+#include <tinyfiledialogs.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+    struct OpenScope
+    {
+        const char* name;
+        double start;
+    };
+
+    thread_local std::vector<OpenScope> scopeStack;
+    thread_local uint32_t threadId = UINT32_MAX;
+
+    void writeJSONString(std::ofstream& file, const char* text)
+    {
+        file << '"';
+
+        for (const char* c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                file << '\\';
+
+            file << *c;
+        }
+
+        file << '"';
+    }
+}
+
+Profiler& Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+double Profiler::now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+uint32_t Profiler::threadIndex()
+{
+    if (threadId == UINT32_MAX)
+        threadId = nextThreadIndex.fetch_add(1);
+
+    return threadId;
+}
+
+void Profiler::beginFrame()
+{
+    resolveQueries(false);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    current = FrameRecord();
+    current.number = ++frameNumber;
+    current.start = now();
+    active.store(true, std::memory_order_relaxed);
+
+    drawCalls.store(0, std::memory_order_relaxed);
+    culledDraws.store(0, std::memory_order_relaxed);
+    uploadBytes.store(0, std::memory_order_relaxed);
+}
+
+void Profiler::endFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    current.duration = now() - current.start;
+    current.drawCalls = drawCalls.load(std::memory_order_relaxed);
+    current.culledDraws = culledDraws.load(std::memory_order_relaxed);
+    current.uploadBytes = uploadBytes.load(std::memory_order_relaxed);
+
+    // scopes called several times per frame are summed into one graph value
+    for (auto& series : cpuSeries)
+        series.frameSum = 0.f;
+
+    for (const auto& event : current.cpu)
+        getSeries(cpuSeries, cpuSeriesIndex, event.name, event.depth).frameSum += static_cast<float>(event.duration * .001);
+
+    for (auto& series : cpuSeries)
+        series.values[graphOffset] = series.frameSum;
+
+    frameSeries.values[graphOffset] = static_cast<float>(current.duration * .001);
+    drawCallSeries.values[graphOffset] = static_cast<float>(current.drawCalls);
+    uploadSeries.values[graphOffset] = static_cast<float>(current.uploadBytes / 1024.);
+    graphOffset = (graphOffset + 1) % graphFrames;
+
+    history.push_back(std::move(current));
+
+    while (history.size() > historyFrames)
+        history.pop_front();
+}
+
+void Profiler::beginScope(const char* name)
+{
+    if (!active.load(std::memory_order_relaxed))
+        return;
+
+    scopeStack.push_back({ name, now() });
+}
+
+void Profiler::endScope()
+{
+    if (scopeStack.empty())
+        return;
+
+    OpenScope scope = scopeStack.back();
+    scopeStack.pop_back();
+
+    CpuEvent event = { scope.name, scope.start, now() - scope.start, static_cast<uint32_t>(scopeStack.size()), threadIndex() };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    current.cpu.push_back(event);
+}
+
+void Profiler::beginGpuScope(const char* name)
+{
+    if (!active.load(std::memory_order_relaxed))
+        return;
+
+    if (gpuScopeOpen)
+    {
+        skippedGpuScopes++;
+        return;
+    }
+
+    GLuint query = 0;
+
+    if (!freeQueries.empty())
+    {
+        query = freeQueries.back();
+        freeQueries.pop_back();
+    }
+    else
+        glGenQueries(1, &query);
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpuScopeOpen = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    GpuEvent event;
+    event.name = name;
+    event.cpuStart = now();
+    current.gpu.push_back(event);
+
+    pendingQueries.push_back({ query, current.number, current.gpu.size() - 1 });
+}
+
+void Profiler::endGpuScope()
+{
+    if (skippedGpuScopes)
+    {
+        skippedGpuScopes--;
+        return;
+    }
+
+    if (!gpuScopeOpen)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuScopeOpen = false;
+}
+
+// results arrive a few frames late, only queries older than maxQueryLatency frames are waited for
+void Profiler::resolveQueries(bool wait)
+{
+    size_t resolved = 0;
+
+    for (; resolved < pendingQueries.size(); resolved++)
+    {
+        const PendingQuery& pending = pendingQueries[resolved];
+
+        if (!wait && pending.frame + maxQueryLatency > frameNumber)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (!available)
+                break;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+        freeQueries.push_back(pending.query);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (history.empty() || pending.frame < history.front().number || pending.frame > history.back().number)
+            continue;
+
+        GpuEvent& event = history[static_cast<size_t>(pending.frame - history.front().number)].gpu[pending.event];
+        event.duration = elapsed / 1000.;
+
+        Series& series = getSeries(gpuSeries, gpuSeriesIndex, event.name, 0);
+        uint32_t age = static_cast<uint32_t>(std::min<uint64_t>(frameNumber - pending.frame, graphFrames - 1));
+        series.values[(graphOffset + graphFrames - 1 - age) % graphFrames] = static_cast<float>(event.duration * .001);
+    }
+
+    pendingQueries.erase(pendingQueries.begin(), pendingQueries.begin() + resolved);
+}
+
+Profiler::Series& Profiler::getSeries(std::vector<Series>& series, std::unordered_map<std::string, size_t>& index, const char* name, uint32_t depth)
+{
+    auto it = index.find(name);
+
+    if (it != index.end())
+        return series[it->second];
+
+    index.emplace(name, series.size());
+    series.emplace_back();
+    series.back().name = name;
+    series.back().depth = depth;
+
+    return series.back();
+}
+
+void Profiler::drawSeries(const Series& series, const char* unit)
+{
+    float latest = series.values[(graphOffset + graphFrames - 1) % graphFrames];
+    float average = 0.f;
+    float peak = 0.f;
+
+    for (float value : series.values)
+    {
+        average += value;
+        peak = std::max(peak, value);
+    }
+
+    average /= graphFrames;
+
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "%.3f %s (avg %.3f)", latest, unit, average);
+
+    float indent = series.depth * 10.f;
+
+    if (indent > 0.f)
+        ImGui::Indent(indent);
+
+    ImGui::Text("%s", series.name.c_str());
+    ImGui::PlotLines(("###" + series.name + unit).c_str(), series.values, graphFrames, graphOffset, overlay, 0.f, std::max(peak * 1.1f, .001f), ImVec2(-1.f, 36.f));
+
+    if (indent > 0.f)
+        ImGui::Unindent(indent);
+}
+
+void Profiler::drawPanel(bool* open)
+{
+    ImGui::SetNextWindowSize(ImVec2(380.f, 520.f), ImGuiCond_FirstUseEver);
+
+    if (!ImGui::Begin("Profiler", open))
+    {
+        ImGui::End();
+        return;
+    }
+
+    std::string tracePath;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!history.empty())
+        {
+            const FrameRecord& last = history.back();
+            ImGui::Text("Frame %.2f ms (%.0f fps)", last.duration * .001, last.duration > 0. ? 1000000. / last.duration : 0.);
+            ImGui::Text("Draw calls: %u (%u culled), uploads: %.1f KB", last.drawCalls, last.culledDraws, last.uploadBytes / 1024.);
+        }
+
+        if (ImGui::Button("Export Chrome trace..."))
+        {
+            const char* filter[] = { "*.json" };
+            const char* path = tinyfd_saveFileDialog("Export Chrome trace", "trace.json", 1, filter, "Chrome trace");
+
+            if (path)
+                tracePath = path;
+        }
+
+        if (ImGui::CollapsingHeader("Frame", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            frameSeries.name = "Frame";
+            drawSeries(frameSeries, "ms");
+
+            drawCallSeries.name = "Draw calls";
+            drawSeries(drawCallSeries, "calls");
+
+            uploadSeries.name = "Uploads";
+            drawSeries(uploadSeries, "KB");
+        }
+
+        if (ImGui::CollapsingHeader("CPU", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            for (const auto& series : cpuSeries)
+                drawSeries(series, "ms");
+        }
+
+        if (ImGui::CollapsingHeader("GPU", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            for (const auto& series : gpuSeries)
+                drawSeries(series, "ms");
+        }
+    }
+
+    ImGui::End();
+
+    if (!tracePath.empty())
+        exportChromeTrace(tracePath);
+}
+
+bool Profiler::exportChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+    if (!file)
+    {
+        LOG_ERROR << "[Profiler] Failed to open " << path;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // frames and GPU timings get their own tracks, after every CPU thread
+    const uint32_t frameTrack = 999;
+    const uint32_t gpuTrack = 1000;
+    bool first = true;
+    auto separator = [&]() { file << (first ? "\n" : ",\n"); first = false; };
+
+    // microseconds, the default six significant digits turn timestamps into exponents after a second
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    separator();
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << frameTrack << ",\"args\":{\"name\":\"Frames\"}}";
+
+    separator();
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << gpuTrack << ",\"args\":{\"name\":\"GPU\"}}";
+
+    for (const auto& frame : history)
+    {
+        separator();
+        file << "{\"name\":\"Frame " << frame.number << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << frameTrack << ",\"ts\":" << frame.start << ",\"dur\":" << frame.duration << "}";
+
+        for (const auto& event : frame.cpu)
+        {
+            separator();
+            file << "{\"name\":";
+            writeJSONString(file, event.name);
+            file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+        }
+
+        for (const auto& event : frame.gpu)
+        {
+            if (event.duration < 0.)
+                continue;
+
+            separator();
+            file << "{\"name\":";
+            writeJSONString(file, event.name);
+            file << ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << gpuTrack << ",\"ts\":" << event.cpuStart << ",\"dur\":" << event.duration << "}";
+        }
+
+        separator();
+        file << "{\"name\":\"Counters\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frame.start << ",\"args\":{\"draw calls\":" << frame.drawCalls << ",\"culled draws\":" << frame.culledDraws << ",\"upload KB\":" << frame.uploadBytes / 1024. << "}}";
+    }
+
+    file << "\n]}\n";
+
+    LOG_INFO << "[Profiler] Wrote " << history.size() << " frames to " << path;
+
+    return true;
+}
+
+void Profiler::shutdown()
+{
+    resolveQueries(true);
+
+    if (!freeQueries.empty())
+        glDeleteQueries(static_cast<GLsizei>(freeQueries.size()), freeQueries.data());
+
+    freeQueries.clear();
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Frame profiler: nested CPU scopes from any thread, GL_TIME_ELAPSED queries around render passes,
+// draw call, culled draw and upload byte counters, an ImGui panel with rolling graphs and Chrome trace JSON export.
+class Profiler
+{
+public:
+    static Profiler& get();
+
+    void beginFrame();
+    void endFrame();
+
+    void beginScope(const char* name);
+    void endScope();
+
+    // TIME_ELAPSED queries can't nest, a GPU scope opened inside another one is skipped
+    void beginGpuScope(const char* name);
+    void endGpuScope();
+
+    void countDrawCalls(uint32_t count = 1) { drawCalls.fetch_add(count, std::memory_order_relaxed); }
+    void countCulledDraws(uint32_t count = 1) { culledDraws.fetch_add(count, std::memory_order_relaxed); } // skipped by frustum culling
+    void countUploadBytes(size_t bytes) { uploadBytes.fetch_add(bytes, std::memory_order_relaxed); }
+
+    void drawPanel(bool* open);
+
+    // chrome://tracing or ui.perfetto.dev, covers the frames still in history
+    bool exportChromeTrace(const std::string& path);
+
+    // query objects belong to the GL context, call before it goes away
+    void shutdown();
+
+private:
+    static constexpr uint32_t historyFrames = 300;
+    static constexpr uint32_t graphFrames = 240;
+    static constexpr uint32_t maxQueryLatency = 4;
+
+    struct CpuEvent
+    {
+        const char* name;
+        double start;    // microseconds since the profiler was created
+        double duration;
+        uint32_t depth;
+        uint32_t thread;
+    };
+
+    struct GpuEvent
+    {
+        const char* name;
+        double cpuStart;       // GPU time is placed at the submit time in traces
+        double duration = -1.; // microseconds, -1 until the query result arrives
+    };
+
+    struct FrameRecord
+    {
+        uint64_t number = 0;
+        double start = 0.;
+        double duration = 0.;
+        uint32_t drawCalls = 0;
+        uint32_t culledDraws = 0;
+        uint64_t uploadBytes = 0;
+        std::vector<CpuEvent> cpu;
+        std::vector<GpuEvent> gpu;
+    };
+
+    struct PendingQuery
+    {
+        GLuint query;
+        uint64_t frame;
+        size_t event;
+    };
+
+    struct Series
+    {
+        std::string name;
+        uint32_t depth = 0;
+        float values[graphFrames] = { 0.f };
+        float frameSum = 0.f;
+    };
+
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    std::mutex mutex;
+    FrameRecord current;
+    std::deque<FrameRecord> history;
+    uint64_t frameNumber = 0;
+
+    // nothing is recorded until the first beginFrame, headless tools share the instrumented code without a frame loop
+    std::atomic<bool> active{ false };
+
+    std::atomic<uint32_t> drawCalls{ 0 };
+    std::atomic<uint32_t> culledDraws{ 0 };
+    std::atomic<uint64_t> uploadBytes{ 0 };
+    std::atomic<uint32_t> nextThreadIndex{ 0 };
+
+    std::vector<GLuint> freeQueries;
+    std::vector<PendingQuery> pendingQueries;
+    bool gpuScopeOpen = false;
+    uint32_t skippedGpuScopes = 0;
+
+    std::vector<Series> cpuSeries;
+    std::vector<Series> gpuSeries;
+    std::unordered_map<std::string, size_t> cpuSeriesIndex;
+    std::unordered_map<std::string, size_t> gpuSeriesIndex;
+    Series frameSeries;
+    Series drawCallSeries;
+    Series uploadSeries;
+    uint32_t graphOffset = 0;
+
+    double now() const;
+    uint32_t threadIndex();
+    void resolveQueries(bool wait);
+    Series& getSeries(std::vector<Series>& series, std::unordered_map<std::string, size_t>& index, const char* name, uint32_t depth);
+    void drawSeries(const Series& series, const char* unit);
+};
+
+struct ProfileScope
+{
+    explicit ProfileScope(const char* name) { Profiler::get().beginScope(name); }
+    ~ProfileScope() { Profiler::get().endScope(); }
+};
+
+struct GpuProfileScope
+{
+    explicit GpuProfileScope(const char* name) { Profiler::get().beginGpuScope(name); }
+    ~GpuProfileScope() { Profiler::get().endGpuScope(); }
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+// CPU and GPU timing of one render pass under the same name
+#define PROFILE_PASS(name) PROFILE_SCOPE(name); PROFILE_GPU_SCOPE(name)
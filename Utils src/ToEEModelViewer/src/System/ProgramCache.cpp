@@ -0,0 +1,236 @@
+#include "Logger.hpp"
+#include "ProgramCache.hpp"
+#include "UserCache.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t binaryMagic = 0x42505654; // "TVPB"
+
+    struct BinaryHeader
+    {
+        uint32_t magic = binaryMagic;
+        uint32_t format = 0;
+        uint32_t length = 0;
+    };
+
+    // FNV-1a, chained so several strings hash as one
+    uint64_t hashString(const char* text, uint64_t hash = 14695981039346656037ull)
+    {
+        for (const char* c = text; c && *c; c++)
+        {
+            hash ^= static_cast<uint8_t>(*c);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    GLuint compileShader(const char* name, GLenum type, const char* source)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+
+        GLint status = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+        if (!status)
+        {
+            char log[1024] = { 0 };
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            LOG_ERROR << "Shader compile failed (" << name << "): " << log;
+        }
+
+        return shader;
+    }
+}
+
+ProgramCache& ProgramCache::get()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+void ProgramCache::initialize()
+{
+    initialized = true;
+
+    GLint formatCount = 0;
+
+    if (GLAD_GL_ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+    // some drivers expose the extension without a single binary format
+    supported = formatCount > 0;
+    directory = UserCache::getDirectory() + "shadercache/";
+
+    driverHash = hashString("");
+
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION })
+        driverHash = hashString(reinterpret_cast<const char*>(glGetString(name)), driverHash);
+
+    LOG_INFO << "Program binary cache: " << (supported ? "enabled" : "not supported by the driver");
+}
+
+GLuint ProgramCache::build(const char* name, const char* vertexSource, const char* fragmentSource, std::initializer_list<const char*> feedbackVaryings)
+{
+    if (!initialized)
+        initialize();
+
+    auto start = std::chrono::steady_clock::now();
+    std::string path;
+
+    if (supported)
+    {
+        uint64_t hash = hashString(fragmentSource, hashString(vertexSource, driverHash));
+
+        for (const char* varying : feedbackVaryings)
+            hash = hashString(varying, hashString("\n", hash));
+
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016llx.bin", static_cast<unsigned long long>(hash));
+        path = directory + fileName;
+
+        if (GLuint program = loadBinary(path))
+        {
+            double milliseconds = millisecondsSince(start);
+            stats.loaded++;
+            stats.loadMilliseconds += milliseconds;
+
+            LOG_INFO << "Program " << name << " loaded from cache in " << milliseconds << " ms";
+
+            return program;
+        }
+    }
+
+    GLuint vertexShader = compileShader(name, GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = compileShader(name, GL_FRAGMENT_SHADER, fragmentSource);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+
+    // has to be set before linking
+    if (feedbackVaryings.size())
+        glTransformFeedbackVaryings(program, static_cast<GLsizei>(feedbackVaryings.size()), feedbackVaryings.begin(), GL_INTERLEAVED_ATTRIBS);
+
+    if (supported)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    glLinkProgram(program);
+
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+    double milliseconds = millisecondsSince(start);
+    stats.compiled++;
+    stats.compileMilliseconds += milliseconds;
+
+    if (!status)
+    {
+        char log[1024] = { 0 };
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        LOG_ERROR << "Program link failed (" << name << "): " << log;
+
+        return program;
+    }
+
+    LOG_INFO << "Program " << name << " compiled in " << milliseconds << " ms";
+
+    if (supported)
+        saveBinary(path, program);
+
+    return program;
+}
+
+GLuint ProgramCache::loadBinary(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file)
+        return 0;
+
+    const std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+
+    BinaryHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file || header.magic != binaryMagic || !header.length)
+        return 0;
+
+    // a truncated or corrupt entry must not turn into a huge allocation, recompiling overwrites it
+    if (static_cast<uint64_t>(fileSize) - sizeof(header) != header.length)
+    {
+        LOG_WARN << "Discarding damaged program binary: " << path;
+        return 0;
+    }
+
+    std::vector<char> binary(header.length);
+    file.read(binary.data(), binary.size());
+
+    if (!file)
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+    if (status)
+        return program;
+
+    // same driver strings but the driver still refused it, recompiling overwrites the entry
+    stats.rejected++;
+    glDeleteProgram(program);
+
+    return 0;
+}
+
+void ProgramCache::saveBinary(const std::string& path, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0)
+        return;
+
+    BinaryHeader header;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    header.format = format;
+    header.length = static_cast<uint32_t>(length);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    if (!file)
+    {
+        LOG_WARN << "Cannot write program binary: " << path;
+        return;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), binary.size());
+}
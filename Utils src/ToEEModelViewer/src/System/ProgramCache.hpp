@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+// Links GLSL programs, keeping the driver's program binaries (ARB_get_program_binary) in the user cache directory so
+// later runs skip compiling. Entries are keyed by a hash of the sources and the GL vendor, renderer and version strings, a driver
+// update or a changed shader simply misses. Binaries the driver rejects fall back to compiling from source.
+class ProgramCache
+{
+public:
+    struct Stats
+    {
+        uint32_t loaded = 0;   // linked from a cached binary
+        uint32_t compiled = 0; // compiled from source, cache miss or rejected binary
+        uint32_t rejected = 0;
+        double loadMilliseconds = 0.;
+        double compileMilliseconds = 0.;
+    };
+
+    static ProgramCache& get();
+
+    // returns the linked program, compile and link errors are logged
+    // feedbackVaryings are captured interleaved by transform feedback, they are part of the cache key
+    GLuint build(const char* name, const char* vertexSource, const char* fragmentSource, std::initializer_list<const char*> feedbackVaryings = {});
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    bool initialized = false;
+    bool supported = false;
+    uint64_t driverHash = 0;
+    std::string directory; // UserCache::getDirectory() + shadercache/
+    Stats stats;
+
+    void initialize();
+    GLuint loadBinary(const std::string& path);
+    void saveBinary(const std::string& path, GLuint program);
+};
@@ -1,305 +1,20 @@
 #include "HelperShapes.hpp"
+#include "LoadStats.hpp"
 #include "Logger.hpp"
+#include "Profiler.hpp"
+#include "ProgramCache.hpp"
 #include "Renderer.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glad/glad.h>
 
+#include <algorithm>
 #include <iostream>
 #include <random>
 
 void Renderer::initialize()
 {
-    // model shader
-    const char* vertSrc = R"GLSL(
-        #version 330 core
-        #pragma optimize(off)
-
-        layout (location = 0) in vec3 aPos;
-        layout (location = 1) in vec2 aUV;
-        layout (location = 2) in vec3 aNormal;
-        layout (location = 3) in uvec4 aBoneIDs;
-        layout (location = 4) in vec4 aWeights;
-
-        out vec3 FragPos;
-        out vec3 Normal;
-        out vec2 TexCoord;
-
-        uniform mat4 model;
-        uniform mat4 view;
-        uniform mat4 projection;
-        uniform samplerBuffer boneMatrixTex;
-
-        mat4 getBoneMatrix(int index)
-        {
-            int baseIndex = index * 4;
-            return mat4(
-                texelFetch(boneMatrixTex, baseIndex + 0),
-                texelFetch(boneMatrixTex, baseIndex + 1),
-                texelFetch(boneMatrixTex, baseIndex + 2),
-                texelFetch(boneMatrixTex, baseIndex + 3)
-            );
-        }
-        
-        void main() {
-            mat4 skinMatrix = 
-                getBoneMatrix(int(aBoneIDs.x)) * aWeights.x +
-                getBoneMatrix(int(aBoneIDs.y)) * aWeights.y +
-                getBoneMatrix(int(aBoneIDs.z)) * aWeights.z +
-                getBoneMatrix(int(aBoneIDs.w)) * aWeights.w;
-
-            vec4 skinnedPosition = skinMatrix * vec4(aPos, 1.0);
-            vec3 skinnedNormal = mat3(skinMatrix) * aNormal;
-
-            FragPos = vec3(model * skinnedPosition);
-            Normal = mat3(transpose(inverse(model))) * skinnedNormal;
-            TexCoord = aUV;
-
-            gl_Position = projection * view * vec4(FragPos, 1.0);
-        }
-    )GLSL";
-
-    const char* fragSrc = R"GLSL(
-        #version 330 core
-        #pragma optimize(off)
-
-        in vec2 TexCoord;
-        in vec3 FragPos;
-        in vec3 Normal;
-
-        out vec4 FragColor;
-
-        uniform vec3 cameraPos;
-        uniform vec3 lightDir;
-        uniform vec4 baseColor;
-        uniform vec4 specularColor;
-        uniform bool uniformLight;
-
-        uniform sampler2D texture0;
-        uniform sampler2D texture1;
-        uniform sampler2D texture2;
-        uniform sampler2D texture3;
-        uniform sampler2D glossTexture;
-
-        // uvType, blendType
-        uniform ivec2 types0;
-        uniform ivec2 types1;
-        uniform ivec2 types2;
-        uniform ivec2 types3;
-
-        // u, v
-        uniform vec2 speed0;
-        uniform vec2 speed1;
-        uniform vec2 speed2;
-        uniform vec2 speed3;
-
-        uniform bool hasGlossTexture;
-        uniform bool isMaterialGeneral;
-        uniform int textureCount;
-        uniform float glossShininess;
-        uniform float time;
-
-        vec3 calculateSpecular(vec3 normal, vec3 viewDir, vec3 lightDir)
-        {
-            float shininess = hasGlossTexture ? glossShininess : 2.0;
-            vec3 specular = vec3(1.0);
-            vec3 halfDir = normalize(viewDir + lightDir);
-            float specIntensity = pow(max(dot(normal, halfDir), 0.0), shininess);
-
-            if (hasGlossTexture)
-                specular = texture(glossTexture, TexCoord).rgb * specIntensity;
-            else
-                specular = specularColor.rgb * specIntensity;
-
-            return specular;
-        }
-
-        vec2 getUV(int uvType, vec2 baseUV, vec3 worldPos, vec3 normal, vec2 speed, float time)
-        {
-            if (uvType == 0) // Mesh
-            {
-                return baseUV;
-            }
-            else if (uvType == 1) // Environment
-            {
-                //vec3 r = reflect(normalize(worldPos - cameraPos), normalize(normal));
-                //float m = 2.0 * sqrt(r.x * r.x + r.y * r.y + (r.z + 1.0) * (r.z + 1.0));
-                //return 0.5 * (r.xy / m + 1.0);
-                vec3 r = reflect(normalize(FragPos - cameraPos), normalize(normal));
-                float m = sqrt(r.x * r.x + r.y * r.y + (r.z + 1.0) * (r.z + 1.0));
-                return 0.5 * (r.xy / m + 1.0);
-            }
-            else if (uvType == 2) // Drift
-            {
-                return baseUV + speed * time;
-            }
-            else if (uvType == 3) // Swirl
-            {
-                vec2 center = vec2(0.5);
-                vec2 uv = baseUV - center;
-
-                float swirlSpeed = (speed.x == 0.0 && speed.y == 0.0) ? 60.0 : speed.x;
-                float angle = time * swirlSpeed * 0.0475;
-                float s = sin(angle);
-                float c = cos(angle);
-
-                uv = vec2(
-                    uv.x * c - uv.y * s,
-                    uv.x * s + uv.y * c
-                );
-                return uv + center;
-            }
-            else if (uvType == 4) // Wavey
-            {
-                vec2 uv = baseUV;
-                uv.y += sin((uv.x + time * speed.x) * 10.0) * 0.02;
-                uv.x += sin((uv.y + time * speed.y) * 10.0) * 0.02;
-                return uv;
-            }
-
-            return baseUV;
-        }
-
-        struct BlendedResult
-        {
-            vec3 rgb;
-            float alpha;
-        };
-
-        BlendedResult blendColor(vec4 base, vec4 newTex, int blendType)
-        {
-            BlendedResult result;
-            result.alpha = base.a;
-
-            if (blendType == 0) // Modulate
-            {
-                result.rgb = base.rgb * newTex.rgb;
-                result.alpha = base.a * newTex.a;
-            }
-            else if (blendType == 1) // Add
-            {
-                result.rgb = base.rgb + newTex.rgb;
-                result.alpha = base.a * newTex.a;
-            }
-            else if (blendType == 2) // Texture Alpha
-            {
-                float ta = newTex.a;
-                result.rgb = (newTex.rgb * ta) + (base.rgb * (1.0 - ta));
-                result.alpha = base.a;
-            }
-            else if (blendType == 3) // Current Alpha
-            {
-                float ca = base.a;
-                result.rgb = (newTex.rgb * ca) + (base.rgb * (1.0 - ca));
-                result.alpha = newTex.a;
-            }
-            else if (blendType == 4) // Current Alpha Add
-            {
-                result.rgb = base.rgb + (newTex.a * newTex.rgb);
-                result.alpha = newTex.a;
-            }
-            else
-            {
-                result.rgb = base.rgb;
-                result.alpha = base.a;
-            }
-
-            return result;
-        }
-
-        vec4 getTextureColor(int index, vec2 uv)
-        {
-            if (index == 0)
-                return texture(texture0, uv);
-
-            if (index == 1)
-                return texture(texture1, uv);
-
-            if (index == 2)
-                return texture(texture2, uv);
-
-            if (index == 3)
-                return texture(texture3, uv);
-
-            return vec4(1.0);
-        }
-
-        ivec2 getType(int index)
-        {
-            if (index == 0)
-                return types0;
-
-            if (index == 1)
-                return types1;
-
-            if (index == 2)
-                return types2;
-
-            if (index == 3)
-                return types3;
-
-            return ivec2(0);
-        }
-
-        vec2 getSpeed(int index)
-        {
-            if (index == 0)
-                return speed0;
-
-            if (index == 1)
-                return speed1;
-
-            if (index == 2)
-                return speed2;
-
-            if (index == 3)
-                return speed3;
-
-            return vec2(0.0);
-        }
-
-        void main()
-        {
-            float diff = uniformLight ? 1.0 : max(dot(normalize(Normal), -lightDir), 0.0);
-            vec3 specular = calculateSpecular(normalize(Normal), normalize(cameraPos - FragPos), lightDir);
-
-            vec4 finalColor = vec4(baseColor.rgb * diff, baseColor.a);
-
-            for (int i = 0; i < textureCount; ++i)
-            {
-                ivec2 types = getType(i);
-                int uvType = types.x;
-                int blendType = types.y;
-
-                vec2 uv = getUV(uvType, TexCoord, FragPos, Normal, getSpeed(i), time);
-                vec4 texColor = getTextureColor(i, uv);
-
-                BlendedResult blended = blendColor(finalColor, texColor, blendType);
-                finalColor.rgb = blended.rgb;
-                finalColor.a = blended.alpha;
-            }
-
-            finalColor.rgb += specular;
-
-            FragColor = finalColor;
-        }
-    )GLSL";
-
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertSrc, nullptr);
-    glCompileShader(vertexShader);
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragSrc, nullptr);
-    glCompileShader(fragmentShader);
-
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // model shaders are per material variants, built on upload by MaterialShaders
 
 #pragma region grid shader
     const char* gridVertSrc = R"GLSL(
@@ -329,21 +44,7 @@ void Renderer::initialize()
         }
     )GLSL";
 
-    GLuint gridVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(gridVertexShader, 1, &gridVertSrc, nullptr);
-    glCompileShader(gridVertexShader);
-
-    GLuint gridFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(gridFragmentShader, 1, &gridFragSrc, nullptr);
-    glCompileShader(gridFragmentShader);
-
-    gridShaderProgram = glCreateProgram();
-    glAttachShader(gridShaderProgram, gridVertexShader);
-    glAttachShader(gridShaderProgram, gridFragmentShader);
-    glLinkProgram(gridShaderProgram);
-
-    glDeleteShader(gridVertexShader);
-    glDeleteShader(gridFragmentShader);
+    gridShaderProgram = ProgramCache::get().build("grid", gridVertSrc, gridFragSrc);
 #pragma endregion
 
 #pragma region bone axes shader
@@ -352,13 +53,24 @@ void Renderer::initialize()
         #pragma optimize(off)
 
         layout(location = 0) in vec3 aPos;
+        layout(location = 1) in vec3 aColor;
+        layout(location = 2) in mat4 aBoneMatrix; // per instance, occupies 2-5
+
+        out vec3 Color;
 
         uniform mat4 view;
         uniform mat4 projection;
+        uniform float axisLength;
 
         void main()
         {
-            gl_Position = projection * view * vec4(aPos, 1.0);
+            vec3 position = aBoneMatrix[3].xyz;
+            vec3 xAxis = normalize(aBoneMatrix[0].xyz) * axisLength;
+            vec3 yAxis = normalize(aBoneMatrix[1].xyz) * axisLength;
+            vec3 zAxis = normalize(aBoneMatrix[2].xyz) * axisLength;
+
+            Color = aColor;
+            gl_Position = projection * view * vec4(position + xAxis * aPos.x + yAxis * aPos.y + zAxis * aPos.z, 1.0);
         }
     )GLSL";
 
@@ -366,30 +78,17 @@ void Renderer::initialize()
         #version 330 core
         #pragma optimize(off)
 
+        in vec3 Color;
+
         out vec4 FragColor;
-        uniform vec3 color;
 
         void main()
         {
-            FragColor = vec4(color, 1.0);
+            FragColor = vec4(Color, 1.0);
         }
     )GLSL";
 
-    GLuint boneVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(boneVertexShader, 1, &boneVertSrc, nullptr);
-    glCompileShader(boneVertexShader);
-
-    GLuint boneFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(boneFragmentShader, 1, &boneFragSrc, nullptr);
-    glCompileShader(boneFragmentShader);
-
-    boneAxesShaderProgram = glCreateProgram();
-    glAttachShader(boneAxesShaderProgram, boneVertexShader);
-    glAttachShader(boneAxesShaderProgram, boneFragmentShader);
-    glLinkProgram(boneAxesShaderProgram);
-
-    glDeleteShader(boneVertexShader);
-    glDeleteShader(boneFragmentShader);
+    boneAxesShaderProgram = ProgramCache::get().build("bone axes", boneVertSrc, boneFragSrc);
 #pragma endregion
 
 #pragma region bone shape shader
@@ -399,18 +98,19 @@ void Renderer::initialize()
 
         layout (location = 0) in vec3 aPos;
         layout (location = 1) in vec3 aNormal;
+        layout (location = 2) in mat4 aBoneMatrix; // per instance, occupies 2-5
         
-        uniform mat4 model;
         uniform mat4 view;
         uniform mat4 projection;
+        uniform float shapeScale;
         
         out vec3 FragPos;
         out vec3 Normal;
         
         void main()
         {
-            FragPos = vec3(model * vec4(aPos, 1.0));
-            Normal = mat3(transpose(inverse(model))) * aNormal;
+            FragPos = vec3(aBoneMatrix * vec4(aPos * shapeScale, 1.0));
+            Normal = transpose(inverse(mat3(aBoneMatrix))) * aNormal;
             gl_Position = projection * view * vec4(FragPos, 1.0);
         }
     )GLSL";
@@ -442,26 +142,22 @@ void Renderer::initialize()
         }
     )GLSL";
 
-    GLuint boneShapeVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(boneShapeVertexShader, 1, &boneShapeVertSrc, nullptr);
-    glCompileShader(boneShapeVertexShader);
+    boneShapeShaderProgram = ProgramCache::get().build("bone shape", boneShapeVertSrc, boneShapeFragSrc);
+#pragma endregion
 
-    GLuint boneShapeFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(boneShapeFragmentShader, 1, &boneShapeFragSrc, nullptr);
-    glCompileShader(boneShapeFragmentShader);
+    const ProgramCache::Stats& programStats = ProgramCache::get().getStats();
+    LOG_INFO << "Shader programs: " << programStats.loaded << " from cache in " << programStats.loadMilliseconds << " ms, "
+             << programStats.compiled << " compiled in " << programStats.compileMilliseconds << " ms";
 
-    boneShapeShaderProgram = glCreateProgram();
-    glAttachShader(boneShapeShaderProgram, boneShapeVertexShader);
-    glAttachShader(boneShapeShaderProgram, boneShapeFragmentShader);
-    glLinkProgram(boneShapeShaderProgram);
+    // other stuff
+    // base instance carries the material index of each indirect command, so all three are needed
+    multiDrawSupported = GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_draw_indirect && GLAD_GL_ARB_base_instance;
+    LOG_INFO << "Model rendering: " << (multiDrawSupported ? "texture arrays + multi-draw indirect" : "one draw per material group");
 
-    glDeleteShader(boneShapeVertexShader);
-    glDeleteShader(boneShapeFragmentShader);
-#pragma endregion
+    // per-frame data, bone matrices and gizmo instances
+    streamBuffer.create(64 * 1024);
 
-    // other stuff
-    // bone TBO
-    glGenBuffers(1, &boneTBO);
+    // bone TBO, sources the stream buffer
     glGenTextures(1, &boneTBOTexture);
 
     // grid setup
@@ -492,14 +188,59 @@ void Renderer::initialize()
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
 
     glBindVertexArray(0);
+
+    // bone gizmos, static meshes drawn once per frame with one instance per bone
+    glGenVertexArrays(1, &boneAxesVAO);
+    glGenBuffers(1, &boneAxesVBO);
+
+    glBindVertexArray(boneAxesVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, boneAxesVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Shape::Axes::modelVertices), Shape::Axes::modelVertices, GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Shape::ColoredVertex), (void*)0);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Shape::ColoredVertex), (void*)offsetof(Shape::ColoredVertex, color));
+
+    glGenVertexArrays(1, &boneShapeVAO);
+    glGenBuffers(1, &boneShapeVBO);
+
+    glBindVertexArray(boneShapeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, boneShapeVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Shape::Bone::modelVertices), Shape::Bone::modelVertices, GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Shape::Vertex), (void*)0);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Shape::Vertex), (void*)offsetof(Shape::Vertex, normal));
+
+    glBindVertexArray(0);
+}
+
+void Renderer::setupBoneInstanceAttributes(size_t offset)
+{
+    // mat4 attribute takes 4 consecutive locations, one column each
+    // expects the target VAO to be bound, re-pointed every frame since the offset moves around the ring
+    glBindBuffer(GL_ARRAY_BUFFER, streamBuffer.getBuffer());
+
+    for (GLuint i = 0; i < 4; i++)
+    {
+        glEnableVertexAttribArray(2 + i);
+        glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(2 + i, 1);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void Renderer::shutdown()
 {
     clearMesh();
+    clearScene();
 
-    if (shaderProgram)
-        glDeleteProgram(shaderProgram);
+    materialShaders.shutdown();
 
     if (gridShaderProgram)
         glDeleteProgram(gridShaderProgram);
@@ -523,282 +264,1046 @@ void Renderer::shutdown()
         glDeleteBuffers(1, &boneAxesVBO);
 
     if (boneShapeVAO)
-
         glDeleteVertexArrays(1, &boneShapeVAO);
+
     if (boneShapeVBO)
         glDeleteBuffers(1, &boneShapeVBO);
+
+    if (boneTBOTexture)
+        glDeleteTextures(1, &boneTBOTexture);
+
+    boneTBOTexture = 0;
+    boneTBOGeneration = 0;
+    streamBuffer.destroy();
 }
 
 void Renderer::uploadMesh(const SKM::MeshBuffer& inputMesh)
 {
+    // releasing the previous mesh and copying the new one, GL upload is its own stage
+    LOAD_STAGE("Mesh copy");
+
+    // held until the new mesh has its textures, so images both meshes use are not uploaded again
+    std::vector<MaterialBinding> previousBindings = std::move(modelMesh.materialBindings);
+
     clearMesh();
     mesh = inputMesh;
-    mesh.upload();
+    modelMesh.mesh = &mesh;
+    uploadMeshBuffers(modelMesh);
+    pruneTextures();
 }
 
 void Renderer::clearMesh()
 {
-    mesh.destroy();
+    destroyMeshBuffers(modelMesh);
+    mesh.clear();
 }
 
-void Renderer::render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, bool showTPose, float timeValue)
+void Renderer::uploadScene(const Scene& scene)
 {
-    if (!mesh.modelVAO)
-        return;
+    std::vector<GpuMesh> previousMeshes = std::move(sceneMeshes);
+    sceneMeshes.clear();
 
-    glUseProgram(shaderProgram);
+    sceneMeshes.resize(scene.getModels().size());
 
-    glm::mat4 model = mesh.modelMatrix;
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &model[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+    for (size_t i = 0; i < sceneMeshes.size(); i++)
+    {
+        sceneMeshes[i].mesh = &scene.getModels()[i]->mesh;
+        uploadMeshBuffers(sceneMeshes[i]);
+    }
 
-    // bones
-    const std::vector<glm::mat4>& boneMats = showTPose ? mesh.tPoseSkinningMatrix : mesh.skinningMatrix;
-    size_t boneCount = boneMats.size();
+    // after the upload, textures the previous scene shares with this one are still alive and get reused
+    for (GpuMesh& gpuMesh : previousMeshes)
+        destroyMeshBuffers(gpuMesh);
 
-    glBindBuffer(GL_TEXTURE_BUFFER, boneTBO);
-    glBufferData(GL_TEXTURE_BUFFER, boneCount * sizeof(glm::mat4), boneMats.data(), GL_DYNAMIC_DRAW);
+    pruneTextures();
+}
 
-    glBindTexture(GL_TEXTURE_BUFFER, boneTBOTexture);
-    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, boneTBO);
+void Renderer::clearScene()
+{
+    for (GpuMesh& gpuMesh : sceneMeshes)
+        destroyMeshBuffers(gpuMesh);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_BUFFER, boneTBOTexture);
-    glUniform1i(glGetUniformLocation(shaderProgram, "boneMatrixTex"), 0);
-    // bones end
+    sceneMeshes.clear();
+    pruneTextures();
+}
 
-    glUniform3fv(glGetUniformLocation(shaderProgram, "lightDir"), 1, &lightDir[0]);
-    glUniform3fv(glGetUniformLocation(shaderProgram, "cameraPos"), 1, &cameraPos[0]);
+void Renderer::uploadMeshBuffers(GpuMesh& gpuMesh)
+{
+    LOAD_STAGE("GL upload");
 
-    glUniform1f(glGetUniformLocation(shaderProgram, "time"), timeValue);
+    const SKM::MeshBuffer& mesh = *gpuMesh.mesh;
 
-    auto debugColors = generateDebugColors(mesh.materialGroup.size());
+    glGenVertexArrays(1, &gpuMesh.vao);
+    glGenBuffers(1, &gpuMesh.vbo);
+    glGenBuffers(1, &gpuMesh.ebo);
 
-    for (uint32_t i = 0; i < mesh.materialGroup.size(); i++)
-    {
-        const auto& group = mesh.materialGroup[i];
+    glBindVertexArray(gpuMesh.vao);
 
-        glBindVertexArray(mesh.modelVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(SKM::GPUVertex), mesh.vertices.data(), GL_STATIC_DRAW);
 
-        uint8_t flags = mesh.materialData[i].renderFlags;
-        bool uniformLight = uniformLighting;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), GL_STATIC_DRAW);
+    Profiler::get().countUploadBytes(mesh.vertices.size() * sizeof(SKM::GPUVertex) + mesh.indices.size() * sizeof(uint32_t));
 
-        if (flags & MDF::MDFFile::RENDER_FLAG_NOT_LIT)
-            uniformLight = true;
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SKM::GPUVertex), (void*)0);
 
-        glUniform1i(glGetUniformLocation(shaderProgram, "uniformLight"), uniformLight);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SKM::GPUVertex), (void*)offsetof(SKM::GPUVertex, uv));
 
-        if (flags & MDF::MDFFile::RENDER_FLAG_DOUBLE)
-            glDisable(GL_CULL_FACE);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(SKM::GPUVertex), (void*)offsetof(SKM::GPUVertex, normal));
 
-        if (!debugMaterials)
-        {
-            uint8_t materialBlendType = mesh.materialData[i].materialBlendType;
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 4, GL_UNSIGNED_INT, sizeof(SKM::GPUVertex), (void*)offsetof(SKM::GPUVertex, boneIDs));
 
-            switch (materialBlendType)
-            {
-                case MDF::MDFFile::MATERIAL_BLEND_TYPE_NONE:
-                    glDisable(GL_BLEND);
-                    break;
-                case MDF::MDFFile::MATERIAL_BLEND_TYPE_ALPHA:
-                    glEnable(GL_BLEND);
-                    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-                    //glDepthMask(GL_FALSE);
-                    break;
-                case MDF::MDFFile::MATERIAL_BLEND_TYPE_ADD:
-                    glEnable(GL_BLEND);
-                    glBlendFunc(GL_ONE, GL_ONE);
-                    //glDepthMask(GL_FALSE);
-                    break;
-                case MDF::MDFFile::MATERIAL_BLEND_TYPE_ALPHA_ADD:
-                    glEnable(GL_BLEND);
-                    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-                    glDepthMask(GL_FALSE);
-                    break;
-            }
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(SKM::GPUVertex), (void*)offsetof(SKM::GPUVertex, boneWeights));
 
-            MDF::ColorRGBAFloat tempColor = MDF::toRGBAFloat(mesh.materialData[i].color);
-            glm::vec4 color = glm::vec4(tempColor.r, tempColor.g, tempColor.b, tempColor.a);
-            tempColor = MDF::toRGBAFloat(mesh.materialData[i].specular);
-            glm::vec4 spec = glm::vec4(tempColor.r, tempColor.g, tempColor.b, tempColor.a);
+    glBindVertexArray(0);
 
-            glUniform4fv(glGetUniformLocation(shaderProgram, "baseColor"), 1, &color[0]);
-            glUniform4fv(glGetUniformLocation(shaderProgram, "specularColor"), 1, &spec[0]);
+    gpuMesh.batched = multiDrawSupported && uploadBatchedMaterials(gpuMesh);
 
-            glUniform1i(glGetUniformLocation(shaderProgram, "hasGlossTexture"), !mesh.materialData[i].glossMap.empty());
-            glUniform1i(glGetUniformLocation(shaderProgram, "isMaterialGeneral"), mesh.materialData[i].materialType == MDF::MDFFile::MATERIAL_TYPE_GENERAL);
-            glUniform1i(glGetUniformLocation(shaderProgram, "textureCount"), mesh.materialData[i].textureCount);
+    gpuMesh.materialBindings.resize(mesh.materialData.size());
+
+    for (size_t i = 0; i < mesh.materialData.size(); i++)
+    {
+        const MDF::Material& material = *mesh.materialData[i];
+        MaterialBinding& binding = gpuMesh.materialBindings[i];
 
-            for (uint32_t j = 0; j < mesh.materialData[i].textureCount; j++)
+        // the batched path samples the texture arrays instead
+        if (!gpuMesh.batched)
+        {
+            for (uint32_t j = 0; j < material.textureCount && j < 4; j++)
             {
-                GLint types[2] = { (int)mesh.materialData[i].uvType[j], (int)mesh.materialData[i].blendType[j] };
-                glm::vec2 speed = glm::vec2(mesh.materialData[i].speedU[j], mesh.materialData[i].speedV[j]);
+                if (material.textures[j])
+                    binding.layers[j] = acquireTexture(material.textures[j]);
+            }
 
-                glActiveTexture(GL_TEXTURE0 + j);
-                glBindTexture(GL_TEXTURE_2D, mesh.materialData[i].textureIDs[j]);
+            if (material.gloss)
+                binding.gloss = acquireTexture(material.gloss);
+        }
 
-                glUniform1i(glGetUniformLocation(shaderProgram, ("texture" + std::to_string(j)).c_str()), j);
-                glUniform2iv(glGetUniformLocation(shaderProgram, ("types" + std::to_string(j)).c_str()), 1, types);
-                glUniform2fv(glGetUniformLocation(shaderProgram, ("speed" + std::to_string(j)).c_str()), 1, &speed[0]);
-            }
+        binding.program = &materialShaders.get(MaterialShaders::makeKey(material, material.gloss != nullptr, gpuMesh.batched));
+    }
 
-            if (!mesh.materialData[i].glossMap.empty())
-            {
-                auto& image = TGA::getOrLoadTexture(mesh.materialData[i].glossMap, mesh.textureCache);
+    if (gpuMesh.batched)
+        buildDrawBatches(gpuMesh);
+}
 
-                GLuint textureID;
-                glGenTextures(1, &textureID);
-                glBindTexture(GL_TEXTURE_2D, textureID);
+void Renderer::pruneTextures()
+{
+    for (auto it = uploadedTextures.begin(); it != uploadedTextures.end();)
+    {
+        if (it->second.expired())
+            it = uploadedTextures.erase(it);
+        else
+            ++it;
+    }
+}
 
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+std::shared_ptr<Renderer::Texture> Renderer::acquireTexture(const std::shared_ptr<const TGA::TGAImage>& image)
+{
+    std::weak_ptr<Texture>& entry = uploadedTextures[image.get()];
 
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+    if (std::shared_ptr<Texture> existing = entry.lock())
+        return existing;
 
-                glGenerateMipmap(GL_TEXTURE_2D);
+    auto texture = std::make_shared<Texture>();
+    texture->image = image;
 
-                glActiveTexture(GL_TEXTURE5);
-                glBindTexture(GL_TEXTURE_2D, textureID);
-                glUniform1i(glGetUniformLocation(shaderProgram, "glossTexture"), 5);
-                glUniform1f(glGetUniformLocation(shaderProgram, "glossShininess"), mesh.materialData[i].specularPower);
-            }
-        }
-        else
-        {
-            glm::vec4 color = debugColors[i % debugColors.size()];
-            glUniform4fv(glGetUniformLocation(shaderProgram, "baseColor"), 1, &color[0]);
-        }
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D, texture->id);
 
-        glDrawElements(GL_TRIANGLES, group.indexCount, GL_UNSIGNED_INT, (void*)(group.indexOffset * sizeof(uint32_t)));
-        glBindVertexArray(0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-        glEnable(GL_CULL_FACE);
-        glDepthMask(GL_TRUE);
-    }
-}
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->width, image->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image->pixels.data());
+    Profiler::get().countUploadBytes(image->pixels.size());
 
-void Renderer::renderGrid(const glm::mat4& view, const glm::mat4& projection) const
-{
-    glUseProgram(gridShaderProgram);
+    glGenerateMipmap(GL_TEXTURE_2D);
 
-    glUniformMatrix4fv(glGetUniformLocation(gridShaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(gridShaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+    entry = texture;
 
-    glBindVertexArray(gridVAO);
-    glDrawArrays(GL_LINES, 0, gridLineCount);
-    glBindVertexArray(0);
+    return texture;
 }
 
-void Renderer::renderBones(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, bool showAxes, bool showOctahedrons, const glm::vec3 lightDir, bool showTPose)
+bool Renderer::uploadBatchedMaterials(GpuMesh& gpuMesh)
 {
-    if (!showAxes && !showOctahedrons)
+    const SKM::MeshBuffer& mesh = *gpuMesh.mesh;
+
+    // one array per texture size, every image the mesh uses gets a layer
+    struct TextureArray
     {
-        renderBoneShapes(view, projection, scaleFactor, lightDir, showTPose);
-        return;
-    }
+        uint16_t width = 0;
+        uint16_t height = 0;
+        std::vector<const TGA::TGAImage*> images;
+    };
 
-    if (showAxes)
-        renderBoneAxes(view, projection, scaleFactor, showTPose);
+    std::vector<TextureArray> arrays;
+    std::unordered_map<const TGA::TGAImage*, glm::vec2> layerRefs; // array, layer
 
-    if (showOctahedrons)
-        renderBoneShapes(view, projection, scaleFactor, lightDir, showTPose);
-}
+    auto addImage = [&](const TGA::TGAImage* image)
+    {
+        if (!image || layerRefs.count(image))
+            return;
 
-void Renderer::renderBoneAxes(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, bool showTPose)
-{
-    glUseProgram(boneAxesShaderProgram);
+        size_t index = 0;
 
-    glUniformMatrix4fv(glGetUniformLocation(boneAxesShaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(boneAxesShaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+        while (index < arrays.size() && (arrays[index].width != image->width || arrays[index].height != image->height))
+            index++;
+
+        if (index == arrays.size())
+            arrays.push_back({ image->width, image->height, {} });
 
-    for (const auto& boneMatrix : showTPose ? mesh.skmWorldMatrices : mesh.skaWorldMatrices)
+        layerRefs[image] = glm::vec2(static_cast<float>(index), static_cast<float>(arrays[index].images.size()));
+        arrays[index].images.push_back(image);
+    };
+
+    for (const auto& material : mesh.materialData)
     {
-        float factor = 4.f * scaleFactor;
-        glm::vec3 position = glm::vec3(boneMatrix[3]);
-        glm::vec3 xAxis = glm::normalize(glm::vec3(boneMatrix[0])) * factor;
-        glm::vec3 yAxis = glm::normalize(glm::vec3(boneMatrix[1])) * factor;
-        glm::vec3 zAxis = glm::normalize(glm::vec3(boneMatrix[2])) * factor;
+        for (uint32_t j = 0; j < material->textureCount && j < 4; j++)
+            addImage(material->textures[j].get());
+
+        addImage(material->gloss.get());
+    }
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
 
-        glm::vec3 data[6] = {
-            position - xAxis, position + xAxis,
-            position - yAxis, position + yAxis,
-            position - zAxis, position + zAxis
-        };
+    // more sizes than sampler units, the mesh goes through the per group path
+    if (arrays.size() > static_cast<size_t>(MaterialShaders::textureArrayCount))
+        return false;
 
-        glm::vec3 colors[3] = {
-            glm::vec3(1.f, 0, 0),
-            glm::vec3(0, 1.f, 0),
-            glm::vec3(0, 0, 1.f)
-        };
+    for (const auto& array : arrays)
+    {
+        if (array.images.size() > static_cast<size_t>(maxLayers))
+            return false;
+    }
 
-        glGenVertexArrays(1, &boneAxesVAO);
-        glGenBuffers(1, &boneAxesVBO);
+    gpuMesh.textureArrays.resize(arrays.size());
+    glGenTextures(static_cast<GLsizei>(gpuMesh.textureArrays.size()), gpuMesh.textureArrays.data());
 
-        glBindVertexArray(boneAxesVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, boneAxesVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(data), data, GL_STATIC_DRAW);
+    for (size_t i = 0; i < arrays.size(); i++)
+    {
+        const TextureArray& array = arrays[i];
 
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, gpuMesh.textureArrays[i]);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.width, array.height, static_cast<GLsizei>(array.images.size()), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 
-        for (int i = 0; i < 3; ++i)
+        for (size_t layer = 0; layer < array.images.size(); layer++)
         {
-            glUniform3f(glGetUniformLocation(boneAxesShaderProgram, "color"), colors[i].x, colors[i].y, colors[i].z);
-            glDrawArrays(GL_LINES, i * 2, 2);
+            const TGA::TGAImage* image = array.images[layer];
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer), image->width, image->height, 1, GL_RGBA, GL_UNSIGNED_BYTE, image->pixels.data());
+            Profiler::get().countUploadBytes(image->pixels.size());
         }
 
-        glBindVertexArray(0);
-        glDeleteBuffers(1, &boneAxesVBO);
-        glDeleteVertexArrays(1, &boneAxesVAO);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
     }
-}
 
-void Renderer::renderBoneShapes(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, const glm::vec3 lightDir, bool showTPose)
-{
-    glUseProgram(boneShapeShaderProgram);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
-    glm::mat4 model = glm::mat4(1.f);
-    glUniformMatrix4fv(glGetUniformLocation(boneShapeShaderProgram, "model"), 1, GL_FALSE, &model[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(boneShapeShaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(boneShapeShaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
-    glUniform3fv(glGetUniformLocation(boneShapeShaderProgram, "lightDir"), 1, &lightDir[0]);
+    // material buffer, layout matches loadMaterial() of the batched variants
+    auto findRef = [&](const TGA::TGAImage* image)
+    {
+        auto it = layerRefs.find(image);
+        return it != layerRefs.end() ? it->second : glm::vec2(-1.f, 0.f);
+    };
+
+    std::vector<glm::vec4> texels(mesh.materialData.size() * MaterialShaders::materialTexels);
 
-    for (const auto& boneMatrix : showTPose ? mesh.skmWorldMatrices : mesh.skaWorldMatrices)
+    for (size_t i = 0; i < mesh.materialData.size(); i++)
     {
-        Shape::Vertex transformedVertices[24];
-        memcpy(transformedVertices, Shape::Bone::modelVertices, sizeof(Shape::Bone::modelVertices));
+        const MDF::Material& material = *mesh.materialData[i];
+        glm::vec4* texel = &texels[i * MaterialShaders::materialTexels];
+
+        MDF::ColorRGBAFloat color = MDF::toRGBAFloat(material.color);
+        MDF::ColorRGBAFloat specular = MDF::toRGBAFloat(material.specular);
+        glm::vec2 refs[4];
+
+        for (uint32_t j = 0; j < 4; j++)
+            refs[j] = j < material.textureCount ? findRef(material.textures[j].get()) : glm::vec2(-1.f, 0.f);
+
+        glm::vec2 glossRef = findRef(material.gloss.get());
+        bool notLit = (material.renderFlags & MDF::MDFFile::RENDER_FLAG_NOT_LIT) != 0;
+
+        texel[0] = glm::vec4(color.r, color.g, color.b, color.a);
+        texel[1] = glm::vec4(specular.r, specular.g, specular.b, specular.a);
+        texel[2] = glm::vec4(material.speedU[0], material.speedV[0], material.speedU[1], material.speedV[1]);
+        texel[3] = glm::vec4(material.speedU[2], material.speedV[2], material.speedU[3], material.speedV[3]);
+        texel[4] = glm::vec4(refs[0].x, refs[0].y, refs[1].x, refs[1].y);
+        texel[5] = glm::vec4(refs[2].x, refs[2].y, refs[3].x, refs[3].y);
+        texel[6] = glm::vec4(glossRef.x, glossRef.y, material.specularPower, notLit ? 1.f : 0.f);
+    }
 
-        for (uint8_t i = 0; i < 24; i++)
-        {
-            glm::vec4 worldPos = boneMatrix * glm::vec4(transformedVertices[i].position * scaleFactor * 7.5f, 1.0f);
-            transformedVertices[i].position = glm::vec3(worldPos);
+    glGenBuffers(1, &gpuMesh.materialBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, gpuMesh.materialBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    Profiler::get().countUploadBytes(texels.size() * sizeof(glm::vec4));
 
-            glm::vec4 normal = glm::transpose(glm::inverse(boneMatrix)) * glm::vec4(transformedVertices[i].normal, 0.0f);
-            transformedVertices[i].normal = glm::normalize(glm::vec3(normal));
-        }
+    glGenTextures(1, &gpuMesh.materialTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, gpuMesh.materialTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, gpuMesh.materialBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
 
-        glGenVertexArrays(1, &boneShapeVAO);
-        glGenBuffers(1, &boneShapeVBO);
+    // 0..n-1 as an instanced attribute, an indirect command's baseInstance then selects its material
+    std::vector<uint32_t> materialIndices(mesh.materialData.size());
 
-        glBindVertexArray(boneShapeVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, boneShapeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(transformedVertices), transformedVertices, GL_STATIC_DRAW);
+    for (size_t i = 0; i < materialIndices.size(); i++)
+        materialIndices[i] = static_cast<uint32_t>(i);
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Shape::Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
+    glBindVertexArray(gpuMesh.vao);
 
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Shape::Vertex), (void*)offsetof(Shape::Vertex, Shape::Vertex::normal));
-        glEnableVertexAttribArray(1);
+    glGenBuffers(1, &gpuMesh.materialIndexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.materialIndexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, materialIndices.size() * sizeof(uint32_t), materialIndices.data(), GL_STATIC_DRAW);
 
-        glDrawArrays(GL_TRIANGLES, 0, Shape::Bone::vertexCount);
+    glEnableVertexAttribArray(5);
+    glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+    glVertexAttribDivisor(5, materialDivisor);
 
-        glBindVertexArray(0);
-        glDeleteBuffers(1, &boneShapeVBO);
-        glDeleteVertexArrays(1, &boneShapeVAO);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return true;
+}
+
+void Renderer::buildDrawBatches(GpuMesh& gpuMesh)
+{
+    const SKM::MeshBuffer& mesh = *gpuMesh.mesh;
+    std::vector<uint32_t> order;
+
+    for (uint32_t i = 0; i < mesh.materialGroup.size(); i++)
+    {
+        const auto& group = mesh.materialGroup[i];
+
+        if (group.materialID >= 0 && group.materialID < static_cast<int32_t>(mesh.materialData.size()) && group.indexCount)
+            order.push_back(i);
     }
+
+    auto isBlended = [&](uint32_t groupIndex)
+    {
+        return mesh.materialData[mesh.materialGroup[groupIndex].materialID]->materialBlendType != MDF::MDFFile::MATERIAL_BLEND_TYPE_NONE;
+    };
+
+    auto isDoubleSided = [&](uint32_t groupIndex)
+    {
+        return (mesh.materialData[mesh.materialGroup[groupIndex].materialID]->renderFlags & MDF::MDFFile::RENDER_FLAG_DOUBLE) != 0;
+    };
+
+    // opaque groups first, grouped by variant and culling so each run becomes one call, blended groups keep their order
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+    {
+        bool blendedA = isBlended(a);
+        bool blendedB = isBlended(b);
+
+        if (blendedA || blendedB)
+            return !blendedA && blendedB;
+
+        const MaterialShaders::Program* programA = gpuMesh.materialBindings[mesh.materialGroup[a].materialID].program;
+        const MaterialShaders::Program* programB = gpuMesh.materialBindings[mesh.materialGroup[b].materialID].program;
+
+        if (programA != programB)
+            return programA < programB;
+
+        return isDoubleSided(a) < isDoubleSided(b);
+    });
+
+    std::vector<DrawElementsIndirectCommand>& commands = gpuMesh.commands;
+    std::vector<DrawBatch>& drawBatches = gpuMesh.drawBatches;
+
+    for (uint32_t groupIndex : order)
+    {
+        const auto& group = mesh.materialGroup[groupIndex];
+        const MDF::Material& material = *mesh.materialData[group.materialID];
+        MaterialShaders::Program* program = gpuMesh.materialBindings[group.materialID].program;
+        bool doubleSided = isDoubleSided(groupIndex);
+
+        if (drawBatches.empty() || drawBatches.back().program != program || drawBatches.back().doubleSided != doubleSided ||
+            drawBatches.back().materialBlendType != material.materialBlendType)
+        {
+            DrawBatch batch;
+            batch.program = program;
+            batch.materialBlendType = material.materialBlendType;
+            batch.doubleSided = doubleSided;
+            batch.firstCommand = static_cast<uint32_t>(commands.size());
+            drawBatches.push_back(batch);
+        }
+
+        commands.push_back({ static_cast<GLuint>(group.indexCount), 1, static_cast<GLuint>(group.indexOffset), 0, static_cast<GLuint>(group.materialID) });
+        gpuMesh.commandGroups.push_back(groupIndex);
+        drawBatches.back().commandCount++;
+    }
+
+    glGenBuffers(1, &gpuMesh.indirectBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gpuMesh.indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void Renderer::destroyMeshBuffers(GpuMesh& gpuMesh)
+{
+    if (gpuMesh.vao)
+        glDeleteVertexArrays(1, &gpuMesh.vao);
+
+    if (gpuMesh.vbo)
+        glDeleteBuffers(1, &gpuMesh.vbo);
+
+    if (gpuMesh.ebo)
+        glDeleteBuffers(1, &gpuMesh.ebo);
+
+    if (!gpuMesh.textureArrays.empty())
+        glDeleteTextures(static_cast<GLsizei>(gpuMesh.textureArrays.size()), gpuMesh.textureArrays.data());
+
+    if (gpuMesh.materialTexture)
+        glDeleteTextures(1, &gpuMesh.materialTexture);
+
+    if (gpuMesh.materialBuffer)
+        glDeleteBuffers(1, &gpuMesh.materialBuffer);
+
+    if (gpuMesh.materialIndexBuffer)
+        glDeleteBuffers(1, &gpuMesh.materialIndexBuffer);
+
+    if (gpuMesh.indirectBuffer)
+        glDeleteBuffers(1, &gpuMesh.indirectBuffer);
+
+    if (gpuMesh.skinnedVao)
+        glDeleteVertexArrays(1, &gpuMesh.skinnedVao);
+
+    if (gpuMesh.skinnedBuffer)
+        glDeleteBuffers(1, &gpuMesh.skinnedBuffer);
+
+    // textures are deleted by their last reference
+    gpuMesh = GpuMesh();
+}
+
+void Renderer::beginFrame()
+{
+    streamBuffer.beginFrame();
+}
+
+void Renderer::endFrame()
+{
+    streamBuffer.endFrame();
+}
+
+void Renderer::beginInstances(size_t count)
+{
+    instanceData.assign(count * MaterialShaders::instanceTexels, glm::vec4(0.f));
+}
+
+void Renderer::setInstance(size_t index, const glm::mat4& modelMatrix, size_t paletteTexel)
+{
+    size_t recordTexel = index * MaterialShaders::instanceTexels;
+    glm::vec4* record = &instanceData[recordTexel];
+
+    for (int i = 0; i < 4; i++)
+        record[i] = modelMatrix[i];
+
+    // relative, so the record stays valid wherever the stream buffer puts this frame's data
+    record[4].x = static_cast<float>(paletteTexel) - static_cast<float>(recordTexel);
+}
+
+size_t Renderer::appendPalette(const std::vector<glm::mat4>& palette)
+{
+    size_t texel = instanceData.size();
+
+    for (const glm::mat4& matrix : palette)
+        instanceData.insert(instanceData.end(), &matrix[0], &matrix[0] + 4);
+
+    return texel;
+}
+
+GLint Renderer::writeInstances()
+{
+    // a single write, a growing stream buffer is reallocated and would lose anything written before in this pass
+    size_t offset = streamBuffer.write(instanceData.data(), instanceData.size() * sizeof(glm::vec4), sizeof(glm::vec4));
+
+    return static_cast<GLint>(offset / sizeof(glm::vec4));
+}
+
+void Renderer::render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, bool showTPose, float timeValue)
+{
+    if (!modelMesh.vao)
+        return;
+
+    PROFILE_PASS("Model");
+
+    const std::vector<glm::mat4>& palette = showTPose ? mesh.tPoseSkinningMatrix : mesh.skinningMatrix;
+    glm::mat4 modelViewProjection = projection * view * mesh.modelMatrix;
+
+    if (!Frustum(modelViewProjection).intersects(mesh.bounds.pose(palette)))
+    {
+        Profiler::get().countCulledDraws(getDrawCount(modelMesh));
+        return;
+    }
+
+    const uint8_t* groupVisible = cullGroups(modelMesh, modelViewProjection, palette);
+    bool preskinned = skinningCacheEnabled && updateSkinningCache(modelMesh, palette);
+
+    // the opened SKM is a single instance, no palette when it draws from the skinning cache
+    beginInstances(1);
+    setInstance(0, mesh.modelMatrix, preskinned ? 0 : appendPalette(palette));
+    GLint instanceOffset = writeInstances();
+
+    beginModelPass(view, projection, lightDir, cameraPos, uniformLighting, timeValue);
+
+    drawPreskinned = preskinned;
+    drawMesh(modelMesh, instanceOffset, 1, groupVisible);
+    drawPreskinned = false;
+}
+
+void Renderer::renderWireframe(const glm::mat4& view, const glm::mat4& projection, bool showTPose)
+{
+    if (!modelMesh.vao || mesh.indices.empty())
+        return;
+
+    const std::vector<glm::mat4>& palette = showTPose ? mesh.tPoseSkinningMatrix : mesh.skinningMatrix;
+
+    if (!Frustum(projection * view * mesh.modelMatrix).intersects(mesh.bounds.pose(palette)))
+    {
+        Profiler::get().countCulledDraws();
+        return;
+    }
+
+    PROFILE_PASS("Wireframe");
+
+    bool preskinned = skinningCacheEnabled && updateSkinningCache(modelMesh, palette);
+
+    beginInstances(1);
+    setInstance(0, mesh.modelMatrix, preskinned ? 0 : appendPalette(palette));
+    drawInstanceOffset = writeInstances();
+
+    beginModelPass(view, projection, glm::vec3(0.f), glm::vec3(0.f), true, 0.f);
+    drawPreskinned = preskinned;
+
+    const glm::vec4 color(1.f, .85f, .3f, 1.f);
+    MaterialShaders::Program& program = bindProgram(materialShaders.get(MaterialShaders::untexturedKey | MaterialShaders::wireframeBit));
+    glUniform4fv(program.baseColor, 1, &color[0]);
+
+    // pulled towards the camera so the lines pass the depth test against the surface they were shaded on
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    glEnable(GL_POLYGON_OFFSET_LINE);
+    glPolygonOffset(-1.f, -1.f);
+
+    // one draw for the whole index buffer, materials do not matter here
+    glBindVertexArray(preskinned ? modelMesh.skinnedVao : modelMesh.vao);
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, nullptr, 1);
+    Profiler::get().countDrawCalls();
+    glBindVertexArray(0);
+
+    glDisable(GL_POLYGON_OFFSET_LINE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    drawPreskinned = false;
+}
+
+void Renderer::renderScene(const Scene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, bool showTPose, float timeValue)
+{
+    const auto& models = scene.getModels();
+    const auto& instances = scene.getInstances();
+
+    if (sceneMeshes.size() != models.size() || instances.empty())
+        return;
+
+    PROFILE_PASS("Scene models");
+
+    glm::mat4 viewProjection = projection * view;
+    Frustum frustum(viewProjection);
+
+    visibleInstances.clear();
+    visibleRanges.clear();
+
+    for (const auto& model : models)
+    {
+        const SKM::MeshBuffer& modelMesh = model->mesh;
+        uint32_t first = static_cast<uint32_t>(visibleInstances.size());
+
+        // in T-pose every instance has the same mesh space bounds
+        Bounds tPoseBounds = showTPose ? modelMesh.bounds.pose(modelMesh.tPoseSkinningMatrix) : Bounds();
+
+        for (uint32_t i = model->firstInstance; i < model->firstInstance + model->instanceCount; i++)
+        {
+            const Bounds meshBounds = showTPose ? tPoseBounds : modelMesh.bounds.pose(instances[i].palette);
+
+            if (frustum.intersects(meshBounds.transformed(instances[i].transform * modelMesh.modelMatrix)))
+                visibleInstances.push_back(i);
+        }
+
+        visibleRanges.emplace_back(first, static_cast<uint32_t>(visibleInstances.size()) - first);
+    }
+
+    if (visibleInstances.empty())
+    {
+        for (const GpuMesh& gpuMesh : sceneMeshes)
+            Profiler::get().countCulledDraws(getDrawCount(gpuMesh));
+
+        return;
+    }
+
+    beginInstances(visibleInstances.size());
+
+    // every instance points at its own palette, in T-pose they all share their model's
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        const Scene::Model& model = *models[i];
+        const auto [first, count] = visibleRanges[i];
+        size_t sharedPalette = showTPose && count ? appendPalette(model.mesh.tPoseSkinningMatrix) : 0;
+
+        for (uint32_t j = first; j < first + count; j++)
+        {
+            const Scene::Instance& instance = instances[visibleInstances[j]];
+            setInstance(j, instance.transform * model.mesh.modelMatrix, showTPose ? sharedPalette : appendPalette(instance.palette));
+        }
+    }
+
+    GLint instanceOffset = writeInstances();
+
+    beginModelPass(view, projection, lightDir, cameraPos, uniformLighting, timeValue);
+
+    // records are grouped by model, so each model is one instanced draw per batch or group
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        const auto [first, count] = visibleRanges[i];
+
+        if (!count)
+        {
+            Profiler::get().countCulledDraws(getDrawCount(sceneMeshes[i]));
+            continue;
+        }
+
+        // groups are only culled for a lone instance, an instanced draw covers every group any instance shows
+        const uint8_t* groupVisible = nullptr;
+
+        if (count == 1)
+        {
+            const Scene::Instance& instance = instances[visibleInstances[first]];
+            const auto& palette = showTPose ? models[i]->mesh.tPoseSkinningMatrix : instance.palette;
+
+            groupVisible = cullGroups(sceneMeshes[i], viewProjection * instance.transform * models[i]->mesh.modelMatrix, palette);
+        }
+
+        drawMesh(sceneMeshes[i], instanceOffset + static_cast<GLint>(first * MaterialShaders::instanceTexels), count, groupVisible);
+    }
+}
+
+const uint8_t* Renderer::cullGroups(const GpuMesh& gpuMesh, const glm::mat4& modelViewProjection, const std::vector<glm::mat4>& palette)
+{
+    const auto& groups = gpuMesh.mesh->materialGroup;
+    Frustum frustum(modelViewProjection);
+
+    visibleGroups.resize(groups.size());
+
+    for (size_t i = 0; i < groups.size(); i++)
+        visibleGroups[i] = frustum.intersects(groups[i].bounds.pose(palette));
+
+    return visibleGroups.data();
+}
+
+uint32_t Renderer::getDrawCount(const GpuMesh& gpuMesh) const
+{
+    if (gpuMesh.batched && !debugMaterials)
+        return static_cast<uint32_t>(gpuMesh.drawBatches.size());
+
+    return static_cast<uint32_t>(gpuMesh.mesh ? gpuMesh.mesh->materialGroup.size() : 0);
+}
+
+void Renderer::bindBoneTexture()
+{
+    // own unit, sharing 0 with the sampler2D layers is invalid and strict drivers (Mesa) drop the draw
+    glActiveTexture(GL_TEXTURE0 + MaterialShaders::boneMatrixUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, boneTBOTexture);
+
+    // only re-attach when the stream buffer got reallocated
+    if (boneTBOGeneration != streamBuffer.getGeneration())
+    {
+        boneTBOGeneration = streamBuffer.getGeneration();
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, streamBuffer.getBuffer());
+    }
+}
+
+void Renderer::createSkinningCache(GpuMesh& gpuMesh)
+{
+    const GLsizei stride = 2 * sizeof(glm::vec3);
+
+    glGenBuffers(1, &gpuMesh.skinnedBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.skinnedBuffer);
+    glBufferData(GL_ARRAY_BUFFER, gpuMesh.mesh->vertices.size() * stride, nullptr, GL_DYNAMIC_COPY);
+
+    // the mesh's layout with skinned positions and normals, bone IDs and weights are not needed anymore
+    glGenVertexArrays(1, &gpuMesh.skinnedVao);
+    glBindVertexArray(gpuMesh.skinnedVao);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
+
+    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vbo);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SKM::GPUVertex), (void*)offsetof(SKM::GPUVertex, uv));
+
+    if (gpuMesh.materialIndexBuffer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.materialIndexBuffer);
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+        glVertexAttribDivisor(5, materialDivisor);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.ebo);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool Renderer::updateSkinningCache(GpuMesh& gpuMesh, const std::vector<glm::mat4>& palette)
+{
+    const SKM::MeshBuffer& mesh = *gpuMesh.mesh;
+
+    if (mesh.vertices.empty() || palette.empty())
+        return false;
+
+    if (!gpuMesh.skinnedVao)
+        createSkinningCache(gpuMesh);
+
+    // pose unchanged since the last update, nothing to skin this frame
+    if (gpuMesh.skinnedValid && gpuMesh.skinnedPalette == palette)
+        return true;
+
+    PROFILE_SCOPE("Skinning");
+
+    const MaterialShaders::SkinningProgram& program = materialShaders.getSkinning();
+
+    // consumed right away by the draw below, a reallocation by a later write in this frame does not matter
+    size_t offset = streamBuffer.write(palette.data(), palette.size() * sizeof(glm::mat4), sizeof(glm::vec4));
+    bindBoneTexture();
+
+    glUseProgram(program.id);
+    glUniform1i(program.paletteOffset, static_cast<GLint>(offset / sizeof(glm::vec4)));
+    currentProgram = nullptr;
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(gpuMesh.vao);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, gpuMesh.skinnedBuffer);
+
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(mesh.vertices.size()));
+    glEndTransformFeedback();
+    Profiler::get().countDrawCalls();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    gpuMesh.skinnedPalette = palette;
+    gpuMesh.skinnedValid = true;
+
+    return true;
+}
+
+void Renderer::beginModelPass(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, float timeValue)
+{
+    bindBoneTexture();
+
+    frameIndex++;
+    frameUniforms = { view, projection, lightDir, cameraPos, timeValue, uniformLighting };
+    currentProgram = nullptr;
+}
+
+void Renderer::drawMesh(GpuMesh& gpuMesh, GLint instanceOffset, uint32_t instanceCount, const uint8_t* groupVisible)
+{
+    drawInstanceOffset = instanceOffset;
+
+    glBindVertexArray(drawPreskinned ? gpuMesh.skinnedVao : gpuMesh.vao);
+
+    if (gpuMesh.batched && !debugMaterials)
+        renderBatches(gpuMesh, instanceCount, groupVisible);
+    else
+        renderGroups(gpuMesh, instanceCount, groupVisible);
+
+    glBindVertexArray(0);
+}
+
+MaterialShaders::Program& Renderer::bindProgram(MaterialShaders::Program& variant)
+{
+    // same variant reading the skinning cache, built the first time a pass needs it
+    MaterialShaders::Program& program = drawPreskinned ? materialShaders.get(variant.key | MaterialShaders::preskinnedBit) : variant;
+
+    if (&program != currentProgram)
+    {
+        currentProgram = &program;
+        glUseProgram(program.id);
+
+        // uniforms shared by the whole frame, once per variant
+        if (program.frame != frameIndex)
+        {
+            program.frame = frameIndex;
+
+            glUniformMatrix4fv(program.view, 1, GL_FALSE, &frameUniforms.view[0][0]);
+            glUniformMatrix4fv(program.projection, 1, GL_FALSE, &frameUniforms.projection[0][0]);
+            glUniform3fv(program.lightDir, 1, &frameUniforms.lightDir[0]);
+            glUniform3fv(program.cameraPos, 1, &frameUniforms.cameraPos[0]);
+            glUniform1f(program.time, frameUniforms.time);
+            glUniform1i(program.uniformLighting, frameUniforms.uniformLighting);
+        }
+    }
+
+    if (program.instanceOffsetValue != drawInstanceOffset)
+    {
+        program.instanceOffsetValue = drawInstanceOffset;
+        glUniform1i(program.instanceOffset, drawInstanceOffset);
+    }
+
+    return program;
+}
+
+void Renderer::applyBlendState(uint8_t materialBlendType)
+{
+    switch (materialBlendType)
+    {
+        case MDF::MDFFile::MATERIAL_BLEND_TYPE_NONE:
+            glDisable(GL_BLEND);
+            break;
+        case MDF::MDFFile::MATERIAL_BLEND_TYPE_ALPHA:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            //glDepthMask(GL_FALSE);
+            break;
+        case MDF::MDFFile::MATERIAL_BLEND_TYPE_ADD:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            //glDepthMask(GL_FALSE);
+            break;
+        case MDF::MDFFile::MATERIAL_BLEND_TYPE_ALPHA_ADD:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+            glDepthMask(GL_FALSE);
+            break;
+    }
+}
+
+void Renderer::renderBatches(GpuMesh& gpuMesh, uint32_t instanceCount, const uint8_t* groupVisible)
+{
+    if (gpuMesh.commands.empty())
+        return;
+
+    for (size_t i = 0; i < gpuMesh.textureArrays.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, gpuMesh.textureArrays[i]);
+    }
+
+    glActiveTexture(GL_TEXTURE0 + MaterialShaders::materialUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, gpuMesh.materialTexture);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gpuMesh.indirectBuffer);
+
+    // culled groups get no instances, the buffer is only rewritten when visibility or the instance count changed
+    bool changed = false;
+
+    for (size_t i = 0; i < gpuMesh.commands.size(); i++)
+    {
+        GLuint count = !groupVisible || groupVisible[gpuMesh.commandGroups[i]] ? instanceCount : 0;
+        changed |= gpuMesh.commands[i].instanceCount != count;
+        gpuMesh.commands[i].instanceCount = count;
+    }
+
+    if (changed)
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, gpuMesh.commands.size() * sizeof(DrawElementsIndirectCommand), gpuMesh.commands.data());
+
+    for (const DrawBatch& batch : gpuMesh.drawBatches)
+    {
+        bool anyVisible = false;
+
+        for (uint32_t i = batch.firstCommand; i < batch.firstCommand + batch.commandCount && !anyVisible; i++)
+            anyVisible = gpuMesh.commands[i].instanceCount != 0;
+
+        if (!anyVisible)
+        {
+            Profiler::get().countCulledDraws();
+            continue;
+        }
+
+        bindProgram(*batch.program);
+        applyBlendState(batch.materialBlendType);
+
+        if (batch.doubleSided)
+            glDisable(GL_CULL_FACE);
+
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(batch.firstCommand * sizeof(DrawElementsIndirectCommand)), batch.commandCount, 0);
+        Profiler::get().countDrawCalls();
+
+        glEnable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void Renderer::renderGroups(GpuMesh& gpuMesh, uint32_t instanceCount, const uint8_t* groupVisible)
+{
+    const SKM::MeshBuffer& mesh = *gpuMesh.mesh;
+    auto debugColors = generateDebugColors(mesh.materialGroup.size());
+
+    for (uint32_t i = 0; i < mesh.materialGroup.size(); i++)
+    {
+        const auto& group = mesh.materialGroup[i];
+
+        if (group.materialID < 0 || group.materialID >= static_cast<int32_t>(mesh.materialData.size()))
+            continue;
+
+        if (groupVisible && !groupVisible[i])
+        {
+            Profiler::get().countCulledDraws();
+            continue;
+        }
+
+        // groups come out of an unordered_map and materials without faces have no group, so index by materialID
+        const MDF::Material& material = *mesh.materialData[group.materialID];
+        const MaterialBinding& binding = gpuMesh.materialBindings[group.materialID];
+        MaterialShaders::Program& program = bindProgram(debugMaterials ? materialShaders.get(MaterialShaders::untexturedKey) : *binding.program);
+
+        uint8_t flags = material.renderFlags;
+        bool uniformLight = frameUniforms.uniformLighting;
+
+        if (flags & MDF::MDFFile::RENDER_FLAG_NOT_LIT)
+            uniformLight = true;
+
+        glUniform1i(program.uniformLight, uniformLight);
+
+        if (flags & MDF::MDFFile::RENDER_FLAG_DOUBLE)
+            glDisable(GL_CULL_FACE);
+
+        if (!debugMaterials)
+        {
+            applyBlendState(material.materialBlendType);
+
+            MDF::ColorRGBAFloat tempColor = MDF::toRGBAFloat(material.color);
+            glm::vec4 color = glm::vec4(tempColor.r, tempColor.g, tempColor.b, tempColor.a);
+            tempColor = MDF::toRGBAFloat(material.specular);
+            glm::vec4 spec = glm::vec4(tempColor.r, tempColor.g, tempColor.b, tempColor.a);
+
+            glUniform4fv(program.baseColor, 1, &color[0]);
+            glUniform4fv(program.specularColor, 1, &spec[0]);
+
+            // UV and blend types are baked into the variant, only textures and scroll speeds are left to set
+            for (uint32_t j = 0; j < material.textureCount && j < 4; j++)
+            {
+                glm::vec2 speed = glm::vec2(material.speedU[j], material.speedV[j]);
+
+                glActiveTexture(GL_TEXTURE0 + j);
+                glBindTexture(GL_TEXTURE_2D, binding.layers[j] ? binding.layers[j]->id : 0);
+                glUniform2fv(program.speed[j], 1, &speed[0]);
+            }
+
+            if (binding.gloss)
+            {
+                glActiveTexture(GL_TEXTURE0 + MaterialShaders::glossUnit);
+                glBindTexture(GL_TEXTURE_2D, binding.gloss->id);
+                glUniform1f(program.glossShininess, material.specularPower);
+            }
+        }
+        else
+        {
+            glm::vec4 color = debugColors[i % debugColors.size()];
+            glm::vec4 spec = glm::vec4(0.f);
+            glUniform4fv(program.baseColor, 1, &color[0]);
+            glUniform4fv(program.specularColor, 1, &spec[0]);
+        }
+
+        glDrawElementsInstanced(GL_TRIANGLES, group.indexCount, GL_UNSIGNED_INT, (void*)(group.indexOffset * sizeof(uint32_t)), instanceCount);
+        Profiler::get().countDrawCalls();
+
+        glEnable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+    }
+}
+
+void Renderer::renderGrid(const glm::mat4& view, const glm::mat4& projection) const
+{
+    PROFILE_PASS("Grid");
+
+    glUseProgram(gridShaderProgram);
+
+    glUniformMatrix4fv(glGetUniformLocation(gridShaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(gridShaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+
+    glBindVertexArray(gridVAO);
+    glDrawArrays(GL_LINES, 0, gridLineCount);
+    Profiler::get().countDrawCalls();
+    glBindVertexArray(0);
+}
+
+void Renderer::renderBones(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, bool showAxes, bool showOctahedrons, const glm::vec3 lightDir, bool showTPose)
+{
+    const std::vector<glm::mat4>& boneMatrices = showTPose ? mesh.skmWorldMatrices : mesh.skaWorldMatrices;
+
+    if (boneMatrices.empty())
+        return;
+
+    PROFILE_PASS("Bones");
+
+    // one upload per frame, shared by both gizmo passes
+    size_t offset = streamBuffer.write(boneMatrices.data(), boneMatrices.size() * sizeof(glm::mat4), sizeof(glm::mat4));
+
+    glBindVertexArray(boneAxesVAO);
+    setupBoneInstanceAttributes(offset);
+    glBindVertexArray(boneShapeVAO);
+    setupBoneInstanceAttributes(offset);
+    glBindVertexArray(0);
+
+    GLsizei boneCount = static_cast<GLsizei>(boneMatrices.size());
+
+    if (!showAxes && !showOctahedrons)
+    {
+        renderBoneShapes(view, projection, scaleFactor, lightDir, boneCount);
+        return;
+    }
+
+    if (showAxes)
+        renderBoneAxes(view, projection, scaleFactor, boneCount);
+
+    if (showOctahedrons)
+        renderBoneShapes(view, projection, scaleFactor, lightDir, boneCount);
+}
+
+void Renderer::renderBoneAxes(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, GLsizei boneCount)
+{
+    glUseProgram(boneAxesShaderProgram);
+
+    glUniformMatrix4fv(glGetUniformLocation(boneAxesShaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(boneAxesShaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+    glUniform1f(glGetUniformLocation(boneAxesShaderProgram, "axisLength"), 4.f * scaleFactor);
+
+    glBindVertexArray(boneAxesVAO);
+    glDrawArraysInstanced(GL_LINES, 0, Shape::Axes::vertexCount, boneCount);
+    Profiler::get().countDrawCalls();
+    glBindVertexArray(0);
+}
+
+void Renderer::renderBoneShapes(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, const glm::vec3 lightDir, GLsizei boneCount)
+{
+    glUseProgram(boneShapeShaderProgram);
+
+    glUniformMatrix4fv(glGetUniformLocation(boneShapeShaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(boneShapeShaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+    glUniform3fv(glGetUniformLocation(boneShapeShaderProgram, "lightDir"), 1, &lightDir[0]);
+    glUniform1f(glGetUniformLocation(boneShapeShaderProgram, "shapeScale"), scaleFactor * 7.5f);
+
+    glBindVertexArray(boneShapeVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, Shape::Bone::vertexCount, boneCount);
+    Profiler::get().countDrawCalls();
+    glBindVertexArray(0);
 }
 
 std::vector<glm::vec4> Renderer::generateDebugColors(size_t count)
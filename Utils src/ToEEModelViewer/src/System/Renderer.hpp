@@ -1,8 +1,15 @@
 #pragma once
 
+#include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "MaterialShaders.hpp"
+#include "Scene.hpp"
 #include "SKM_Loader.hpp"
+#include "StreamBuffer.hpp"
+
+#include <memory>
+#include <unordered_map>
 
 class Renderer
 {
@@ -10,16 +17,29 @@ public:
     void initialize();
     void shutdown();
 
+    void beginFrame();
+    void endFrame();
+
     void uploadMesh(const SKM::MeshBuffer& mesh);
     void render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, bool showTPose, float timeValue);
     void renderGrid(const glm::mat4& view, const glm::mat4& projection) const;
     void renderBones(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, bool showAxes, bool showOctahedrons, const glm::vec3 lightDir, bool showTPose);
+    void renderWireframe(const glm::mat4& view, const glm::mat4& projection, bool showTPose); // lines over the shaded model
     void clearMesh();
 
+    // opened model only: skinned with transform feedback when its pose changes, every pass then draws the cached
+    // vertices. Scene instances keep skinning in the vertex shader, each has its own pose
+    void setSkinningCache(bool enabled) { skinningCacheEnabled = enabled; }
+
+    // one GPU mesh per scene model, the scene has to stay alive until clearScene() or the next uploadScene()
+    void uploadScene(const Scene& scene);
+    void renderScene(const Scene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, bool showTPose, float timeValue);
+    void clearScene();
+
     glm::vec3 getModelCenter() const { return mesh.modelCenter; };
 
 private:
-    GLuint shaderProgram = 0;
+    MaterialShaders materialShaders;
     GLuint gridShaderProgram = 0;
     GLuint boneAxesShaderProgram = 0;
     GLuint boneShapeShaderProgram = 0;
@@ -33,15 +53,138 @@ private:
     GLuint boneShapeVAO = 0;
     GLuint boneShapeVBO = 0;
 
-    GLuint boneTBO = 0;
     GLuint boneTBOTexture = 0;
+    uint32_t boneTBOGeneration = 0; // stream buffer generation the TBO is attached to, 0 = none
+
+    StreamBuffer streamBuffer;
+
+    // one GL texture per decoded image, shared by every material using it and deleted with the last one
+    struct Texture
+    {
+        GLuint id = 0;
+        std::shared_ptr<const TGA::TGAImage> image;
+
+        ~Texture() { glDeleteTextures(1, &id); }
+    };
+
+    struct MaterialBinding
+    {
+        std::shared_ptr<Texture> layers[4];
+        std::shared_ptr<Texture> gloss;
+        MaterialShaders::Program* program = nullptr; // variant matching the layers and gloss above
+    };
+
+    // batched path: the mesh's textures packed into one array per size, materials in a texture buffer and every run of
+    // groups sharing a variant and render state submitted with one glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance; // material index, read through the instanced material attribute
+    };
+
+    // the material attribute's divisor, larger than any instance count so every instance of a command reads the
+    // material at its baseInstance
+    static constexpr GLuint materialDivisor = 1u << 30;
+
+    struct DrawBatch
+    {
+        MaterialShaders::Program* program = nullptr;
+        uint8_t materialBlendType = 0;
+        bool doubleSided = false;
+        uint32_t firstCommand = 0;
+        uint32_t commandCount = 0;
+    };
+
+    // GL objects of one uploaded mesh, MeshBuffer itself is plain CPU data from the core library
+    struct GpuMesh
+    {
+        const SKM::MeshBuffer* mesh = nullptr; // owned by the Renderer (opened SKM) or a Scene
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLuint ebo = 0;
+        std::vector<MaterialBinding> materialBindings;
+
+        bool batched = false; // went through uploadBatchedMaterials
+        std::vector<GLuint> textureArrays;
+        GLuint materialBuffer = 0;
+        GLuint materialTexture = 0;
+        GLuint materialIndexBuffer = 0;
+        GLuint indirectBuffer = 0;
+        std::vector<DrawElementsIndirectCommand> commands; // kept to patch instance counts when they change
+        std::vector<uint32_t> commandGroups;               // material group drawn by each command
+        std::vector<DrawBatch> drawBatches;
+
+        // skinning cache, created on first use
+        GLuint skinnedBuffer = 0;              // skinned position and normal per vertex
+        GLuint skinnedVao = 0;                 // vao with positions and normals taken from skinnedBuffer
+        std::vector<glm::mat4> skinnedPalette; // pose skinnedBuffer holds
+        bool skinnedValid = false;
+    };
+
+    // set once per model pass, applied to each variant the first time it is bound in that frame
+    struct FrameUniforms
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 lightDir;
+        glm::vec3 cameraPos;
+        float time;
+        bool uniformLighting;
+    };
 
     SKM::MeshBuffer mesh;
+    GpuMesh modelMesh;
+    std::vector<GpuMesh> sceneMeshes; // same order as Scene::getModels()
+    std::unordered_map<const TGA::TGAImage*, std::weak_ptr<Texture>> uploadedTextures;
 
+    // this frame's instance records followed by the bone palettes they point at, one stream buffer write per pass
+    std::vector<glm::vec4> instanceData;
+
+    // frustum culling scratch: scene instances that passed (grouped by model) with each model's range, groups that
+    // passed for the mesh being drawn
+    std::vector<uint32_t> visibleInstances;
+    std::vector<std::pair<uint32_t, uint32_t>> visibleRanges;
+    std::vector<uint8_t> visibleGroups;
+
+    bool multiDrawSupported = false;
     bool debugMaterials = false;
+    bool skinningCacheEnabled = false;
+    bool drawPreskinned = false; // current pass draws from the skinning cache
+    uint64_t frameIndex = 0;
+    FrameUniforms frameUniforms;
+    GLint drawInstanceOffset = 0;
+    const MaterialShaders::Program* currentProgram = nullptr;
+
+    void uploadMeshBuffers(GpuMesh& gpuMesh);
+    void destroyMeshBuffers(GpuMesh& gpuMesh);
+    void pruneTextures();
+    std::shared_ptr<Texture> acquireTexture(const std::shared_ptr<const TGA::TGAImage>& image);
+    bool uploadBatchedMaterials(GpuMesh& gpuMesh);
+    void buildDrawBatches(GpuMesh& gpuMesh);
+    void createSkinningCache(GpuMesh& gpuMesh);
+    bool updateSkinningCache(GpuMesh& gpuMesh, const std::vector<glm::mat4>& palette);
+    void bindBoneTexture();
+
+    void beginInstances(size_t count);
+    void setInstance(size_t index, const glm::mat4& modelMatrix, size_t paletteTexel);
+    size_t appendPalette(const std::vector<glm::mat4>& palette);
+    GLint writeInstances();
+
+    void beginModelPass(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, float timeValue);
+    const uint8_t* cullGroups(const GpuMesh& gpuMesh, const glm::mat4& modelViewProjection, const std::vector<glm::mat4>& palette);
+    uint32_t getDrawCount(const GpuMesh& gpuMesh) const;
+    void drawMesh(GpuMesh& gpuMesh, GLint instanceOffset, uint32_t instanceCount, const uint8_t* groupVisible);
+    MaterialShaders::Program& bindProgram(MaterialShaders::Program& program);
+    void applyBlendState(uint8_t materialBlendType);
+    void renderBatches(GpuMesh& gpuMesh, uint32_t instanceCount, const uint8_t* groupVisible);
+    void renderGroups(GpuMesh& gpuMesh, uint32_t instanceCount, const uint8_t* groupVisible);
 
-    void renderBoneAxes(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, bool showTPose);
-    void renderBoneShapes(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, const glm::vec3 lightDir, bool showTPose);
+    void setupBoneInstanceAttributes(size_t offset);
+    void renderBoneAxes(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, GLsizei boneCount);
+    void renderBoneShapes(const glm::mat4& view, const glm::mat4& projection, float scaleFactor, const glm::vec3 lightDir, GLsizei boneCount);
 
     std::vector<glm::vec4> generateDebugColors(size_t count);
 };
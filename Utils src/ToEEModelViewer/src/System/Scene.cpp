@@ -0,0 +1,98 @@
+#include "Logger.hpp"
+#include "MapTileRenderer.hpp"
+#include "Scene.hpp"
+
+#include <cfloat>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+
+namespace
+{
+    constexpr uint32_t failedModel = UINT32_MAX;
+}
+
+bool Scene::loadFromFile(const std::string& scenePath)
+{
+    clear();
+
+    MapTileRenderer::Scene description;
+
+    if (!MapTileRenderer::loadScene(scenePath, description))
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // every distinct SKM is loaded once, placements are collected per model so instances end up grouped
+    std::unordered_map<std::string, uint32_t> modelIndices;
+    std::vector<std::vector<glm::mat4>> transforms;
+    uint32_t failed = 0;
+    glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
+
+    for (const auto& placement : description.placements)
+    {
+        std::string modelPath = (std::filesystem::path(description.dataPath) / placement.path).generic_string();
+        auto it = modelIndices.find(modelPath);
+
+        if (it == modelIndices.end())
+        {
+            auto model = std::make_unique<Model>();
+            uint32_t index = failedModel;
+
+            if (MapTileRenderer::loadMesh(modelPath, model->mesh))
+            {
+                model->path = modelPath;
+                index = static_cast<uint32_t>(models.size());
+                models.push_back(std::move(model));
+                transforms.emplace_back();
+            }
+
+            it = modelIndices.emplace(modelPath, index).first;
+        }
+
+        if (it->second == failedModel)
+        {
+            failed++;
+            continue;
+        }
+
+        transforms[it->second].push_back(MapTileRenderer::getPlacementMatrix(placement));
+        minPos = glm::min(minPos, placement.position);
+        maxPos = glm::max(maxPos, placement.position);
+    }
+
+    for (uint32_t i = 0; i < models.size(); i++)
+    {
+        Model& model = *models[i];
+        model.firstInstance = static_cast<uint32_t>(instances.size());
+        model.instanceCount = static_cast<uint32_t>(transforms[i].size());
+
+        for (const glm::mat4& transform : transforms[i])
+        {
+            Instance instance;
+            instance.model = i;
+            instance.transform = transform;
+            instance.palette = model.mesh.skinningMatrix;
+
+            instances.push_back(std::move(instance));
+        }
+    }
+
+    if (!instances.empty())
+        center = (minPos + maxPos) * .5f;
+
+    path = scenePath;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO << "Scene " << scenePath << ": " << models.size() << " models, " << instances.size() << " instances (" << failed << " failed placements) in " << seconds << " s";
+
+    return !instances.empty();
+}
+
+void Scene::clear()
+{
+    path.clear();
+    center = glm::vec3(0.f);
+    models.clear();
+    instances.clear();
+}
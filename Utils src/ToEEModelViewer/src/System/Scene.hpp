@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "SKM_Loader.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Many models at once, read from a map scene file (see README). Every distinct SKM is loaded once and shared by all
+// of its placements, Renderer::uploadScene uploads it once as well and draws all of its instances together.
+class Scene
+{
+public:
+    struct Model
+    {
+        std::string path;
+        SKM::MeshBuffer mesh;
+        uint32_t firstInstance = 0;
+        uint32_t instanceCount = 0;
+    };
+
+    struct Instance
+    {
+        uint32_t model = 0;
+        glm::mat4 transform = glm::mat4(1.f); // placement, the mesh's own model matrix is applied after it
+        std::vector<glm::mat4> palette;       // skinning matrices, starts as the model's pose
+    };
+
+    bool loadFromFile(const std::string& path);
+    void clear();
+
+    bool isLoaded() const { return !instances.empty(); }
+    const std::string& getPath() const { return path; }
+    glm::vec3 getCenter() const { return center; }
+
+    const std::vector<std::unique_ptr<Model>>& getModels() const { return models; }
+
+    // grouped by model, Model::firstInstance and instanceCount index into it
+    std::vector<Instance>& getInstances() { return instances; }
+    const std::vector<Instance>& getInstances() const { return instances; }
+
+private:
+    std::string path;
+    glm::vec3 center = glm::vec3(0.f);
+
+    // unique_ptr keeps meshes in place, uploaded GPU meshes point at them
+    std::vector<std::unique_ptr<Model>> models;
+    std::vector<Instance> instances;
+};
@@ -0,0 +1,484 @@
+#include "Skinning.hpp"
+#include "SoftwareRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr size_t vertexChunkSize = 2048;
+
+    glm::vec4 sampleTexture(const TGA::TGAImage* image, glm::vec2 uv)
+    {
+        if (!image || !image->width || !image->height)
+            return glm::vec4(1.f);
+
+        // bilinear + GL_REPEAT, texel centers like GL, row 0 is the first row uploaded
+        float x = uv.x * image->width - .5f;
+        float y = uv.y * image->height - .5f;
+        float fx = std::floor(x);
+        float fy = std::floor(y);
+        float tx = x - fx;
+        float ty = y - fy;
+
+        auto wrap = [](int value, int size) { int r = value % size; return r < 0 ? r + size : r; };
+
+        int x0 = wrap(static_cast<int>(fx), image->width);
+        int y0 = wrap(static_cast<int>(fy), image->height);
+        int x1 = wrap(x0 + 1, image->width);
+        int y1 = wrap(y0 + 1, image->height);
+
+        auto texel = [&](int px, int py)
+        {
+            const uint8_t* p = &image->pixels[(static_cast<size_t>(py) * image->width + px) * 4];
+            return glm::vec4(p[0], p[1], p[2], p[3]);
+        };
+
+        glm::vec4 top = texel(x0, y0) * (1.f - tx) + texel(x1, y0) * tx;
+        glm::vec4 bottom = texel(x0, y1) * (1.f - tx) + texel(x1, y1) * tx;
+
+        return (top * (1.f - ty) + bottom * ty) * (1.f / 255.f);
+    }
+
+    glm::vec2 getUV(uint8_t uvType, glm::vec2 baseUV, const glm::vec3& worldPos, const glm::vec3& normal, const glm::vec3& cameraPos, glm::vec2 speed, float time)
+    {
+        switch (uvType)
+        {
+            case MDF::MDFFile::UV_TYPE_ENVIRONMENT:
+            {
+                glm::vec3 incident = glm::normalize(worldPos - cameraPos);
+                glm::vec3 n = glm::normalize(normal);
+                glm::vec3 r = incident - 2.f * glm::dot(n, incident) * n;
+                float m = std::sqrt(r.x * r.x + r.y * r.y + (r.z + 1.f) * (r.z + 1.f));
+
+                return .5f * (glm::vec2(r.x, r.y) / m + 1.f);
+            }
+            case MDF::MDFFile::UV_TYPE_DRIFT:
+                return baseUV + speed * time;
+            case MDF::MDFFile::UV_TYPE_SWIRL:
+            {
+                glm::vec2 uv = baseUV - glm::vec2(.5f);
+                float swirlSpeed = (speed.x == 0.f && speed.y == 0.f) ? 60.f : speed.x;
+                float angle = time * swirlSpeed * .0475f;
+                float s = std::sin(angle);
+                float c = std::cos(angle);
+
+                return glm::vec2(uv.x * c - uv.y * s, uv.x * s + uv.y * c) + glm::vec2(.5f);
+            }
+            case MDF::MDFFile::UV_TYPE_WAVEY:
+            {
+                glm::vec2 uv = baseUV;
+                uv.y += std::sin((uv.x + time * speed.x) * 10.f) * .02f;
+                uv.x += std::sin((uv.y + time * speed.y) * 10.f) * .02f;
+
+                return uv;
+            }
+            default:
+                return baseUV;
+        }
+    }
+
+    glm::vec4 blendLayer(const glm::vec4& base, const glm::vec4& tex, uint8_t blendType)
+    {
+        glm::vec3 baseRGB(base);
+        glm::vec3 texRGB(tex);
+
+        switch (blendType)
+        {
+            case MDF::MDFFile::BLEND_TYPE_MODULATE:
+                return glm::vec4(baseRGB * texRGB, base.a * tex.a);
+            case MDF::MDFFile::BLEND_TYPE_ADD:
+                return glm::vec4(baseRGB + texRGB, base.a * tex.a);
+            case MDF::MDFFile::BLEND_TYPE_TEXTURE_ALPHA:
+                return glm::vec4(texRGB * tex.a + baseRGB * (1.f - tex.a), base.a);
+            case MDF::MDFFile::BLEND_TYPE_CURRENT_ALPHA:
+                return glm::vec4(texRGB * base.a + baseRGB * (1.f - base.a), tex.a);
+            case MDF::MDFFile::BLEND_TYPE_CURRENT_ALPHA_ADD:
+                return glm::vec4(baseRGB + texRGB * tex.a, tex.a);
+            default:
+                return base;
+        }
+    }
+
+    glm::vec4 saturate(const glm::vec4& color)
+    {
+        return glm::clamp(color, glm::vec4(0.f), glm::vec4(1.f));
+    }
+
+    // fill convention so pixels on shared edges are drawn exactly once
+    bool isTopLeft(float ax, float ay, float bx, float by)
+    {
+        return (ay == by && bx < ax) || (by < ay);
+    }
+}
+
+void SoftwareRenderer::initialize(uint32_t targetWidth, uint32_t targetHeight, uint32_t threadCount)
+{
+    width = targetWidth;
+    height = targetHeight;
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+
+    colorBuffer.assign(static_cast<size_t>(width) * height, glm::vec4(0.f));
+    depthBuffer.assign(static_cast<size_t>(width) * height, 1.f);
+    tileBins.assign(static_cast<size_t>(tilesX) * tilesY, {});
+
+    pool = std::make_unique<ThreadPool>(threadCount);
+}
+
+void SoftwareRenderer::shutdown()
+{
+    clearMesh();
+    pool.reset();
+
+    colorBuffer.clear();
+    depthBuffer.clear();
+    tileBins.clear();
+}
+
+void SoftwareRenderer::uploadMesh(const SKM::MeshBuffer& inputMesh)
+{
+    clearMesh();
+    ownedMesh = inputMesh;
+    bindMesh(ownedMesh);
+}
+
+void SoftwareRenderer::bindMesh(const SKM::MeshBuffer& mesh)
+{
+    activeMesh = &mesh;
+    modelMatrix = mesh.modelMatrix;
+
+    // resolve texture pointers once, the images are owned by the shared materials the mesh holds
+    materialTextures.assign(mesh.materialData.size(), MaterialTextures());
+
+    for (size_t i = 0; i < mesh.materialData.size(); i++)
+    {
+        const MDF::Material& material = *mesh.materialData[i];
+
+        for (uint32_t j = 0; j < material.textureCount && j < 4; j++)
+            materialTextures[i].layers[j] = material.textures[j].get();
+
+        materialTextures[i].gloss = material.gloss.get();
+    }
+}
+
+void SoftwareRenderer::clearMesh()
+{
+    activeMesh = nullptr;
+    ownedMesh = SKM::MeshBuffer();
+    modelMatrix = glm::mat4(1.f);
+    materialTextures.clear();
+    skinnedPositions.clear();
+    skinnedNormals.clear();
+    shadedVertices.clear();
+    triangles.clear();
+}
+
+void SoftwareRenderer::clear(const glm::vec4& color)
+{
+    std::fill(colorBuffer.begin(), colorBuffer.end(), color);
+    std::fill(depthBuffer.begin(), depthBuffer.end(), 1.f);
+}
+
+void SoftwareRenderer::render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, bool showTPose, float timeValue)
+{
+    if (!activeMesh || activeMesh->vertices.empty() || !width || !height)
+        return;
+
+    const SKM::MeshBuffer& mesh = *activeMesh;
+    const std::vector<glm::mat4>& boneMats = showTPose ? mesh.tPoseSkinningMatrix : mesh.skinningMatrix;
+
+    // nothing to skin or bin when the whole mesh is off screen
+    if (!Frustum(projection * view * modelMatrix).intersects(mesh.bounds.pose(boneMats)))
+        return;
+
+    transformVertices(projection * view, boneMats);
+    setupTriangles();
+
+    FrameParams params = { lightDir, cameraPos, uniformLighting, timeValue };
+
+    pool->parallelFor(tileBins.size(), [&](size_t tile) { rasterizeTile(static_cast<uint32_t>(tile), params); });
+}
+
+void SoftwareRenderer::readPixels(std::vector<uint8_t>& out) const
+{
+    out.resize(colorBuffer.size() * 4);
+
+    for (size_t i = 0; i < colorBuffer.size(); i++)
+    {
+        glm::vec4 c = saturate(colorBuffer[i]) * 255.f + .5f;
+
+        out[i * 4 + 0] = static_cast<uint8_t>(c.r);
+        out[i * 4 + 1] = static_cast<uint8_t>(c.g);
+        out[i * 4 + 2] = static_cast<uint8_t>(c.b);
+        out[i * 4 + 3] = static_cast<uint8_t>(c.a);
+    }
+}
+
+void SoftwareRenderer::transformVertices(const glm::mat4& viewProjection, const std::vector<glm::mat4>& boneMatrices)
+{
+    const SKM::MeshBuffer& mesh = *activeMesh;
+    const size_t vertexCount = mesh.vertices.size();
+    const glm::mat4 model = modelMatrix;
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+    shadedVertices.resize(vertexCount);
+    skinnedPositions.resize(vertexCount);
+    skinnedNormals.resize(vertexCount);
+
+    const size_t chunkCount = (vertexCount + vertexChunkSize - 1) / vertexChunkSize;
+
+    pool->parallelFor(chunkCount, [&](size_t chunk)
+    {
+        size_t begin = chunk * vertexChunkSize;
+        size_t end = std::min(begin + vertexChunkSize, vertexCount);
+
+        // same as the vertex shader, out of range bones contribute nothing
+        Skinning::skin(mesh.vertices.data() + begin, end - begin, boneMatrices, skinnedPositions.data() + begin, skinnedNormals.data() + begin);
+
+        for (size_t i = begin; i < end; i++)
+        {
+            const SKM::GPUVertex& in = mesh.vertices[i];
+            const glm::vec3& skinnedPos = skinnedPositions[i];
+            const glm::vec3& skinnedNormal = skinnedNormals[i];
+
+            ShadedVertex& out = shadedVertices[i];
+            out.worldPos = glm::vec3(model * glm::vec4(skinnedPos, 1.f));
+            out.normal = normalMatrix * skinnedNormal;
+            out.uv = in.uv;
+            out.clipPos = viewProjection * glm::vec4(out.worldPos, 1.f);
+        }
+    });
+}
+
+void SoftwareRenderer::setupTriangles()
+{
+    const SKM::MeshBuffer& mesh = *activeMesh;
+
+    triangles.clear();
+
+    for (auto& bin : tileBins)
+        bin.clear();
+
+    // submission order is kept per bin, blended groups composite the same way as the GL draw loop
+    for (uint32_t g = 0; g < mesh.materialGroup.size(); g++)
+    {
+        const auto& group = mesh.materialGroup[g];
+
+        if (group.materialID < 0 || group.materialID >= static_cast<int32_t>(mesh.materialData.size()))
+            continue;
+
+        bool doubleSided = mesh.materialData[group.materialID]->renderFlags & MDF::MDFFile::RENDER_FLAG_DOUBLE;
+
+        for (size_t t = 0; t + 2 < group.indexCount; t += 3)
+        {
+            TriangleSetup tri;
+            tri.group = g;
+            bool behindCamera = false;
+
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t index = mesh.indices[group.indexOffset + t + k];
+
+                if (index >= shadedVertices.size())
+                {
+                    behindCamera = true;
+                    break;
+                }
+
+                const glm::vec4& clip = shadedVertices[index].clipPos;
+
+                if (clip.w <= 1e-6f)
+                {
+                    behindCamera = true;
+                    break;
+                }
+
+                float invW = 1.f / clip.w;
+
+                tri.vertex[k] = index;
+                tri.invW[k] = invW;
+                tri.x[k] = (clip.x * invW * .5f + .5f) * width;
+                tri.y[k] = (.5f - clip.y * invW * .5f) * height;
+                tri.z[k] = clip.z * invW * .5f + .5f;
+            }
+
+            if (behindCamera)
+                continue;
+
+            // y is flipped on the way to the framebuffer, so GL's counter-clockwise front faces are clockwise here
+            float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+
+            if (area == 0.f || (area > 0.f && !doubleSided))
+                continue;
+
+            if (area > 0.f)
+            {
+                std::swap(tri.vertex[1], tri.vertex[2]);
+                std::swap(tri.x[1], tri.x[2]);
+                std::swap(tri.y[1], tri.y[2]);
+                std::swap(tri.z[1], tri.z[2]);
+                std::swap(tri.invW[1], tri.invW[2]);
+                area = -area;
+            }
+
+            tri.invArea = 1.f / area;
+
+            tri.minX = std::max(0, static_cast<int>(std::floor(std::min({ tri.x[0], tri.x[1], tri.x[2] }))));
+            tri.minY = std::max(0, static_cast<int>(std::floor(std::min({ tri.y[0], tri.y[1], tri.y[2] }))));
+            tri.maxX = std::min(static_cast<int>(width) - 1, static_cast<int>(std::ceil(std::max({ tri.x[0], tri.x[1], tri.x[2] }))));
+            tri.maxY = std::min(static_cast<int>(height) - 1, static_cast<int>(std::ceil(std::max({ tri.y[0], tri.y[1], tri.y[2] }))));
+
+            if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+                continue;
+
+            uint32_t triangleIndex = static_cast<uint32_t>(triangles.size());
+            triangles.push_back(tri);
+
+            for (int ty = tri.minY / static_cast<int>(tileSize); ty <= tri.maxY / static_cast<int>(tileSize); ty++)
+            {
+                for (int tx = tri.minX / static_cast<int>(tileSize); tx <= tri.maxX / static_cast<int>(tileSize); tx++)
+                    tileBins[ty * tilesX + tx].push_back(triangleIndex);
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::rasterizeTile(uint32_t tileIndex, const FrameParams& params)
+{
+    const SKM::MeshBuffer& mesh = *activeMesh;
+    const int tileX0 = static_cast<int>((tileIndex % tilesX) * tileSize);
+    const int tileY0 = static_cast<int>((tileIndex / tilesX) * tileSize);
+    const int tileX1 = std::min(tileX0 + static_cast<int>(tileSize), static_cast<int>(width)) - 1;
+    const int tileY1 = std::min(tileY0 + static_cast<int>(tileSize), static_cast<int>(height)) - 1;
+
+    for (uint32_t triangleIndex : tileBins[tileIndex])
+    {
+        const TriangleSetup& tri = triangles[triangleIndex];
+        const auto& group = mesh.materialGroup[tri.group];
+        const MDF::MDFFile& material = *mesh.materialData[group.materialID];
+        const uint8_t blendMode = material.materialBlendType;
+        const bool depthWrite = blendMode != MDF::MDFFile::MATERIAL_BLEND_TYPE_ALPHA_ADD;
+
+        const ShadedVertex& v0 = shadedVertices[tri.vertex[0]];
+        const ShadedVertex& v1 = shadedVertices[tri.vertex[1]];
+        const ShadedVertex& v2 = shadedVertices[tri.vertex[2]];
+
+        // edge k is opposite vertex k
+        const float bias0 = isTopLeft(tri.x[1], tri.y[1], tri.x[2], tri.y[2]) ? 0.f : -1e-7f;
+        const float bias1 = isTopLeft(tri.x[2], tri.y[2], tri.x[0], tri.y[0]) ? 0.f : -1e-7f;
+        const float bias2 = isTopLeft(tri.x[0], tri.y[0], tri.x[1], tri.y[1]) ? 0.f : -1e-7f;
+
+        const int minX = std::max(tri.minX, tileX0);
+        const int minY = std::max(tri.minY, tileY0);
+        const int maxX = std::min(tri.maxX, tileX1);
+        const int maxY = std::min(tri.maxY, tileY1);
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            const float py = y + .5f;
+
+            for (int x = minX; x <= maxX; x++)
+            {
+                const float px = x + .5f;
+
+                // clockwise in screen space after setup, so inside means all edge functions <= 0
+                float w0 = (tri.x[2] - tri.x[1]) * (py - tri.y[1]) - (tri.y[2] - tri.y[1]) * (px - tri.x[1]);
+                float w1 = (tri.x[0] - tri.x[2]) * (py - tri.y[2]) - (tri.y[0] - tri.y[2]) * (px - tri.x[2]);
+                float w2 = (tri.x[1] - tri.x[0]) * (py - tri.y[0]) - (tri.y[1] - tri.y[0]) * (px - tri.x[0]);
+
+                if (w0 > bias0 || w1 > bias1 || w2 > bias2)
+                    continue;
+
+                float b0 = w0 * tri.invArea;
+                float b1 = w1 * tri.invArea;
+                float b2 = w2 * tri.invArea;
+
+                float z = b0 * tri.z[0] + b1 * tri.z[1] + b2 * tri.z[2];
+
+                if (z < 0.f || z > 1.f)
+                    continue;
+
+                size_t pixel = static_cast<size_t>(y) * width + x;
+
+                if (z >= depthBuffer[pixel])
+                    continue;
+
+                // perspective correct weights
+                float p0 = b0 * tri.invW[0];
+                float p1 = b1 * tri.invW[1];
+                float p2 = b2 * tri.invW[2];
+                float invSum = 1.f / (p0 + p1 + p2);
+                p0 *= invSum;
+                p1 *= invSum;
+                p2 *= invSum;
+
+                glm::vec3 worldPos = v0.worldPos * p0 + v1.worldPos * p1 + v2.worldPos * p2;
+                glm::vec3 normal = v0.normal * p0 + v1.normal * p1 + v2.normal * p2;
+                glm::vec2 uv = v0.uv * p0 + v1.uv * p1 + v2.uv * p2;
+
+                glm::vec4 src = saturate(shadeFragment(group.materialID, worldPos, normal, uv, params));
+                glm::vec4& dst = colorBuffer[pixel];
+
+                switch (blendMode)
+                {
+                    case MDF::MDFFile::MATERIAL_BLEND_TYPE_NONE:
+                        dst = src;
+                        break;
+                    case MDF::MDFFile::MATERIAL_BLEND_TYPE_ALPHA:
+                        dst = saturate(src * src.a + dst * (1.f - src.a));
+                        break;
+                    case MDF::MDFFile::MATERIAL_BLEND_TYPE_ADD:
+                        dst = saturate(src + dst);
+                        break;
+                    case MDF::MDFFile::MATERIAL_BLEND_TYPE_ALPHA_ADD:
+                        dst = saturate(src * src.a + dst);
+                        break;
+                }
+
+                if (depthWrite)
+                    depthBuffer[pixel] = z;
+            }
+        }
+    }
+}
+
+glm::vec4 SoftwareRenderer::shadeFragment(uint32_t materialIndex, const glm::vec3& worldPos, const glm::vec3& normal, const glm::vec2& uv, const FrameParams& params) const
+{
+    const MDF::MDFFile& material = *activeMesh->materialData[materialIndex];
+    const MaterialTextures& textures = materialTextures[materialIndex];
+
+    bool uniformLight = params.uniformLighting || (material.renderFlags & MDF::MDFFile::RENDER_FLAG_NOT_LIT);
+    glm::vec3 n = glm::normalize(normal);
+
+    float diff = uniformLight ? 1.f : std::max(glm::dot(n, -params.lightDir), 0.f);
+
+    // specular, same as calculateSpecular in the model shader
+    bool hasGloss = textures.gloss != nullptr;
+    float shininess = hasGloss ? material.specularPower : 2.f;
+    glm::vec3 viewDir = glm::normalize(params.cameraPos - worldPos);
+    glm::vec3 halfDir = glm::normalize(viewDir + params.lightDir);
+    float specIntensity = std::pow(std::max(glm::dot(n, halfDir), 0.f), shininess);
+
+    glm::vec3 specular;
+    if (hasGloss)
+        specular = glm::vec3(sampleTexture(textures.gloss, uv)) * specIntensity;
+    else
+    {
+        MDF::ColorRGBAFloat spec = MDF::toRGBAFloat(material.specular);
+        specular = glm::vec3(spec.r, spec.g, spec.b) * specIntensity;
+    }
+
+    MDF::ColorRGBAFloat base = MDF::toRGBAFloat(material.color);
+    glm::vec4 color(base.r * diff, base.g * diff, base.b * diff, base.a);
+
+    for (uint32_t i = 0; i < material.textureCount && i < 4; i++)
+    {
+        glm::vec2 speed(material.speedU[i], material.speedV[i]);
+        glm::vec2 layerUV = getUV(material.uvType[i], uv, worldPos, normal, params.cameraPos, speed, params.time);
+
+        color = blendLayer(color, sampleTexture(textures.layers[i], layerUV), material.blendType[i]);
+    }
+
+    return glm::vec4(glm::vec3(color) + specular, color.a);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "SKM_Loader.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+// CPU counterpart of Renderer's model pass for machines without a GPU.
+// Same entry points and shading math as the GL path, rendered into an in-memory RGBA framebuffer.
+// Vertices are skinned in parallel chunks, triangles are binned into screen tiles and tiles are rasterized in parallel.
+class SoftwareRenderer
+{
+public:
+    void initialize(uint32_t targetWidth, uint32_t targetHeight, uint32_t threadCount = 0);
+    void shutdown();
+
+    void uploadMesh(const SKM::MeshBuffer& mesh);
+    void clearMesh();
+
+    // renders a mesh owned by the caller without copying it, it has to outlive the render calls
+    void bindMesh(const SKM::MeshBuffer& mesh);
+    void setModelMatrix(const glm::mat4& matrix) { modelMatrix = matrix; }
+
+    void clear(const glm::vec4& color);
+    void render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir, const glm::vec3& cameraPos, bool uniformLighting, bool showTPose, float timeValue);
+
+    // RGBA8, top row first
+    void readPixels(std::vector<uint8_t>& out) const;
+
+    glm::vec3 getModelCenter() const { return activeMesh ? activeMesh->modelCenter : glm::vec3(0.f); };
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+    uint32_t getThreadCount() const { return pool ? pool->getThreadCount() : 0; }
+
+private:
+    static constexpr uint32_t tileSize = 32;
+
+    struct ShadedVertex
+    {
+        glm::vec4 clipPos;
+        glm::vec3 worldPos;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+
+    struct TriangleSetup
+    {
+        uint32_t vertex[3];
+        uint32_t group;
+        float x[3];
+        float y[3];
+        float z[3];
+        float invW[3];
+        float invArea;
+        int minX, minY, maxX, maxY;
+    };
+
+    struct MaterialTextures
+    {
+        const TGA::TGAImage* layers[4] = { nullptr };
+        const TGA::TGAImage* gloss = nullptr;
+    };
+
+    struct FrameParams
+    {
+        glm::vec3 lightDir;
+        glm::vec3 cameraPos;
+        bool uniformLighting;
+        float time;
+    };
+
+    SKM::MeshBuffer ownedMesh;
+    const SKM::MeshBuffer* activeMesh = nullptr;
+    glm::mat4 modelMatrix = glm::mat4(1.f);
+    std::vector<MaterialTextures> materialTextures;
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+
+    std::vector<glm::vec4> colorBuffer;
+    std::vector<float> depthBuffer;
+
+    std::vector<glm::vec3> skinnedPositions; // mesh space, Skinning::skin output
+    std::vector<glm::vec3> skinnedNormals;
+    std::vector<ShadedVertex> shadedVertices;
+    std::vector<TriangleSetup> triangles;
+    std::vector<std::vector<uint32_t>> tileBins;
+
+    std::unique_ptr<ThreadPool> pool;
+
+    void transformVertices(const glm::mat4& viewProjection, const std::vector<glm::mat4>& boneMatrices);
+    void setupTriangles();
+    void rasterizeTile(uint32_t tileIndex, const FrameParams& params);
+    glm::vec4 shadeFragment(uint32_t materialIndex, const glm::vec3& worldPos, const glm::vec3& normal, const glm::vec2& uv, const FrameParams& params) const;
+};
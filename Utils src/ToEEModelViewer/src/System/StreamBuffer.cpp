@@ -0,0 +1,160 @@
+#include "Logger.hpp"
+#include "Profiler.hpp"
+#include "StreamBuffer.hpp"
+
+#include <cstring>
+
+void StreamBuffer::create(size_t initialRegionSize)
+{
+    persistent = GLAD_GL_ARB_buffer_storage != 0;
+
+    allocate(initialRegionSize);
+
+    LOG_INFO << "Stream buffer: " << (persistent ? "persistent mapped" : "orphaning") << ", " << regionCount << " x " << regionSize << " bytes";
+}
+
+void StreamBuffer::destroy()
+{
+    release();
+    regionSize = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+    cursor = 0;
+
+    if (persistent)
+    {
+        region = (region + 1) % regionCount;
+        waitForRegion(region);
+    }
+    else
+    {
+        // orphan, driver hands out fresh storage while the GPU keeps reading the old one
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void StreamBuffer::endFrame()
+{
+    if (!persistent)
+        return;
+
+    if (fences[region])
+        glDeleteSync(fences[region]);
+
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t StreamBuffer::write(const void* data, size_t size, size_t alignment)
+{
+    size_t offset = (cursor + alignment - 1) / alignment * alignment;
+
+    if (offset + size > regionSize)
+    {
+        // draws already issued keep the old buffer alive, so it's safe to swap it mid-frame
+        size_t newRegionSize = regionSize;
+        while (newRegionSize < size + alignment)
+            newRegionSize *= 2;
+
+        release();
+        allocate(newRegionSize);
+        offset = 0;
+    }
+
+    size_t bufferOffset = (persistent ? region * regionSize : 0) + offset;
+
+    if (!size)
+        return bufferOffset;
+
+    if (persistent)
+    {
+        memcpy(mappedPtr + bufferOffset, data, size);
+    }
+    else
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, bufferOffset, size, data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    cursor = offset + size;
+    Profiler::get().countUploadBytes(size);
+
+    return bufferOffset;
+}
+
+void StreamBuffer::allocate(size_t newRegionSize)
+{
+    regionSize = newRegionSize;
+    cursor = 0;
+    region = 0;
+    generation++;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    if (persistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glBufferStorage(GL_ARRAY_BUFFER, regionSize * regionCount, nullptr, flags);
+        mappedPtr = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * regionCount, flags));
+
+        if (!mappedPtr)
+        {
+            LOG_WARN << "Persistent mapping failed, falling back to buffer orphaning.";
+
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            persistent = false;
+        }
+    }
+
+    if (!persistent)
+        glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StreamBuffer::release()
+{
+    for (auto& fence : fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+
+        fence = nullptr;
+    }
+
+    if (mappedPtr)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mappedPtr = nullptr;
+    }
+
+    if (buffer)
+        glDeleteBuffers(1, &buffer);
+
+    buffer = 0;
+}
+
+void StreamBuffer::waitForRegion(uint32_t index)
+{
+    if (!fences[index])
+        return;
+
+    GLenum result = glClientWaitSync(fences[index], 0, 0);
+
+    // only flush and block if the GPU is really still using this region
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+
+    glDeleteSync(fences[index]);
+    fences[index] = nullptr;
+}
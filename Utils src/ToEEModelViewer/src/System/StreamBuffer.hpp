@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// Ring of per-frame regions for data that is rewritten every frame (bone matrices, gizmo instances).
+// Uses a persistently mapped buffer (ARB_buffer_storage) with a fence per region where available,
+// falls back to orphaning the whole buffer at the start of every frame otherwise.
+class StreamBuffer
+{
+public:
+    static constexpr uint32_t regionCount = 3;
+
+    void create(size_t initialRegionSize);
+    void destroy();
+
+    void beginFrame();
+    void endFrame();
+
+    // copies data into the current frame's region, returns byte offset into getBuffer()
+    size_t write(const void* data, size_t size, size_t alignment);
+
+    GLuint getBuffer() const { return buffer; }
+
+    // bumped on every reallocation; GL may hand the freed name straight back, so compare this instead of getBuffer()
+    uint32_t getGeneration() const { return generation; }
+    bool isPersistent() const { return persistent; }
+
+private:
+    GLuint buffer = 0;
+    uint8_t* mappedPtr = nullptr;
+    size_t regionSize = 0;
+    size_t cursor = 0;
+    uint32_t region = 0;
+    uint32_t generation = 0;
+    GLsync fences[regionCount] = { nullptr };
+    bool persistent = false;
+
+    void allocate(size_t newRegionSize);
+    void release();
+    void waitForRegion(uint32_t index);
+};
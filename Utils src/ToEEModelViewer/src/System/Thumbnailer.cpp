@@ -0,0 +1,286 @@
+#include "Camera.hpp"
+#include "HeadlessContext.hpp"
+#include "Logger.hpp"
+#include "PNG_Writer.hpp"
+#include "Renderer.hpp"
+#include "SKM_Loader.hpp"
+#include "SoftwareRenderer.hpp"
+#include "Thumbnailer.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace Thumbnailer
+{
+    struct RenderTarget
+    {
+        GLuint fbo = 0;
+        GLuint color = 0;
+        GLuint depth = 0;
+        int size = 0;
+
+        bool create(int targetSize)
+        {
+            size = targetSize;
+
+            glGenFramebuffers(1, &fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+            glGenRenderbuffers(1, &color);
+            glBindRenderbuffer(GL_RENDERBUFFER, color);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+
+            glGenRenderbuffers(1, &depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, depth);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+            return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        }
+
+        void destroy()
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            if (fbo)
+                glDeleteFramebuffers(1, &fbo);
+
+            if (color)
+                glDeleteRenderbuffers(1, &color);
+
+            if (depth)
+                glDeleteRenderbuffers(1, &depth);
+
+            fbo = color = depth = 0;
+        }
+    };
+
+    static bool isSKM(const std::filesystem::path& path)
+    {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        return ext == ".skm";
+    }
+
+    static std::vector<std::filesystem::path> collectModels(const std::filesystem::path& inputPath)
+    {
+        std::vector<std::filesystem::path> models;
+
+        if (std::filesystem::is_regular_file(inputPath))
+        {
+            models.push_back(inputPath);
+            return models;
+        }
+
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(inputPath, ec))
+        {
+            if (entry.is_regular_file() && isSKM(entry.path()))
+                models.push_back(entry.path());
+        }
+
+        std::sort(models.begin(), models.end());
+
+        return models;
+    }
+
+    static void frameModel(const SKM::SKMFile& skm, Camera& camera)
+    {
+        glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
+
+        for (const auto& vertex : skm.vertices)
+        {
+            glm::vec3 pos(vertex.vertexPosition.x, vertex.vertexPosition.y, vertex.vertexPosition.z);
+            minPos = glm::min(minPos, pos);
+            maxPos = glm::max(maxPos, pos);
+        }
+
+        if (skm.vertices.empty())
+            minPos = maxPos = glm::vec3(0.f);
+
+        glm::vec3 center = (minPos + maxPos) * .5f;
+        float radius = glm::length(maxPos - center);
+
+        camera.reset();
+        camera.setEulerAngles(30.f, -20.f);
+        camera.setTarget(center);
+        camera.setDistance(std::max(radius * 1.05f, 1.f));
+    }
+
+    int run(const Options& options)
+    {
+        std::filesystem::path inputPath = options.inputPath;
+        std::filesystem::path outputPath = options.outputPath;
+        std::vector<std::filesystem::path> models = collectModels(inputPath);
+
+        if (models.empty())
+        {
+            std::cerr << "No SKM files found in " << options.inputPath << "\n";
+            return -1;
+        }
+
+        HeadlessContext context;
+        RenderTarget target;
+        Renderer renderer;
+        SoftwareRenderer softwareRenderer;
+
+        if (options.software)
+        {
+            softwareRenderer.initialize(options.size, options.size);
+
+            std::cout << "Software rasterizer, " << softwareRenderer.getThreadCount() << " threads\n";
+        }
+        else
+        {
+            if (!context.create())
+            {
+                std::cerr << "Failed to create offscreen GL context\n";
+                return -1;
+            }
+
+            std::cout << "Headless context: " << context.getBackendName() << ", " << glGetString(GL_RENDERER) << "\n";
+
+            if (!target.create(options.size))
+            {
+                std::cerr << "Failed to create offscreen framebuffer\n";
+                target.destroy();
+                context.destroy();
+                return -1;
+            }
+
+            renderer.initialize();
+            glEnable(GL_DEPTH_TEST);
+        }
+
+        Camera camera;
+        std::vector<uint8_t> pixels(static_cast<size_t>(options.size) * options.size * 4);
+
+        // same default light as the viewer
+        float lightYawRad = glm::radians(35.f);
+        float lightPitchRad = glm::radians(35.f);
+        glm::vec3 lightDir = glm::normalize(-glm::vec3(
+            cos(lightPitchRad) * sin(lightYawRad),
+            sin(lightPitchRad),
+            cos(lightPitchRad) * cos(lightYawRad)
+        ));
+
+        uint32_t written = 0;
+        uint32_t failed = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (const auto& modelPath : models)
+        {
+            std::string path = modelPath.generic_string();
+            SKM::SKMFile skm;
+            SKM::MeshBuffer mesh;
+
+            if (!skm.loadFromFile(path))
+            {
+                failed++;
+                continue;
+            }
+
+            try
+            {
+                mesh = skm.toMesh();
+            }
+            catch (const std::exception& e)
+            {
+                LOG_ERROR << e.what();
+                failed++;
+                continue;
+            }
+
+            frameModel(skm, camera);
+
+            float distance = camera.getDistance();
+            glm::mat4 proj = glm::ortho(-distance, distance, -distance, distance, .1f, 10000.f);
+
+            if (options.software)
+            {
+                softwareRenderer.uploadMesh(mesh);
+                softwareRenderer.clear(glm::vec4(0.f));
+                softwareRenderer.render(camera.getViewMatrix(), proj, lightDir, camera.getPosition(), false, false, 0.f);
+                softwareRenderer.readPixels(pixels);
+            }
+            else
+            {
+                renderer.uploadMesh(mesh);
+
+                glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+                glViewport(0, 0, target.size, target.size);
+                glClearColor(0.f, 0.f, 0.f, 0.f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                renderer.beginFrame();
+                renderer.render(camera.getViewMatrix(), proj, lightDir, camera.getPosition(), false, false, 0.f);
+                renderer.endFrame();
+
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                glReadPixels(0, 0, target.size, target.size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            }
+
+            std::filesystem::path outFile = outputPath / (std::filesystem::is_directory(inputPath) ? std::filesystem::relative(modelPath, inputPath) : modelPath.filename());
+            outFile.replace_extension(".png");
+
+            std::error_code ec;
+            std::filesystem::create_directories(outFile.parent_path(), ec);
+
+            // GL rows come bottom-up, the software framebuffer is already top-down
+            if (PNG::writePNG(outFile.string(), options.size, options.size, pixels.data(), !options.software))
+                written++;
+            else
+            {
+                LOG_ERROR << "Failed to write thumbnail: " << outFile.string();
+                failed++;
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Wrote " << written << " thumbnails (" << failed << " failed) in " << seconds << " s, " << (seconds > 0.0 ? written / seconds : 0.0) << " models/s\n";
+
+        if (options.software)
+        {
+            softwareRenderer.shutdown();
+        }
+        else
+        {
+            renderer.shutdown();
+            target.destroy();
+            context.destroy();
+        }
+
+        return failed ? 1 : 0;
+    }
+
+    bool parseArgs(int argc, char* argv[], Options& options)
+    {
+        // ToEEModelViewer --thumbnails <art dir or .skm> <output dir> [--size N] [--software]
+        if (argc < 4 || strcmp(argv[1], "--thumbnails") != 0)
+            return false;
+
+        options.inputPath = argv[2];
+        options.outputPath = argv[3];
+        std::replace(options.inputPath.begin(), options.inputPath.end(), '\\', '/');
+
+        for (int i = 4; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+                options.size = std::clamp(atoi(argv[++i]), 16, 4096);
+            else if (strcmp(argv[i], "--software") == 0)
+                options.software = true;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+namespace Thumbnailer
+{
+    struct Options
+    {
+        std::string inputPath;  // art directory (searched recursively) or a single SKM
+        std::string outputPath; // PNGs mirror the input directory layout
+        int size = 256;
+        bool software = false;  // CPU rasterizer, no GL context at all
+    };
+
+    // renders every SKM found into an offscreen framebuffer and writes PNG thumbnails, returns process exit code
+    int run(const Options& options);
+
+    bool parseArgs(int argc, char* argv[], Options& options);
+}
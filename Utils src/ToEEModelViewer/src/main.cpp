@@ -1,7 +1,14 @@
+#include "System/AssetBrowser.hpp"
 #include "System/Camera.hpp"
-#include "System/Logger.hpp"
+#include "System/LoadStatsPanel.hpp"
+#include "System/Profiler.hpp"
 #include "System/Renderer.hpp"
-#include "System/SKM_Loader.hpp"
+#include "System/MapTileRenderer.hpp"
+#include "System/Scene.hpp"
+#include "System/Thumbnailer.hpp"
+#include "Logger.hpp"
+#include "MaterialCache.hpp"
+#include "SKM_Loader.hpp"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -27,10 +34,15 @@ bool geometryHidden = false;
 bool gridShown = false;
 bool renderBones = false;
 bool showAnimEvents = false;
+bool showAssetBrowser = false;
+bool showLoadStats = false;
+bool showProfiler = false;
 bool showToast = false;
 bool showTPose = false;
+bool skinningCached = false;
 bool skmLoaded = false;
 bool uniformLighting = false;
+bool wireframeOverlay = false;
 bool wireframeShown = false;
 
 float bgBlue = .3f;
@@ -49,8 +61,11 @@ std::string loadedFilePath;
 std::string toastMessage;
 std::vector<std::string> animationNames;
 
+AssetDatabase assetDatabase;
 Camera camera;
+LoadStats::Report lastLoadReport;
 Renderer renderer;
+Scene scene;
 SKM::SKMFile skmModel;
 #pragma endregion
 
@@ -109,8 +124,18 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 }
 #pragma endregion
 
-int main()
+int main(int argc, char* argv[])
 {
+    Thumbnailer::Options thumbnailOptions;
+
+    if (Thumbnailer::parseArgs(argc, argv, thumbnailOptions))
+        return Thumbnailer::run(thumbnailOptions);
+
+    MapTileRenderer::Options mapOptions;
+
+    if (MapTileRenderer::parseArgs(argc, argv, mapOptions))
+        return MapTileRenderer::run(mapOptions);
+
 #if defined(NDEBUG) 
 #ifdef _WIN32
     HWND hwnd = GetConsoleWindow();
@@ -149,6 +174,9 @@ int main()
 
     glEnable(GL_DEPTH_TEST);
 
+    // load stages show up as profiler scopes too
+    LoadStats::setStageHooks([](const char* name) { Profiler::get().beginScope(name); }, []() { Profiler::get().endScope(); });
+
     renderer.initialize();
 
     IMGUI_CHECKVERSION();
@@ -159,14 +187,23 @@ int main()
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
 
+    Profiler& profiler = Profiler::get();
+
     while (!glfwWindowShouldClose(window))
     {
+        profiler.beginFrame();
+
         float timeValue = static_cast<float>(glfwGetTime());
 
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE("Events");
+            glfwPollEvents();
+        }
 
         glfwGetFramebufferSize(window, &display_w, &display_h);
 
+        profiler.beginScope("UI");
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -185,13 +222,19 @@ int main()
         bool openClicked = false;
         bool reloadClicked = false;
         bool closeClicked = false;
+        bool openSceneClicked = false;
+        bool closeSceneClicked = false;
         bool exitClicked = false;
+        bool openByNameClicked = false;
         bool openShortcut = io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_O, false);
+        bool openByNameShortcut = io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_T, false);
         bool reloadShortcut = io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_R, false);
         bool closeShortcut = io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_W, false) && skmLoaded;
         bool exitShortcut = io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_Q, false);
         // options
         bool wireframeClicked = false;
+        bool wireframeOverlayClicked = false;
+        bool skinningCacheClicked = false;
         bool hideGeometryClicked = false;
         bool renderBonesClicked = false;
         bool centerOnModelClicked = false;
@@ -201,6 +244,9 @@ int main()
         bool centerOnModelShortcut = io.KeyShift && ImGui::IsKeyPressed(ImGuiKey_C, false);
         // tools
         bool animEventClicked = false;
+        bool loadStatsClicked = false;
+        bool profilerClicked = false;
+        bool profilerShortcut = io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_P, false);
 #pragma endregion
 
 #pragma region MenuBar
@@ -209,8 +255,13 @@ int main()
             if (ImGui::BeginMenu("File"))
             {
                 openClicked = ImGui::MenuItem("Open SKM...", "Ctrl+O");
+                openByNameClicked = ImGui::MenuItem("Open by name...", "Ctrl+T", showAssetBrowser);
                 reloadClicked = ImGui::MenuItem("Reload SKM", "Ctrl+R", false, skmLoaded);
                 closeClicked = ImGui::MenuItem("Close SKM", "Ctrl+W", false, skmLoaded);
+                ImGui::Separator();
+                openSceneClicked = ImGui::MenuItem("Open scene...");
+                closeSceneClicked = ImGui::MenuItem("Close scene", nullptr, false, scene.isLoaded());
+                ImGui::Separator();
                 exitClicked = ImGui::MenuItem("Exit", "Ctrl+Q");
 
                 ImGui::EndMenu();
@@ -219,6 +270,8 @@ int main()
             if (ImGui::BeginMenu("Options"))
             {
                 wireframeClicked = ImGui::MenuItem("Show wireframe", "Ctrl+F", wireframeShown);
+                wireframeOverlayClicked = ImGui::MenuItem("Wireframe overlay", nullptr, wireframeOverlay);
+                skinningCacheClicked = ImGui::MenuItem("Cache skinning", nullptr, skinningCached);
                 hideGeometryClicked = ImGui::MenuItem("Hide geometry", "Ctrl+H", geometryHidden);
                 renderBonesClicked = ImGui::MenuItem("Render bones", "Ctrl+B", renderBones);
                 centerOnModelClicked = ImGui::MenuItem("Center on model", "Shift+C");
@@ -229,6 +282,8 @@ int main()
             if (ImGui::BeginMenu("Tools"))
             {
                 animEventClicked = ImGui::MenuItem("Animation Events", nullptr, showAnimEvents);
+                loadStatsClicked = ImGui::MenuItem("Load Stats", nullptr, showLoadStats);
+                profilerClicked = ImGui::MenuItem("Profiler", "Ctrl+P", showProfiler);
 
                 ImGui::EndMenu();
             }
@@ -239,27 +294,62 @@ int main()
 
 #pragma region MenuBar_functionality
         // file
-        if (openClicked || openShortcut)
+        if (openByNameClicked || openByNameShortcut)
         {
-            const char* filter[] = { "*.SKM" };
-            const char* temp = tinyfd_openFileDialog("Open SKM File", "", 1, filter, "*.SKM", 0);
+            showAssetBrowser = !showAssetBrowser;
+        }
 
+        {
             std::string filePath;
 
-            if (temp)
+            if (showAssetBrowser)
+                AssetBrowser::drawPanel(assetDatabase, &showAssetBrowser, filePath);
+
+            if (openClicked || openShortcut)
             {
-                filePath = temp;
-                std::replace(filePath.begin(), filePath.end(), '\\', '/');
+                const char* filter[] = { "*.SKM" };
+                const char* temp = tinyfd_openFileDialog("Open SKM File", "", 1, filter, "*.SKM", 0);
+
+                if (temp)
+                {
+                    filePath = temp;
+                    std::replace(filePath.begin(), filePath.end(), '\\', '/');
+                }
             }
 
             if (filePath.length())
             {
+                // a model and a scene are not shown together
+                if (scene.isLoaded())
+                {
+                    renderer.clearScene();
+                    scene.clear();
+                }
+
                 if (skmModel.loaded)
                 {
                     animsLoaded = false;
                     skmModel.clear();
                 }
 
+                LoadStats::Session loadSession(lastLoadReport, filePath);
+
+                // indexed models get their data root and animation from the database instead of guessing from the path
+                skmModel.animationPath.clear();
+
+                if (const AssetDatabase::Asset* asset = assetDatabase.find(filePath))
+                {
+                    AssetDatabase::Dependencies dependencies = assetDatabase.resolve(*asset);
+
+                    skmModel.rootPath = assetDatabase.getRootPath();
+
+                    if (dependencies.animation)
+                        skmModel.animationPath = assetDatabase.getFullPath(*dependencies.animation);
+
+                    for (const auto& missing : dependencies.missing)
+                        LOG_WARN << asset->path << " references missing file " << missing;
+                }
+
                 if (skmModel.loadFromFile(filePath))
                 {
                     if (SKM::isOnExceptionList(filePath))
@@ -285,6 +375,12 @@ int main()
                 skmModel.clear();
             }
 
+            // edited MDF and TGA files have to be read again, not served from the renderer's still referenced copies
+            renderer.clearMesh();
+            MDF::MaterialCache::get().invalidate();
+
+            LoadStats::Session loadSession(lastLoadReport, loadedFilePath);
+
             if (skmModel.loadFromFile(loadedFilePath))
             {
                 skmLoaded = true;
@@ -304,6 +400,45 @@ int main()
             renderer.clearMesh();
         }
 
+        if (openSceneClicked)
+        {
+            const char* filter[] = { "*.txt" };
+            const char* temp = tinyfd_openFileDialog("Open Scene", "", 1, filter, "Scene files (*.txt)", 0);
+
+            if (temp)
+            {
+                std::string scenePath = temp;
+                std::replace(scenePath.begin(), scenePath.end(), '\\', '/');
+
+                skmModel = SKM::SKMFile();
+                loadedFilePath.clear();
+                skmLoaded = false;
+                animsLoaded = false;
+                renderer.clearMesh();
+
+                LoadStats::Session loadSession(lastLoadReport, scenePath);
+
+                if (scene.loadFromFile(scenePath))
+                {
+                    renderer.uploadScene(scene);
+                    camera.setTarget(scene.getCenter());
+                }
+                else
+                {
+                    renderer.clearScene();
+                    toastMessage = "Scene has no models that could be loaded";
+                    toastTimer = 5.0f;
+                    showToast = true;
+                }
+            }
+        }
+
+        if (closeSceneClicked)
+        {
+            renderer.clearScene();
+            scene.clear();
+        }
+
         if (exitClicked || exitShortcut)
         {
             glfwSetWindowShouldClose(window, true);
@@ -319,6 +454,17 @@ int main()
             wireframeShown = !wireframeShown;
         }
 
+        if (wireframeOverlayClicked)
+        {
+            wireframeOverlay = !wireframeOverlay;
+        }
+
+        if (skinningCacheClicked)
+        {
+            skinningCached = !skinningCached;
+            renderer.setSkinningCache(skinningCached);
+        }
+
         if (renderBonesClicked || renderBonesShortcut)
         {
             renderBones = !renderBones;
@@ -326,13 +472,23 @@ int main()
 
         if (centerOnModelClicked || centerOnModelShortcut)
         {
-            camera.setTarget(renderer.getModelCenter());
+            camera.setTarget(scene.isLoaded() ? scene.getCenter() : renderer.getModelCenter());
         }
         // tools
         if (animEventClicked)
         {
             showAnimEvents = !showAnimEvents;
         }
+
+        if (loadStatsClicked)
+        {
+            showLoadStats = !showLoadStats;
+        }
+
+        if (profilerClicked || profilerShortcut)
+        {
+            showProfiler = !showProfiler;
+        }
 #pragma endregion
 
         ImGuiViewport* viewport = ImGui::GetMainViewport();
@@ -357,6 +513,8 @@ int main()
 
         if (skmLoaded)
             ImGui::Text("Loaded: %s", loadedFilePath.c_str());
+        else if (scene.isLoaded())
+            ImGui::Text("Scene: %s (%d models, %d instances)", scene.getPath().c_str(), (uint32_t)scene.getModels().size(), (uint32_t)scene.getInstances().size());
         else
             ImGui::Text("No SKM file loaded.");
 
@@ -584,6 +742,14 @@ int main()
         }
 #pragma endregion
 
+        if (showLoadStats)
+            LoadStats::drawPanel(lastLoadReport, &showLoadStats);
+
+        if (showProfiler)
+            profiler.drawPanel(&showProfiler);
+
+        profiler.endScope();
+
 #pragma region Camera
         if (!io.WantCaptureMouse)
             camera.zoom(io.MouseWheel);
@@ -630,6 +796,9 @@ int main()
         lightDir = glm::normalize(-lightDir);
 #pragma endregion
 
+        profiler.beginScope("Scene");
+        renderer.beginFrame();
+
         if (gridShown)
             renderer.renderGrid(view, proj);
 
@@ -637,6 +806,10 @@ int main()
         {
             glPolygonMode(GL_FRONT_AND_BACK, wireframeShown ? GL_LINE : GL_FILL);
             renderer.render(view, proj, lightDir, camera.getPosition(), uniformLighting, showTPose, timeValue);
+            renderer.renderScene(scene, view, proj, lightDir, camera.getPosition(), uniformLighting, showTPose, timeValue);
+
+            if (wireframeOverlay && !wireframeShown)
+                renderer.renderWireframe(view, proj, showTPose);
         }
 
         if (renderBones && skmLoaded)
@@ -645,12 +818,32 @@ int main()
             renderer.renderBones(view, proj, boneScaleFactor, boneAxesShown, boneOctahedronsShown, glm::normalize(-camera.getBoneLightPosition()), showTPose);
         }
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        renderer.endFrame();
+        profiler.endScope();
+
+        {
+            PROFILE_PASS("ImGui");
+
+            ImGui::Render();
+            ImDrawData* drawData = ImGui::GetDrawData();
+
+            for (int i = 0; i < drawData->CmdListsCount; i++)
+                profiler.countDrawCalls(drawData->CmdLists[i]->CmdBuffer.Size);
+
+            profiler.countUploadBytes(drawData->TotalVtxCount * sizeof(ImDrawVert) + drawData->TotalIdxCount * sizeof(ImDrawIdx));
+
+            ImGui_ImplOpenGL3_RenderDrawData(drawData);
+        }
+
+        {
+            PROFILE_SCOPE("Swap");
+            glfwSwapBuffers(window);
+        }
 
-        glfwSwapBuffers(window);
+        profiler.endFrame();
     }
 
+    profiler.shutdown();
     renderer.shutdown();
 
     ImGui_ImplOpenGL3_Shutdown();